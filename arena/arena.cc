@@ -32,7 +32,14 @@
 
 #include "arena/arena.hpp"
 
+#include <execinfo.h>  // for backtrace
+#include <sys/mman.h>  // for madvise
+#include <unistd.h>    // for sysconf
+
 #include <algorithm>
+#include <array>   // for array
+#include <chrono>  // for steady_clock
+#include <cmath>   // for log
 #include <limits>
 
 namespace stdb::memory {
@@ -42,7 +49,18 @@ using stdb::memory::Arena;
  * the Block's constructor,
  * and it should link to the prev Block;
  */
-Arena::Block::Block(uint64_t size, Block* prev) : _prev(prev), _pos(kBlockHeaderSize), _size(size), _limit(size) {}
+Arena::Block::Block(uint64_t size, Block* prev)
+    : _prev(prev), _pos(kBlockHeaderSize), _size(size), _limit(size), _alignment_waste(0) {}
+
+auto Arena::Block::stats() const noexcept -> ArenaBlockStats {
+    return {
+      .size = _size,
+      .used = _pos - kBlockHeaderSize,
+      .cleanup = _size - _limit,
+      .alignment_waste = _alignment_waste,
+      .remain = remain(),
+    };
+}
 
 auto Arena::Block::AlignPos(char* ptr, uint64_t alignment) noexcept -> Arena::Block::Alignment {
     Assert(alignment >= kByteSize, "AlignPos need alignment >= 8");     // NOLINT
@@ -99,10 +117,14 @@ auto Arena::newBlock(uint64_t min_bytes, Block* prev_block) noexcept -> Arena::B
     // no AlignUpTo8 need, because
     // normal_block_size and huge_block_size should be power of 2.
     // if the size over the huge_block_size, the block will be monopolized.
-    void* mem = _options.block_alloc(size);
+    if (not acquire_space(size)) [[unlikely]] {
+        return nullptr;
+    }
+    void* mem = alloc_block_memory(size);
     // if mem == nullptr, means no memory available for current os status,
     // the placement new will trigger a segment-fault
     if (mem == nullptr) [[unlikely]] {
+        release_space(size);
         return nullptr;
     }
 
@@ -119,9 +141,117 @@ auto Arena::newBlock(uint64_t min_bytes, Block* prev_block) noexcept -> Arena::B
 
     auto* blk = new (mem) Block(size, prev_block);
     _space_allocated += size;
+    STDB_TRACE(arena_newblock, this, size, _space_allocated);
     return blk;
 }
 
+/*
+ * enforce the space_limit of the arena and the budget of the group,
+ * ask on_arena_limit what to do while any of them would be exceeded.
+ */
+auto Arena::acquire_space_slow(uint64_t size) noexcept -> bool {
+    while (true) {
+        uint64_t observed = 0;
+        uint64_t space_owned = _space_allocated + _space_cached;
+        bool over_limit = _options.space_limit != 0 &&
+                          (size > _options.space_limit || space_owned > _options.space_limit - size);
+        if (not over_limit && (_options.group == nullptr || _options.group->try_acquire(size, observed))) [[likely]] {
+            return true;
+        }
+        // nullptr means the space_limit of the arena is exceeded.
+        ArenaGroup* exceeded = over_limit ? nullptr : _options.group;
+
+        auto action = ArenaLimitAction::Fail;
+        if (_options.on_arena_limit != nullptr) {
+            action = _options.on_arena_limit(this, exceeded, size);
+        }
+        switch (action) {
+            case ArenaLimitAction::Spill:
+                // retry only if the callback gave some memory back, or the allocating thread would spin forever.
+                if (exceeded == nullptr ? _space_allocated + _space_cached < space_owned
+                                        : exceeded->used() < observed) {
+                    continue;
+                }
+                break;
+            case ArenaLimitAction::Wait:
+                if (exceeded != nullptr) {
+                    exceeded->wait(observed);
+                    continue;
+                }
+                [[fallthrough]];
+            case ArenaLimitAction::Fail:
+                break;
+        }
+        // a refusal is the normal backpressure of a budget, it is counted instead of logged on the allocating thread.
+        ++_limit_refusals;
+        if (exceeded != nullptr) {
+            exceeded->count_refusal();
+        }
+        return false;
+    }
+}
+
+/*
+ * lend a block to the child. the requests not larger than normal_block_size are served by the cached blocks, which
+ * are all normal_block_size, so any of them is large enough; the oversized blocks are allocated for each request.
+ */
+auto Arena::borrow_block(void* context, std::size_t size) noexcept -> void* {
+    auto* parent = static_cast<Arena*>(context);
+    const uint64_t normal_size = parent->_options.normal_block_size;
+    if (size <= normal_size) [[likely]] {
+        if (Block* cached = parent->_cached_blocks; cached != nullptr) {
+            parent->_cached_blocks = cached->prev();
+            return cached;
+        }
+        // allocate a whole normal block, so it can be cached once it comes back.
+        size = normal_size;
+    }
+    if (not parent->acquire_space(size)) [[unlikely]] {
+        return nullptr;
+    }
+    void* mem = parent->alloc_block_memory(size);
+    if (mem == nullptr) [[unlikely]] {
+        parent->release_space(size);
+        return nullptr;
+    }
+    parent->_space_cached += size;
+    return mem;
+}
+
+/*
+ * the child gives its block back, the block header is still valid here, so the size it used is known.
+ * a block not larger than normal_block_size is a normal block actually, see borrow_block, and is cached,
+ * an oversized block is freed at once, so the cache never holds the odd sizes which could not be reused.
+ */
+void Arena::give_back_block(void* context, void* mem) noexcept {
+    auto* parent = static_cast<Arena*>(context);
+    const uint64_t size = static_cast<Block*>(mem)->size();
+    const uint64_t normal_size = parent->_options.normal_block_size;
+    if (size <= normal_size) [[likely]] {
+        // the child's block is dead, a cache header is built in its place.
+        parent->_cached_blocks = new (mem) Block(normal_size, parent->_cached_blocks);
+        return;
+    }
+    parent->dealloc_block_memory(mem);
+    parent->_space_cached -= size;
+    parent->release_space(size);
+}
+
+void Arena::free_cached_blocks() noexcept {
+    Block* curr = _cached_blocks;
+    uint64_t freed_size = 0;
+    while (curr != nullptr) {
+        Block* prev = curr->prev();
+        freed_size += curr->size();
+        dealloc_block_memory(curr);
+        curr = prev;
+    }
+    Assert(freed_size <= _space_cached, "the cached blocks should be a part of the space cached");  // NOLINT
+    _cached_blocks = nullptr;
+    _space_cached -= freed_size;
+    release_space(freed_size);
+}
+
 /*
  * Reset the status of Arena.
  */
@@ -130,13 +260,40 @@ void Arena::Block::Reset() noexcept {
     run_cleanups();
     _pos = kBlockHeaderSize;
     _limit = _size;
+    _alignment_waste = 0;
+}
+
+/*
+ * advise the kernel to take back the pages in [Pos(), CleanupPos()) of the block.
+ */
+auto Arena::release_unused_pages(Block* block, uint64_t release_threshold) noexcept -> uint64_t {
+    static const auto kPageSize = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = align::AlignUp(reinterpret_cast<uint64_t>(block->Pos()), kPageSize);
+    // the cleanup area is empty after reset, but the end of block may be not page aligned.
+    auto end = reinterpret_cast<uint64_t>(block->CleanupPos());
+    end -= end % kPageSize;
+    if (end <= begin || end - begin < release_threshold) {
+        return 0;
+    }
+    auto* addr = reinterpret_cast<void*>(begin);  // NOLINT(performance-no-int-to-ptr)
+    uint64_t length = end - begin;
+#ifdef MADV_FREE
+    if (::madvise(addr, length, MADV_FREE) == 0) [[likely]] {
+        return length;
+    }
+#endif
+    // MADV_FREE is not supported by the kernel, fallback to MADV_DONTNEED.
+    if (::madvise(addr, length, MADV_DONTNEED) == 0) [[likely]] {
+        return length;
+    }
+    return 0;
 }
 
 /*
  * allocate a piece of memory that aligned.
  * if return nullptr means failure
  */
-auto Arena::allocateAligned(uint64_t bytes, uint64_t alignment) noexcept -> char* {
+auto Arena::allocateAligned(uint64_t bytes, uint64_t alignment, const type_info* alloc_type) noexcept -> char* {
     uint64_t needed = align_size(bytes);
     if (need_create_new_block(needed, alignment)) [[unlikely]] {
         Block* curr = newBlock(needed, _last_block);
@@ -150,9 +307,74 @@ auto Arena::allocateAligned(uint64_t bytes, uint64_t alignment) noexcept -> char
     // re make sure aligned in debug model
     Assert((reinterpret_cast<uint64_t>(result) & kByteSizeMask) == 0,
            "alloc result should aligned kByteSize");  // NOLINT
+    if (needed >= _bytes_until_sample) [[unlikely]] {
+        sample_allocation(needed, alloc_type);
+    } else {
+        _bytes_until_sample -= needed;
+    }
     return result;
 }
 
+// the frames of sample_allocation and allocateAligned.
+static constexpr int kSampleSkipFrames = 2;
+static constexpr int kSampleMaxDepth = 64;
+
+void Arena::sample_allocation(uint64_t size, const type_info* alloc_type) noexcept {
+    _bytes_until_sample = next_sample_interval(_options.sample_interval);
+    if (_options.on_arena_sample == nullptr) [[unlikely]] {
+        return;
+    }
+    std::array<void*, kSampleMaxDepth + kSampleSkipFrames> stack{};
+    int depth = ::backtrace(stack.data(), static_cast<int>(stack.size()));
+    int skip = std::min(depth, kSampleSkipFrames);
+    _options.on_arena_sample(
+      {
+        .type = alloc_type,
+        .size = size,
+        .interval = _options.sample_interval,
+        .stack = stack.data() + skip,  // NOLINT
+        .depth = static_cast<uint32_t>(depth - skip),
+      },
+      _cookie);
+}
+
+auto Arena::next_sample_interval(uint64_t mean) noexcept -> uint64_t {
+    if (mean == 0) {
+        return kNeverSample;
+    }
+    // xorshift64*, seeded per thread, the quality is enough for sampling.
+    thread_local uint64_t state =
+      (static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^
+       reinterpret_cast<uint64_t>(&state)) |
+      1U;  // NOLINT
+    state ^= state >> 12U;
+    state ^= state << 25U;
+    state ^= state >> 27U;
+    uint64_t random = state * 0x2545F4914F6CDD1DULL;
+    // uniform in (0, 1], 53 bits for the mantissa of double.
+    double uniform = static_cast<double>((random >> 11U) + 1) * 0x1.0p-53;
+    return static_cast<uint64_t>(-std::log(uniform) * static_cast<double>(mean)) + 1;
+}
+
+auto Arena::Stats() const -> ArenaStats {
+    ArenaStats stats;
+    for (const Block* block = _last_block; block != nullptr; block = block->prev()) {
+        ArenaBlockStats block_stats = block->stats();
+        ++stats.block_count;
+        stats.space_allocated += block_stats.size;
+        stats.used += block_stats.used;
+        stats.cleanup += block_stats.cleanup;
+        stats.alignment_waste += block_stats.alignment_waste;
+        if (block == _last_block) {
+            stats.available = block_stats.remain;
+        } else {
+            stats.tail_waste += block_stats.remain;
+        }
+        stats.blocks.push_back(block_stats);
+    }
+    return stats;
+}
+
 auto Arena::check(const char* ptr) -> ArenaContainStatus {
     auto* block = _last_block;
     while (block != nullptr) {
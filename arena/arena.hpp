@@ -36,7 +36,10 @@
 
 #include <boost/assert/source_location.hpp>
 #include <boost/core/demangle.hpp>  // for demangle
+#include <array>                    // for array
+#include <atomic>                   // for atomic
 #include <concepts>
+#include <cstddef>  // for byte
 #include <cstdint>
 #include <cstdlib>    // for free, malloc, size_t
 #include <exception>  // for type_info
@@ -50,10 +53,12 @@
 #include <unordered_map>  // for polymorphic_allocator
 #include <utility>        // for exchange, forward
 #include <variant>
+#include <vector>  // for vector
 
 #include "align/align.hpp"  // for AlignUpTo
 #include "arenahelper.hpp"  // for ArenaHelper
 #include "assert_config.hpp"
+#include "trace_config.hpp"
 
 #define TYPENAME(type) ::boost::core::demangle(typeid(type).name())  // NOLINT
 
@@ -77,6 +82,7 @@ struct CleanupNode
 };
 
 inline constexpr uint64_t kByteSize = 8;
+inline constexpr uint64_t kInt128Size = 16;
 inline constexpr uint64_t kInt256Size = 32;
 inline constexpr uint64_t kByteSizeMask = kByteSize - 1;
 static constexpr uint64_t kCleanupNodeSize = AlignUpTo<kByteSize>(static_cast<uint64_t>(sizeof(memory::CleanupNode)));
@@ -122,6 +128,140 @@ enum class ArenaContainStatus : uint8_t
     BlockUsed,
     BlockUnUsed,
 };
+
+/*
+ * the decision of the on_arena_limit callback, while a new block would exceed the space limit of the arena or the
+ * budget of its ArenaGroup.
+ * Fail: newBlock returns nullptr, so Create/AllocateAligned return nullptr.
+ * Spill: the callback has given some memory back (spilled to disk, reset other arenas...), try again.
+ *        it is the same as Fail if the usage of the arena or the group is not lower than before the callback.
+ * Wait: block the thread until another arena of the group gives blocks back, then try again.
+ *       it is only meaningful for the group budget, it is the same as Fail for the limit of a single arena.
+ */
+enum class ArenaLimitAction : uint8_t
+{
+    Fail = 0,
+    Spill,
+    Wait,
+};
+
+/*
+ * the utilization of a block, all in bytes.
+ * size = header + used + remain + cleanup, and the alignment_waste is a part of used.
+ */
+struct ArenaBlockStats
+{
+    uint64_t size = 0;
+    uint64_t used = 0;             // the allocated space, including the alignment padding.
+    uint64_t cleanup = 0;          // the space of the cleanup nodes.
+    uint64_t alignment_waste = 0;  // the padding for alignment.
+    uint64_t remain = 0;           // the space never allocated.
+};
+
+/*
+ * the utilization of all blocks of an arena.
+ * tail_waste is the remain of the blocks except the last one, it can not be allocated any more,
+ * and the remain of the last block is available.
+ */
+struct ArenaStats
+{
+    uint64_t block_count = 0;
+    uint64_t space_allocated = 0;
+    uint64_t used = 0;
+    uint64_t cleanup = 0;
+    uint64_t alignment_waste = 0;
+    uint64_t tail_waste = 0;
+    uint64_t available = 0;
+    std::vector<ArenaBlockStats> blocks;  // from the last block to the first block.
+};
+
+/*
+ * a sampled allocation, see Options::sample_interval.
+ * the stack is only valid in the on_arena_sample hook, copy it if it is needed later.
+ */
+struct ArenaAllocationSample
+{
+    const type_info* type = nullptr;  // nullptr for the raw allocations, such as AllocateAligned.
+    uint64_t size = 0;                // the aligned size of the allocation.
+    uint64_t interval = 0;            // the mean sampling interval, for unsampling.
+    void* const* stack = nullptr;     // the return addresses, from the caller of the Arena to the outermost.
+    uint32_t depth = 0;
+};
+
+/*
+ * ArenaGroup is a memory budget shared by many arenas, such as all arenas of a query or a tenant.
+ * arenas charge their blocks to the group in newBlock, and give them back while the blocks are freed,
+ * so the allocation fast path never touches the atomic counter.
+ * the group must outlive all arenas attached to it.
+ */
+class ArenaGroup
+{
+   public:
+    explicit ArenaGroup(uint64_t limit) noexcept : _limit(limit) {}
+
+    ArenaGroup(const ArenaGroup&) = delete;
+    auto operator=(const ArenaGroup&) -> ArenaGroup& = delete;
+    ArenaGroup(ArenaGroup&&) = delete;
+    auto operator=(ArenaGroup&&) -> ArenaGroup& = delete;
+    ~ArenaGroup() = default;
+
+    /*
+     * charge size bytes to the group, return false if the budget would be exceeded,
+     * the observed usage is written back for wait().
+     */
+    [[nodiscard]] auto try_acquire(uint64_t size, uint64_t& observed) noexcept -> bool {
+        observed = _used.load(std::memory_order::relaxed);
+        do {
+            if (size > _limit || observed > _limit - size) [[unlikely]] {
+                return false;
+            }
+        } while (not _used.compare_exchange_weak(observed, observed + size, std::memory_order::relaxed));
+        return true;
+    }
+
+    /*
+     * give size bytes back to the group, and wake up the waiting arenas.
+     */
+    void release(uint64_t size) noexcept {
+        Assert(_used.load(std::memory_order::relaxed) >= size, "ArenaGroup release more than acquired");  // NOLINT
+        // seq_cst pairs with wait(): either the releaser sees the waiter, or the waiter sees the new usage.
+        // with acquire/release both sides may read the old values, and the wakeup is lost.
+        _used.fetch_sub(size, std::memory_order::seq_cst);
+        if (_waiters.load(std::memory_order::seq_cst) != 0) [[unlikely]] {
+            _used.notify_all();
+        }
+    }
+
+    /*
+     * block until the usage is changed from the observed value.
+     */
+    void wait(uint64_t observed) noexcept {
+        _waiters.fetch_add(1, std::memory_order::seq_cst);
+        _used.wait(observed, std::memory_order::seq_cst);
+        _waiters.fetch_sub(1, std::memory_order::seq_cst);
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto used() const noexcept -> uint64_t {
+        return _used.load(std::memory_order::relaxed);
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto limit() const noexcept -> uint64_t { return _limit; }
+
+    /*
+     * the new blocks refused by the budget, after on_arena_limit of the arenas gave up.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto refusals() const noexcept -> uint64_t {
+        return _refusals.load(std::memory_order::relaxed);
+    }
+
+    [[gnu::always_inline]] inline void count_refusal() noexcept { _refusals.fetch_add(1, std::memory_order::relaxed); }
+
+   private:
+    std::atomic<uint64_t> _used{0};
+    std::atomic<uint32_t> _waiters{0};
+    std::atomic<uint64_t> _refusals{0};
+    const uint64_t _limit;
+};
 /*
  * Arena is a session-ware allocator implementation,
  * it can be used to allocate memory blocks and de-allocate them in a single call.
@@ -154,7 +294,26 @@ class Arena
           _last_block(std::exchange(other._last_block, nullptr)),
           _resource(std::exchange(other._resource, nullptr)),
           _cookie(std::exchange(other._cookie, nullptr)),
-          _space_allocated(std::exchange(other._space_allocated, 0)) {}
+          _space_allocated(std::exchange(other._space_allocated, 0)),
+          _cached_blocks(std::exchange(other._cached_blocks, nullptr)),
+          _space_cached(std::exchange(other._space_cached, 0)),
+          _limit_refusals(std::exchange(other._limit_refusals, 0)),
+          _bytes_until_sample(std::exchange(other._bytes_until_sample, kNeverSample)) {
+        // the cookie constructed in the storage of other is moved into this storage by on_arena_move.
+        void* old_cookie = _cookie;
+        if (_cookie == other._cookie_storage.data()) {
+            Assert(_options.on_arena_move != nullptr, "a cookie in the cookie storage needs on_arena_move");  // NOLINT
+            if (_options.on_arena_move == nullptr) [[unlikely]] {
+                // nothing can move it, it stays in other and is destroyed with it.
+                other._cookie = std::exchange(_cookie, nullptr);
+                return;
+            }
+            _cookie = _cookie_storage.data();
+        }
+        if (_cookie != nullptr && _options.on_arena_move != nullptr) [[unlikely]] {
+            _options.on_arena_move(this, _cookie, old_cookie);
+        }
+    }
     auto operator=(Arena&&) noexcept -> Arena& = delete;
 
     /*
@@ -179,6 +338,31 @@ class Arena
         // A Function pointer to a dealloc method for the blocks in the Arena.
         void (*block_dealloc)(void*){nullptr};
 
+        // the block provider version of block_alloc/block_dealloc, the block_context will be passed as the first
+        // argument, so the provider can carry its own state, such as a shm segment.
+        // if they are set, block_alloc and block_dealloc will be ignored.
+        void* (*block_alloc_with_context)(void* context, std::size_t){nullptr};
+        void (*block_dealloc_with_context)(void* context, void*){nullptr};
+        void* block_context{nullptr};
+
+        // the blocks are backed by private anonymous mmap pages (such as a mmap based block_alloc), so
+        // ResetAndRelease can give the unused pages of the retained block back to the kernel by madvise.
+        bool block_mmap_backed{false};
+
+        // the hard limit of the space allocated by the arena, 0 means unlimited.
+        uint64_t space_limit{0};
+
+        // the shared budget of a group of arenas, nullptr means no group.
+        ArenaGroup* group{nullptr};
+
+        // called while a new block would exceed space_limit (group is nullptr) or the budget of the group.
+        // if it is nullptr, the allocation just fails.
+        ArenaLimitAction (*on_arena_limit)(Arena* arena, ArenaGroup* group, uint64_t request_size){nullptr};
+
+        // sample about one allocation in every sample_interval bytes allocated (geometric sampling), and pass its
+        // stack trace to on_arena_sample. 0 disables the sampling, it costs a compare and a subtraction.
+        uint64_t sample_interval{0};
+
         void (*logger_func)(const std::string&){nullptr};
 
         // Arena hooked functions
@@ -190,11 +374,22 @@ class Arena
         // NULL and not use the cookie feature).
         // on_arena_reset and on_arena_destruction also receive the space used in
         // the arena just before the reset.
+        // on_arena_reset also receives the space released to the kernel by ResetAndRelease, it is 0 for Reset.
         void* (*on_arena_init)(Arena* arena, const boost::source_location& loc){nullptr};
-        void (*on_arena_reset)(Arena* arena, void* cookie, uint64_t space_used, uint64_t space_wasted){nullptr};
+        void (*on_arena_reset)(Arena* arena, void* cookie, uint64_t space_used, uint64_t space_wasted,
+                               uint64_t space_released){nullptr};
         void (*on_arena_allocation)(const type_info* alloc_type, uint64_t alloc_size, void* cookie){nullptr};
         void (*on_arena_newblock)(uint64_t blk_num, uint64_t blk_size, void* cookie){nullptr};
+        // called for each block just before it is freed or reset, with its final utilization.
+        void (*on_arena_block)(const ArenaBlockStats& stats, void* cookie){nullptr};
+        // called for the sampled allocations while sample_interval is not 0.
+        void (*on_arena_sample)(const ArenaAllocationSample& sample, void* cookie){nullptr};
         void* (*on_arena_destruction)(Arena* arena, void* cookie, uint64_t space_used, uint64_t space_wasted){nullptr};
+        // called while the arena is moved, with the cookie of the new arena and the old one. they are different if
+        // the cookie is in the cookie storage, then cookie is the raw storage of the new arena, the hook should
+        // move construct the cookie in it from old_cookie, and destroy the old one. it is required if on_arena_init
+        // constructs the cookie in the cookie storage.
+        void (*on_arena_move)(Arena* arena, void* cookie, void* old_cookie){nullptr};
 
         /*
          * A simplest function to get Options.
@@ -216,8 +411,9 @@ class Arena
      * Block struct of the memory block, it was always placement in a continuous memory area.
      * Block has a header.
      * and Arena's a Blocks' single linked-list
+     * the header is aligned to 16, so the first allocation of a block is aligned as malloc's result.
      */
-    class Block
+    class alignas(kInt128Size) Block
     {
         struct Alignment
         {
@@ -253,6 +449,7 @@ class Arena
             char* ptr = Pos();
             auto [aligned_ptr, alignment_waste] = AlignPos(ptr, alignment);
             _pos += (size + alignment_waste);
+            _alignment_waste += alignment_waste;
             return aligned_ptr;
         }
 
@@ -276,6 +473,12 @@ class Arena
 
         [[gnu::always_inline, nodiscard]] inline auto pos() const noexcept -> uint64_t { return _pos; }
 
+        [[gnu::always_inline, nodiscard]] inline auto alignment_waste() const noexcept -> uint64_t {
+            return _alignment_waste;
+        }
+
+        [[nodiscard]] auto stats() const noexcept -> ArenaBlockStats;
+
         [[nodiscard, gnu::always_inline]] inline auto remain() const noexcept -> uint64_t {
             Assert(_limit >= _pos, "remain should be ge than 0");  // NOLINT
             return _limit - _pos;
@@ -311,6 +514,7 @@ class Arena
         uint64_t _pos;
         uint64_t _size;   // the size of the block
         uint64_t _limit;  // the limit can be use for Create
+        uint64_t _alignment_waste;
     };
 
     class memory_resource : public ::pmr::memory_resource
@@ -364,6 +568,9 @@ class Arena
     ~Arena() {
         // free blocks
         uint64_t all_waste_space = free_all_blocks();
+        free_cached_blocks();
+        Assert(_space_cached == 0, "the child arenas should be destroyed before the parent");  // NOLINT
+        STDB_TRACE(arena_destruction, this, _space_allocated, all_waste_space);
         // make sure the on_arena_destruction was not free.
         if (_options.on_arena_destruction != nullptr) [[likely]] {
             _options.on_arena_destruction(this, _cookie, _space_allocated, all_waste_space);
@@ -388,17 +595,61 @@ class Arena
      * and reset all status of the Arena object.
      * After Reset, Arena can be used as the new Arena Object.
      */
-    inline auto Reset() noexcept -> uint64_t {
-        // free all blocks except the first block
-        uint64_t all_waste_space = free_blocks_except_head();
-        if (_options.on_arena_reset != nullptr) [[likely]] {
-            _options.on_arena_reset(this, _cookie, _space_allocated, all_waste_space);
-        }
-        // reset all internal status.
-        uint64_t reset_size = _space_allocated;
-        _space_allocated = _last_block->size();
-        _last_block->Reset();
-        return reset_size;
+    inline auto Reset() noexcept -> uint64_t { return reset(false, 0); }
+
+    /*
+     * Reset the Arena like Reset, and advise the kernel (MADV_FREE, or MADV_DONTNEED if not supported) to take
+     * back the unused page-aligned tail of the retained block, if the tail is not less than release_threshold.
+     * the block keeps mapped, so the next allocations need no new block_alloc cycle.
+     * it only works while Options::block_mmap_backed is set, otherwise it is the same as Reset.
+     * the released bytes are reported through on_arena_reset.
+     */
+    inline auto ResetAndRelease(uint64_t release_threshold) noexcept -> uint64_t {
+        return reset(_options.block_mmap_backed, release_threshold);
+    }
+
+    /*
+     * create a child arena, which borrows its blocks from the block cache of this arena instead of block_alloc, and
+     * gives them back to the cache on Reset or destruction, so the nested scratch arenas need no malloc once warm.
+     * the child has its own cleanups and Reset, and inherits the block sizes, the hooks and the logger.
+     * the space of the cache is charged to this arena's space_limit and group.
+     *
+     * Reset and ResetAndRelease of the parent free the idle cached blocks, so a long-lived parent does not keep the
+     * peak of its children forever.
+     *
+     * NOTICE:
+     * the parent must outlive its children, and they are not thread-safe, use them in the same thread.
+     * the children keep the address of the parent as their block_context, so the parent must not be moved while any
+     * child is alive, or the children will borrow from and give back to a dangling arena.
+     */
+    [[nodiscard]] auto CreateChild() noexcept -> Arena {
+        Options child_options = _options;
+        child_options.block_alloc_with_context = &Arena::borrow_block;
+        child_options.block_dealloc_with_context = &Arena::give_back_block;
+        child_options.block_context = this;
+        child_options.space_limit = 0;
+        child_options.group = nullptr;
+        child_options.on_arena_limit = nullptr;
+        return Arena(std::move(child_options));
+    }
+
+    /*
+     * walk all blocks for the utilization of the arena, it is for diagnosing and tuning the block sizes,
+     * not for the hot path.
+     */
+    [[nodiscard]] auto Stats() const -> ArenaStats;
+
+    /*
+     * SpaceCached() return the memory held for the child arenas, both the lent and the cached blocks.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto SpaceCached() const noexcept -> uint64_t { return _space_cached; }
+
+    /*
+     * LimitRefusals() return the number of the new blocks refused by space_limit or the group, the refusals are
+     * counted rather than logged, a budget hit is the normal backpressure.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto LimitRefusals() const noexcept -> uint64_t {
+        return _limit_refusals;
     }
 
     /*
@@ -423,7 +674,7 @@ class Arena
      */
     template <Creatable T, typename... Args>
     [[nodiscard]] auto Create(Args&&... args) noexcept -> T* {
-        char* ptr = allocateAligned(sizeof(T));
+        char* ptr = allocateAligned(sizeof(T), kByteSize, &typeid(T));
         if (ptr != nullptr) [[likely]] {
             Construct<T>(ptr, *this, std::forward<Args>(args)...);
             T* result = reinterpret_cast<T*>(ptr);
@@ -455,7 +706,7 @@ class Arena
             _options.logger_func(output_message);
         }
         const uint64_t size = sizeof(T) * num;
-        char* ptr = allocateAligned(size);
+        char* ptr = allocateAligned(size, kByteSize, &typeid(T));
         if (ptr != nullptr) [[likely]] {
             T* curr = reinterpret_cast<T*>(ptr);
             for (uint64_t i = 0; i < num; ++i) {
@@ -503,6 +754,16 @@ class Arena
         return nullptr;
     }
 
+    // the size of the inline storage for the cookie of the hooks.
+    static constexpr uint64_t kCookieStorageSize = 96;
+
+    /*
+     * the inline storage for the cookie, on_arena_init may construct its cookie in it instead of new, so an
+     * instrumented arena needs no extra heap allocation for it, and on_arena_destruction should only destroy it.
+     * a cookie in it is opaque to the arena, on_arena_move is required to move it to the moved arena.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto cookie_storage() noexcept -> void* { return _cookie_storage.data(); }
+
     [[gnu::always_inline]] inline auto get_memory_resource() noexcept -> memory_resource* {
         Assert(_resource != nullptr,
                "memory_resource should make sure _resource is not nullptr, or dereference crash");  // NOLINT
@@ -541,7 +802,95 @@ class Arena
         }
         if (_options.on_arena_init != nullptr) [[likely]] {
             _cookie = _options.on_arena_init(this, loc);
+            Assert(_cookie != _cookie_storage.data() || _options.on_arena_move != nullptr,
+                   "on_arena_move is required to move the cookie in the cookie storage");  // NOLINT
+        }
+        if (_options.sample_interval != 0) [[unlikely]] {
+            _bytes_until_sample = next_sample_interval(_options.sample_interval);
         }
+        STDB_TRACE(arena_init, this, _options.suggested_init_block_size);
+    }
+
+    /*
+     * free all blocks except the first, and reset the first block.
+     * if release is true, the unused pages of the first block will be advised to the kernel.
+     */
+    inline auto reset(bool release, uint64_t release_threshold) noexcept -> uint64_t {
+        // free all blocks except the first block
+        uint64_t all_waste_space = free_blocks_except_head();
+        // the idle blocks cached for the children are freed too, the lent ones stay with the living children.
+        free_cached_blocks();
+        // reset all internal status.
+        uint64_t reset_size = _space_allocated;
+        _space_allocated = _last_block->size();
+        report_block(_last_block);
+        _last_block->Reset();
+        uint64_t released = release ? release_unused_pages(_last_block, release_threshold) : 0;
+        STDB_TRACE(arena_reset, this, reset_size, all_waste_space, released);
+        if (_options.on_arena_reset != nullptr) [[likely]] {
+            _options.on_arena_reset(this, _cookie, reset_size, all_waste_space, released);
+        }
+        return reset_size;
+    }
+
+    /*
+     * check the space_limit and charge the group before a new block is allocated.
+     * it is out of the fast path, the most arenas have neither of them.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto acquire_space(uint64_t size) noexcept -> bool {
+        if (_options.space_limit == 0 && _options.group == nullptr) [[likely]] {
+            return true;
+        }
+        return acquire_space_slow(size);
+    }
+
+    auto acquire_space_slow(uint64_t size) noexcept -> bool;
+
+    /*
+     * give the space of a freed block back to the group.
+     */
+    [[gnu::always_inline]] inline void release_space(uint64_t size) noexcept {
+        if (_options.group != nullptr && size != 0) {
+            _options.group->release(size);
+        }
+    }
+
+    /*
+     * the block provider of the child arenas, context is the parent.
+     * only the normal blocks are cached, they serve every request not larger than normal_block_size.
+     */
+    static auto borrow_block(void* context, std::size_t size) noexcept -> void*;
+    static void give_back_block(void* context, void* mem) noexcept;
+
+    /*
+     * free the idle blocks cached for the child arenas, the lent ones are not touched.
+     */
+    void free_cached_blocks() noexcept;
+
+    /*
+     * madvise the page-aligned unused area of the block, return the released bytes.
+     */
+    static auto release_unused_pages(Block* block, uint64_t release_threshold) noexcept -> uint64_t;
+
+    /*
+     * alloc the memory of a block from the block provider.
+     */
+    [[gnu::always_inline]] inline auto alloc_block_memory(uint64_t size) noexcept -> void* {
+        if (_options.block_alloc_with_context != nullptr) {
+            return _options.block_alloc_with_context(_options.block_context, size);
+        }
+        return _options.block_alloc(size);
+    }
+
+    /*
+     * give the memory of a block back to the block provider.
+     */
+    [[gnu::always_inline]] inline void dealloc_block_memory(void* mem) noexcept {
+        if (_options.block_dealloc_with_context != nullptr) {
+            _options.block_dealloc_with_context(_options.block_context, mem);
+            return;
+        }
+        _options.block_dealloc(mem);
     }
 
     /*
@@ -553,7 +902,19 @@ class Arena
     /*
      * internal allocate aligned impl.
      */
-    auto allocateAligned(uint64_t bytes, uint64_t alignment = kByteSize) noexcept -> char*;
+    auto allocateAligned(uint64_t bytes, uint64_t alignment = kByteSize,
+                         const type_info* alloc_type = nullptr) noexcept -> char*;
+
+    /*
+     * the slow path of the sampling, pick the next interval and call on_arena_sample with the stack trace.
+     */
+    [[gnu::noinline]] void sample_allocation(uint64_t size, const type_info* alloc_type) noexcept;
+
+    /*
+     * draw the bytes until the next sample from an exponential distribution with the mean, so the sampling is
+     * memoryless and unbiased to the allocation patterns.
+     */
+    [[nodiscard]] static auto next_sample_interval(uint64_t mean) noexcept -> uint64_t;
 
     /*
      * check if needed a new block
@@ -605,6 +966,12 @@ class Arena
         return addCleanup(ptr, &arena_destruct_object<T>);
     }
 
+    [[gnu::always_inline]] inline void report_block(const Block* block) noexcept {
+        if (_options.on_arena_block != nullptr) [[unlikely]] {
+            _options.on_arena_block(block->stats(), _cookie);
+        }
+    }
+
     /*
      * free all blocks and return all remains size of all blocks that was freed.
      */
@@ -612,17 +979,22 @@ class Arena
         Block* curr = _last_block;
         Block* prev = nullptr;
         uint64_t remain_size = 0;
+        uint64_t freed_size = 0;
 
         while (curr != nullptr) {
             prev = curr->prev();
             // add the size of curr blk.
             remain_size += curr->remain();
+            freed_size += curr->size();
+            report_block(curr);
+            STDB_TRACE(arena_freeblock, this, curr->size(), curr->remain());
             // run all cleanups first
             curr->run_cleanups();
-            _options.block_dealloc(curr);
+            dealloc_block_memory(curr);
             curr = prev;
         }
         _last_block = nullptr;
+        release_space(freed_size);
         return remain_size;
     }
 
@@ -633,16 +1005,21 @@ class Arena
         Block* curr = _last_block;
         Block* prev = nullptr;
         uint64_t remain_size = 0;
+        uint64_t freed_size = 0;
 
         while (curr != nullptr && curr->prev() != nullptr) {
             prev = curr->prev();
             // add the size of curr blk.
             remain_size += curr->remain();
+            freed_size += curr->size();
+            report_block(curr);
+            STDB_TRACE(arena_freeblock, this, curr->size(), curr->remain());
             // run all cleanups first
             curr->run_cleanups();
-            _options.block_dealloc(curr);
+            dealloc_block_memory(curr);
             curr = prev;
         }
+        release_space(freed_size);
         Assert(curr != nullptr, "curr should not be nullptr");
         // add the curr blk remain to result
         remain_size += curr->remain();
@@ -661,6 +1038,21 @@ class Arena
 
     uint64_t _space_allocated;
 
+    // the free blocks given back by the child arenas, linked by Block::prev.
+    Block* _cached_blocks{nullptr};
+    uint64_t _space_cached{0};
+
+    // the new blocks refused by space_limit or the group.
+    uint64_t _limit_refusals{0};
+
+    static constexpr uint64_t kNeverSample = std::numeric_limits<uint64_t>::max();
+
+    // the countdown of the sampling, it never reaches 0 if the sampling is disabled.
+    uint64_t _bytes_until_sample{kNeverSample};
+
+    // no initialization, it is only touched by the hooks.
+    alignas(kInt128Size) std::array<std::byte, kCookieStorageSize> _cookie_storage;
+
     static constexpr uint64_t kThresholdHuge = 4;
 
     friend class ArenaTestHelper;
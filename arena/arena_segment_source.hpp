@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <cstddef>  // for size_t
+
+#include "arena.hpp"  // for Arena
+
+namespace stdb::memory {
+
+/*
+ * a segment source of stdb_segmented_vector which places the segments in an Arena, the arena must outlive the vector.
+ * deallocate does nothing, the blocks are released with the arena.
+ */
+class arena_segment_source
+{
+   public:
+    explicit arena_segment_source(Arena& arena) noexcept : _arena(&arena) {}
+
+    [[nodiscard, gnu::always_inline]] auto allocate(std::size_t bytes, std::size_t alignment) const -> void* {
+        return _arena->AllocateAligned(bytes, alignment);
+    }
+
+    [[gnu::always_inline]] static void deallocate([[maybe_unused]] void* ptr, [[maybe_unused]] std::size_t bytes,
+                                                  [[maybe_unused]] std::size_t alignment) noexcept {}
+
+   private:
+    Arena* _arena;
+};
+
+}  // namespace stdb::memory
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <algorithm>    // for min, clamp
+#include <array>        // for array
+#include <atomic>       // for atomic, memory_order
+#include <bit>          // for bit_width
+#include <cmath>        // for ceil
+#include <cstdint>      // for uint64_t, uint32_t
+#include <type_traits>  // for is_same_v
+
+namespace stdb::memory {
+
+/*
+ * LogLinearHistogram is a HDR-style histogram of the values in [0, 2^MaxBits).
+ * each power-of-2 range is split into 16 linear sub-buckets, so the bucket index is computed in O(1) by bit_width,
+ * and the width of a bucket is at most 1/16 of its lower bound, the midpoint is within about 3% of any value in it.
+ * the values less than 32 are counted exactly, the values not less than 2^MaxBits are counted in the last bucket,
+ * so its bound is open, but sum() adds up the unclamped values.
+ *
+ * Counter can be uint64_t for a snapshot, a single writer counter for a per-thread shard, or std::atomic<uint64_t>
+ * for the global one, histograms with the same MaxBits can be merged whatever the Counter is.
+ */
+template <uint32_t MaxBits, typename Counter = uint64_t>
+class LogLinearHistogram
+{
+   public:
+    static constexpr uint32_t kSubBucketBits = 4;
+    static constexpr uint32_t kSubBucketCount = 1U << kSubBucketBits;
+    static_assert(MaxBits > kSubBucketBits && MaxBits < 64, "MaxBits of LogLinearHistogram is out of range");
+    static constexpr uint32_t kBucketCount = (MaxBits - kSubBucketBits + 1) * kSubBucketCount;
+    static constexpr uint64_t kMaxValue = (1ULL << MaxBits) - 1;
+
+    [[nodiscard, gnu::always_inline]] inline static constexpr auto bucket_index(uint64_t value) noexcept -> uint32_t {
+        value = std::min(value, kMaxValue);
+        // the highest bit above the sub-bucket bits, the values below 2 * kSubBucketCount are in the linear region.
+        auto shift = static_cast<uint32_t>(std::bit_width(value >> kSubBucketBits));
+        if (shift == 0) {
+            return static_cast<uint32_t>(value);
+        }
+        return shift * kSubBucketCount + static_cast<uint32_t>(value >> (shift - 1)) - kSubBucketCount;
+    }
+
+    /*
+     * the lower bound (inclusive) of a bucket.
+     */
+    [[nodiscard]] static constexpr auto bucket_lower(uint32_t idx) noexcept -> uint64_t {
+        uint32_t shift = idx / kSubBucketCount;
+        uint64_t sub = idx % kSubBucketCount;
+        if (shift == 0) {
+            return sub;
+        }
+        return (kSubBucketCount + sub) << (shift - 1);
+    }
+
+    /*
+     * the upper bound (exclusive) of a bucket.
+     */
+    [[nodiscard]] static constexpr auto bucket_upper(uint32_t idx) noexcept -> uint64_t {
+        uint32_t shift = idx / kSubBucketCount;
+        return bucket_lower(idx) + (shift == 0 ? 1 : (1ULL << (shift - 1)));
+    }
+
+    [[gnu::always_inline]] inline void record(uint64_t value, uint64_t count = 1) noexcept {
+        add(_buckets[bucket_index(value)], count);
+        add(_sum, value * count);
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto count(uint32_t idx) const noexcept -> uint64_t {
+        return load(_buckets[idx]);
+    }
+
+    [[nodiscard]] auto total() const noexcept -> uint64_t {
+        uint64_t sum = 0;
+        for (const auto& bucket : _buckets) {
+            sum += load(bucket);
+        }
+        return sum;
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto sum() const noexcept -> uint64_t { return load(_sum); }
+
+    template <typename OtherCounter>
+    void merge(const LogLinearHistogram<MaxBits, OtherCounter>& other) noexcept {
+        for (uint32_t i = 0; i < kBucketCount; ++i) {
+            if (uint64_t value = other.count(i); value != 0) {
+                add(_buckets[i], value);
+            }
+        }
+        add(_sum, other.sum());
+    }
+
+    /*
+     * the value at the percentile (0, 100], it is the midpoint of the bucket which holds the rank, 0 if empty.
+     */
+    [[nodiscard]] auto percentile(double percent) const noexcept -> uint64_t {
+        uint64_t sum = total();
+        if (sum == 0) {
+            return 0;
+        }
+        constexpr double kHundred = 100.0;
+        auto rank = static_cast<uint64_t>(std::ceil(percent / kHundred * static_cast<double>(sum)));
+        rank = std::clamp<uint64_t>(rank, 1, sum);
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < kBucketCount; ++i) {
+            seen += load(_buckets[i]);
+            if (seen >= rank) {
+                return bucket_lower(i) + (bucket_upper(i) - 1 - bucket_lower(i)) / 2;
+            }
+        }
+        return kMaxValue;
+    }
+
+    void clear() noexcept {
+        for (auto& bucket : _buckets) {
+            bucket = 0;
+        }
+        _sum = 0;
+    }
+
+   private:
+    [[gnu::always_inline]] inline static void add(Counter& counter, uint64_t value) noexcept {
+        if constexpr (std::is_same_v<Counter, std::atomic<uint64_t>>) {
+            counter.fetch_add(value, std::memory_order::relaxed);
+        } else {
+            counter += value;
+        }
+    }
+
+    [[nodiscard, gnu::always_inline]] inline static auto load(const Counter& counter) noexcept -> uint64_t {
+        if constexpr (std::is_same_v<Counter, std::atomic<uint64_t>>) {
+            return counter.load(std::memory_order::relaxed);
+        } else {
+            return static_cast<uint64_t>(counter);
+        }
+    }
+
+    std::array<Counter, kBucketCount> _buckets{};
+    Counter _sum{};
+};
+
+}  // namespace stdb::memory
@@ -15,16 +15,224 @@
  */
 #include "metrics.hpp"
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <boost/core/demangle.hpp>
+#include <cstddef>
 #include <cstdint>
 #include <format>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
 
 namespace stdb::memory {
 
 GlobalArenaMetrics global_arena_metrics = GlobalArenaMetrics();
 
+// the registry should be initialized before any thread_local shard.
+ArenaMetricsRegistry arena_metrics_registry = ArenaMetricsRegistry();
+
 thread_local LocalArenaMetrics local_arena_metrics = LocalArenaMetrics();
 
+auto GlobalArenaMetrics::string() const -> std::string {
+    ArenaMetricsSnapshot snapshot;
+    snapshot.merge(*this);
+    return snapshot.string();
+}
+
+void ArenaMetricsSnapshot::merge(const GlobalArenaMetrics& metrics) {
+    merge_counters(metrics);
+    std::lock_guard<std::mutex> guard(metrics.arena_alloc_counter_mutex);
+    for (const auto& [loc, counter] : metrics.arena_alloc_counter) {
+        arena_alloc_counter[loc] += counter.load(std::memory_order::relaxed);
+    }
+    for (const auto& [type, stats] : metrics.type_counter) {
+        auto& merged = type_counter[type_name(type)];
+        merged.count += stats.count;
+        merged.bytes += stats.bytes;
+        merged.live_count += stats.live_count;
+        merged.live_bytes += stats.live_bytes;
+    }
+}
+
+void ArenaMetricsSnapshot::merge(const LocalArenaMetrics& metrics) {
+    merge_counters(metrics);
+    metrics.arena_alloc_counter.for_each([this](const char* file, uint32_t line, uint64_t count) {
+        arena_alloc_counter[std::format("{}:{}", file, line)] += count;
+    });
+    if (metrics.arena_alloc_counter.overflow() != 0) {
+        arena_alloc_counter["<overflow>"] += metrics.arena_alloc_counter.overflow();
+    }
+    metrics.type_alloc_counter.for_each([this](const std::type_info* type, uint64_t count, uint64_t bytes) {
+        auto& merged = type_counter[type_name(type)];
+        merged.count += count;
+        merged.bytes += bytes;
+    });
+    metrics.type_live_counter.for_each([this](const std::type_info* type, uint64_t count, uint64_t bytes) {
+        auto& merged = type_counter[type_name(type)];
+        merged.live_count += count;
+        merged.live_bytes += bytes;
+    });
+    const auto& alloc_counter = metrics.type_alloc_counter;
+    const auto& live_counter = metrics.type_live_counter;
+    if (alloc_counter.overflow_count() != 0 || live_counter.overflow_count() != 0) {
+        auto& merged = type_counter[type_name(nullptr)];
+        merged.count += alloc_counter.overflow_count();
+        merged.bytes += alloc_counter.overflow_bytes();
+        merged.live_count += live_counter.overflow_count();
+        merged.live_bytes += live_counter.overflow_bytes();
+    }
+}
+
+auto ArenaMetricsSnapshot::type_name(const std::type_info* type) -> std::string {
+    if (type == nullptr) {
+        return "<overflow>";
+    }
+    if (*type == typeid(void)) {
+        return "<raw>";
+    }
+    return ::boost::core::demangle(type->name());
+}
+
+auto ArenaMetricsSnapshot::string() const -> std::string {
+    std::string str;
+    //        str.reserve(kKiloByte);
+    str += std::format(
+      "Summary:\n"
+      "  init_count: {}\n"
+      "  reset_count: {}\n"
+      "  destruct_count: {}\n"
+      "  alloc_count: {}\n"
+      "  newblock_count: {}\n"
+      "  space_allocated: {}\n"
+      "  space_used: {}\n"
+      "  space_wasted: {}\n"
+      "  space_resettled: {}\n"
+      "  space_released: {}\n"
+      "  block_count: {}\n"
+      "  block_cleanup: {}\n"
+      "  block_alignment_waste: {}\n"
+      "  block_tail_waste: {}\nAllocSize distribution:",
+      init_count, reset_count, destruct_count, alloc_count, newblock_count, space_allocated, space_used, space_wasted,
+      space_resettled, space_released, block_count, block_cleanup, block_alignment_waste, block_tail_waste);
+
+    constexpr std::array<double, 5> kPercentiles{50.0, 90.0, 99.0, 99.9, 100.0};
+    for (double percent : kPercentiles) {
+        str += std::format("\n  p{}: {}B", percent, alloc_size_histogram.percentile(percent));
+    }
+
+    str += "\nLifetime distribution:";
+    for (double percent : kPercentiles) {
+        str += std::format("\n  p{}: {}us", percent, destruct_lifetime_histogram.percentile(percent));
+    }
+
+    str += "\nBlockSize distribution:";
+    for (double percent : kPercentiles) {
+        str += std::format("\n  p{}: {}B", percent, block_size_histogram.percentile(percent));
+    }
+
+    str += "\nBlockUtilization distribution:";
+    for (double percent : kPercentiles) {
+        str += std::format("\n  p{}: {}%", percent, block_utilization_histogram.percentile(percent));
+    }
+
+    str += "\nArena Location/AllocSize:";  // TODO(longqimin): re-evaluate str.reserve size
+    for (const auto& [loc, counter] : arena_alloc_counter) {
+        str += std::format("\n  {}: {}", loc, counter);
+    }
+
+    str += "\nType Count/Bytes/LiveCount/LiveBytes:";
+    for (const auto& [type, stats] : type_counter) {
+        str += std::format("\n  {}: {} {} {} {}", type, stats.count, stats.bytes, stats.live_count, stats.live_bytes);
+    }
+
+    return str;
+}
+
+void ArenaMetricsRegistry::remove(LocalArenaMetrics* shard) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    std::erase(_shards, shard);
+    shard->live_arenas.splice_to(_orphans);
+}
+
+auto live_arenas() -> std::vector<LiveArenaInfo> {
+    std::vector<LiveArenaInfo> arenas;
+    auto collect = [&arenas](const LiveArenaShard& shard) {
+        shard.for_each([&arenas](const LiveArenaNode& node) {
+            const auto& cookie = static_cast<const ArenaMetricsCookie&>(node);
+            arenas.push_back({
+              .arena = cookie.arena,
+              .init_location = cookie.init_location,
+              .init_time_point = cookie.init_time_point,
+              .space_allocated = cookie.space_allocated.load(std::memory_order::relaxed),
+            });
+        });
+    };
+    arena_metrics_registry.with_shards([&collect](const std::vector<LocalArenaMetrics*>& shards) {
+        for (const auto* shard : shards) {
+            collect(shard->live_arenas);
+        }
+        collect(arena_metrics_registry.orphans());
+    });
+    return arenas;
+}
+
+auto top_live_arenas(size_t n) -> std::vector<LiveArenaInfo> {
+    auto arenas = live_arenas();
+    auto middle = arenas.begin() + static_cast<std::ptrdiff_t>(std::min(n, arenas.size()));
+    std::partial_sort(arenas.begin(), middle, arenas.end(), [](const LiveArenaInfo& lhs, const LiveArenaInfo& rhs) {
+        return lhs.space_allocated > rhs.space_allocated;
+    });
+    arenas.erase(middle, arenas.end());
+    return arenas;
+}
+
+auto live_arenas_older_than(steady_clock::duration age) -> std::vector<LiveArenaInfo> {
+    auto arenas = live_arenas();
+    auto deadline = steady_clock::now() - age;
+    std::erase_if(arenas, [deadline](const LiveArenaInfo& info) { return info.init_time_point > deadline; });
+    std::sort(arenas.begin(), arenas.end(), [](const LiveArenaInfo& lhs, const LiveArenaInfo& rhs) {
+        return lhs.init_time_point < rhs.init_time_point;
+    });
+    return arenas;
+}
+
+auto scrape_arena_metrics() -> ArenaMetricsSnapshot {
+    return arena_metrics_registry.with_shards([](const std::vector<LocalArenaMetrics*>& shards) {
+        std::vector<uint64_t> sequences(shards.size());
+        while (true) {
+            bool reporting = false;
+            for (size_t i = 0; i < shards.size(); ++i) {
+                sequences[i] = shards[i]->report_sequence.load(std::memory_order::acquire);
+                reporting = reporting || (sequences[i] % 2 == 1);
+            }
+            if (reporting) [[unlikely]] {
+                std::this_thread::yield();
+                continue;
+            }
+
+            ArenaMetricsSnapshot snapshot;
+            snapshot.merge(global_arena_metrics);
+            for (const auto* shard : shards) {
+                snapshot.merge(*shard);
+            }
+
+            // a shard reported while scraping, its counters may be counted twice or missed.
+            std::atomic_thread_fence(std::memory_order::acquire);
+            bool consistent = true;
+            for (size_t i = 0; i < shards.size() && consistent; ++i) {
+                consistent = shards[i]->report_sequence.load(std::memory_order::relaxed) == sequences[i];
+            }
+            if (consistent) [[likely]] {
+                return snapshot;
+            }
+        }
+    });
+}
+
 }  // namespace stdb::memory
 
 namespace std {
@@ -20,18 +20,24 @@
 
 #include <array>   // for array, array<>::value_type
 #include <atomic>  // for atomic, memory_order, memory...
+#include <bit>     // for has_single_bit
 #include <boost/assert/source_location.hpp>
 #include <chrono>         // for operator""ms, duration, stea...
 #include <compare>        // for operator<=, strong_ordering
+#include <cstddef>        // for size_t
 #include <cstdint>        // for uint64_t, uint32_t
 #include <format>         // for format
-#include <memory>         // for allocator, unique_ptr
+#include <memory>         // for allocator, unique_ptr, make_unique
+#include <new>            // for operator new
+#include <mutex>          // for mutex, lock_guard
 #include <string>         // for string, char_traits, hash
 #include <typeinfo>       // for type_info
 #include <unordered_map>  // for unordered_map, operator==
 #include <utility>        // for tuple_element<>::type
+#include <vector>         // for vector
 
-#include "arena.hpp"  // for Arena
+#include "arena.hpp"      // for Arena
+#include "histogram.hpp"  // for LogLinearHistogram
                       //
 namespace std {
 
@@ -47,44 +53,332 @@ struct formatter<atomic<uint64_t>> : std::formatter<uint64_t>
 namespace stdb::memory {
 
 using std::atomic;
-using std::chrono::milliseconds;
+using std::chrono::microseconds;
 using std::chrono::steady_clock;
 
-constexpr static int kAllocBucketSize = 8;
-constexpr std::array<uint64_t, kAllocBucketSize> alloc_size_bucket{
-  64,   // alloc_size <= 64 will counter into alloc_size_bucket_counter[0]
-  128,  // 64 < alloc_size <= 128 will counter into alloc_size_bucket_counter[1]. same to the followings
-  256, 512, 1024, 2048, 4096, 1UL << 20UL};
-
-constexpr static int kLifetimeBucketSize = 8;
-using namespace std::chrono_literals;
-constexpr static std::array<milliseconds, kAllocBucketSize> destruct_lifetime_bucket{
-  1ms,  // destruct_lifetime <= 1ms will counter into destruct_lifetime_bucket[0]
-  5ms,  // 1ms < destruct_lifetime <= 5ms will counter into destruct_lifetime_bucket[1].
-  10ms, 50ms, 100ms, 200ms, 500ms, 1000ms,
+// alloc size in bytes, 8B ~ 64GB.
+constexpr static uint32_t kAllocSizeHistogramBits = 36;
+// arena lifetime in microseconds, 1us ~ 1h.
+constexpr static uint32_t kLifetimeHistogramBits = 32;
+
+template <typename Counter>
+using AllocSizeHistogram = LogLinearHistogram<kAllocSizeHistogramBits, Counter>;
+
+template <typename Counter>
+using LifetimeHistogram = LogLinearHistogram<kLifetimeHistogramBits, Counter>;
+
+// block utilization in percent, 0 ~ 100.
+constexpr static uint32_t kUtilizationHistogramBits = 7;
+constexpr static uint64_t kPercent = 100;
+
+template <typename Counter>
+using UtilizationHistogram = LogLinearHistogram<kUtilizationHistogramBits, Counter>;
+
+constexpr static uint32_t kCallSiteCapacity = 256;
+constexpr static uint32_t kTypeCapacity = 128;
+constexpr static uint32_t kArenaTypeCapacity = 16;
+constexpr static std::size_t kMetricsCacheLineSize = 64;
+
+/*
+ * ShardCounter is a counter of a per-thread metrics shard.
+ * only the owner thread writes it, so it is updated by a relaxed load and store without the lock prefix,
+ * and the scraper can read it from other threads at any time.
+ */
+class ShardCounter
+{
+   public:
+    ShardCounter(uint64_t value = 0) noexcept : _value(value) {}  // NOLINT(google-explicit-constructor)
+    ShardCounter(const ShardCounter& other) noexcept : _value(other.load()) {}
+    ShardCounter(ShardCounter&&) = delete;
+    auto operator=(ShardCounter&&) -> ShardCounter& = delete;
+    ~ShardCounter() = default;
+
+    auto operator=(const ShardCounter& other) noexcept -> ShardCounter& { return *this = other.load(); }
+
+    auto operator=(uint64_t value) noexcept -> ShardCounter& {
+        _value.store(value, std::memory_order::relaxed);
+        return *this;
+    }
+
+    [[gnu::always_inline]] inline auto operator+=(uint64_t value) noexcept -> ShardCounter& {
+        _value.store(_value.load(std::memory_order::relaxed) + value, std::memory_order::relaxed);
+        return *this;
+    }
+
+    [[gnu::always_inline]] inline auto operator-=(uint64_t value) noexcept -> ShardCounter& {
+        _value.store(_value.load(std::memory_order::relaxed) - value, std::memory_order::relaxed);
+        return *this;
+    }
+
+    [[gnu::always_inline]] inline auto operator++() noexcept -> ShardCounter& { return *this += 1; }
+
+    [[nodiscard, gnu::always_inline]] inline auto load() const noexcept -> uint64_t {
+        return _value.load(std::memory_order::relaxed);
+    }
+
+    operator uint64_t() const noexcept { return load(); }  // NOLINT(google-explicit-constructor)
+
+   private:
+    atomic<uint64_t> _value;
+};
+
+/*
+ * PaddedAtomic owns a whole cache line, so the reporters of different counters never bounce the same line.
+ */
+struct alignas(kMetricsCacheLineSize) PaddedAtomic : atomic<uint64_t>
+{
+    using atomic<uint64_t>::atomic;
+    using atomic<uint64_t>::operator=;
+};
+
+/*
+ * CallSiteCounter is a fixed-size open-addressing table of the per call-site counters.
+ * it is keyed by the address of the file name literal and the line of a source_location, so the hot path never
+ * builds a string nor allocates, the strings are formatted at report time only.
+ * the same file may have different literal addresses in different translation units, they are merged by the string
+ * key while reporting. the load factor is kept below 3/4, the counters of the later sites go to overflow.
+ * only the owner thread writes it, for_each can be called by the scraper from other threads.
+ */
+template <uint32_t Capacity>
+class CallSiteCounter
+{
+    static_assert(std::has_single_bit(Capacity), "Capacity of CallSiteCounter should be power of 2");
+    constexpr static uint32_t kMask = Capacity - 1;
+    constexpr static uint32_t kMaxSize = Capacity / 4 * 3;
+
+    struct Slot
+    {
+        // file is published last, a slot with non-null file has valid line.
+        atomic<const char*> file{nullptr};
+        atomic<uint32_t> line{0};
+        ShardCounter value{0};
+    };
+
+   public:
+    [[gnu::always_inline]] inline void add(const char* file, uint32_t line, uint64_t value) noexcept {
+        for (uint32_t idx = slot_index(file, line);; idx = (idx + 1) & kMask) {
+            auto& slot = _slots[idx];
+            const char* slot_file = slot.file.load(std::memory_order::relaxed);
+            if (slot_file == file && slot.line.load(std::memory_order::relaxed) == line) [[likely]] {
+                slot.value += value;
+                return;
+            }
+            if (slot_file == nullptr) {
+                if (_size == kMaxSize) [[unlikely]] {
+                    _overflow += value;
+                    return;
+                }
+                slot.line.store(line, std::memory_order::relaxed);
+                slot.value = value;
+                slot.file.store(file, std::memory_order::release);
+                ++_size;
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] auto get(const char* file, uint32_t line) const noexcept -> uint64_t {
+        for (uint32_t idx = slot_index(file, line);; idx = (idx + 1) & kMask) {
+            const auto& slot = _slots[idx];
+            const char* slot_file = slot.file.load(std::memory_order::acquire);
+            if (slot_file == file && slot.line.load(std::memory_order::relaxed) == line) {
+                return slot.value;
+            }
+            if (slot_file == nullptr) {
+                return 0;
+            }
+        }
+    }
+
+    /*
+     * visit all counters with func(file, line, value).
+     */
+    template <typename Func>
+    void for_each(Func&& func) const {
+        for (const auto& slot : _slots) {
+            if (const char* file = slot.file.load(std::memory_order::acquire); file != nullptr) {
+                func(file, slot.line.load(std::memory_order::relaxed), slot.value.load());
+            }
+        }
+    }
+
+    void clear() noexcept {
+        if (_size != 0) {
+            for (auto& slot : _slots) {
+                slot.file.store(nullptr, std::memory_order::relaxed);
+                slot.line.store(0, std::memory_order::relaxed);
+                slot.value = 0;
+            }
+            _size = 0;
+        }
+        _overflow = 0;
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto size() const noexcept -> uint32_t { return _size; }
+
+    [[nodiscard, gnu::always_inline]] inline auto overflow() const noexcept -> uint64_t { return _overflow; }
+
+   private:
+    [[nodiscard, gnu::always_inline]] inline static auto slot_index(const char* file, uint32_t line) noexcept
+      -> uint32_t {
+        // fibonacci hashing, the literal address is aligned, so mix it with the line first.
+        constexpr uint64_t kGoldenRatio = 0x9E3779B97F4A7C15ULL;
+        constexpr uint64_t kShift = 32;
+        auto key = reinterpret_cast<uint64_t>(file) ^ (static_cast<uint64_t>(line) << kShift);
+        return static_cast<uint32_t>((key * kGoldenRatio) >> kShift) & kMask;
+    }
+
+    std::array<Slot, Capacity> _slots{};
+    uint32_t _size{0};
+    ShardCounter _overflow{0};
+};
+
+/*
+ * TypeCounter is a fixed-size open-addressing table of the per-type allocation count and bytes, keyed by the
+ * type_info pointer which is passed to on_arena_allocation, the raw allocations are keyed by typeid(void).
+ * the counters wrap around, so a negative delta (the objects freed by reset) can be added as well, and the sum of
+ * the deltas from many tables is still right.
+ * the load factor is kept below 3/4, a new type is counted in the overflow bucket if the table is full, and add
+ * returns false for it.
+ */
+template <uint32_t Capacity, typename Counter>
+class TypeCounter
+{
+    static_assert(std::has_single_bit(Capacity), "Capacity of TypeCounter should be power of 2");
+    constexpr static uint32_t kMask = Capacity - 1;
+    constexpr static uint32_t kMaxSize = Capacity / 4 * 3;
+
+    struct Slot
+    {
+        // type is published last, a slot with non-null type has valid counters.
+        atomic<const std::type_info*> type{nullptr};
+        Counter count{0};
+        Counter bytes{0};
+    };
+
+   public:
+    [[gnu::always_inline]] inline auto add(const std::type_info* type, uint64_t count, uint64_t bytes) noexcept
+      -> bool {
+        for (uint32_t idx = slot_index(type);; idx = (idx + 1) & kMask) {
+            auto& slot = _slots[idx];
+            const std::type_info* slot_type = slot.type.load(std::memory_order::relaxed);
+            if (slot_type == type) [[likely]] {
+                slot.count += count;
+                slot.bytes += bytes;
+                return true;
+            }
+            if (slot_type == nullptr) {
+                if (_size == kMaxSize) [[unlikely]] {
+                    add_overflow(count, bytes);
+                    return false;
+                }
+                slot.count = count;
+                slot.bytes = bytes;
+                slot.type.store(type, std::memory_order::release);
+                ++_size;
+                return true;
+            }
+        }
+    }
+
+    /*
+     * visit all counters with func(type, count, bytes).
+     */
+    template <typename Func>
+    void for_each(Func&& func) const {
+        for (const auto& slot : _slots) {
+            if (const std::type_info* type = slot.type.load(std::memory_order::acquire); type != nullptr) {
+                func(type, static_cast<uint64_t>(slot.count), static_cast<uint64_t>(slot.bytes));
+            }
+        }
+    }
+
+    void clear() noexcept {
+        if (_size != 0) {
+            for (auto& slot : _slots) {
+                slot.type.store(nullptr, std::memory_order::relaxed);
+                slot.count = 0;
+                slot.bytes = 0;
+            }
+            _size = 0;
+        }
+        _overflow_count = 0;
+        _overflow_bytes = 0;
+    }
+
+    [[gnu::always_inline]] inline void add_overflow(uint64_t count, uint64_t bytes) noexcept {
+        _overflow_count += count;
+        _overflow_bytes += bytes;
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto size() const noexcept -> uint32_t { return _size; }
+
+    [[nodiscard, gnu::always_inline]] inline auto overflow_count() const noexcept -> uint64_t {
+        return static_cast<uint64_t>(_overflow_count);
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto overflow_bytes() const noexcept -> uint64_t {
+        return static_cast<uint64_t>(_overflow_bytes);
+    }
+
+   private:
+    [[nodiscard, gnu::always_inline]] inline static auto slot_index(const std::type_info* type) noexcept -> uint32_t {
+        constexpr uint64_t kGoldenRatio = 0x9E3779B97F4A7C15ULL;
+        constexpr uint64_t kShift = 32;
+        return static_cast<uint32_t>((reinterpret_cast<uint64_t>(type) * kGoldenRatio) >> kShift) & kMask;
+    }
+
+    std::array<Slot, Capacity> _slots{};
+    uint32_t _size{0};
+    Counter _overflow_count{0};
+    Counter _overflow_bytes{0};
 };
 
+/*
+ * the allocation count and bytes of a type, and the objects which are not reset or destructed yet.
+ */
+struct TypeStats
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    uint64_t live_count = 0;
+    uint64_t live_bytes = 0;
+};
+
+/*
+ * GlobalArenaMetrics accumulates the metrics reported by the threads, and the shards of the exited threads.
+ */
 struct GlobalArenaMetrics
 {
-    atomic<uint64_t> init_count = 0;
-    atomic<uint64_t> destruct_count = 0;
-    atomic<uint64_t> alloc_count = 0;
-    atomic<uint64_t> newblock_count = 0;
-    atomic<uint64_t> reset_count = 0;
-    atomic<uint64_t> space_allocated = 0;
-    atomic<uint64_t> space_resettled = 0;
-    atomic<uint64_t> space_used = 0;
-    atomic<uint64_t> space_wasted = 0;
+    PaddedAtomic init_count{0};
+    PaddedAtomic destruct_count{0};
+    PaddedAtomic alloc_count{0};
+    PaddedAtomic newblock_count{0};
+    PaddedAtomic reset_count{0};
+    PaddedAtomic space_allocated{0};
+    PaddedAtomic space_resettled{0};
+    PaddedAtomic space_used{0};
+    PaddedAtomic space_wasted{0};
+    PaddedAtomic space_released{0};  // space given back to the kernel by ResetAndRelease
+    // the utilization of the blocks when they are freed or reset.
+    PaddedAtomic block_count{0};
+    PaddedAtomic block_cleanup{0};
+    PaddedAtomic block_alignment_waste{0};
+    PaddedAtomic block_tail_waste{0};
     // space_allocated > space_used means memory reused;
     // space_allocated < space_used means memory fragment or arena used extra memory；
 
-    // TODO(longqimin): other considerable metrics： fragments, arena-lifetime
 
-    // atomic<uint64_t> alloc_size_bucket_counter[kAllocBucketSize] = {0};
-    std::array<atomic<uint64_t>, kAllocBucketSize> alloc_size_bucket_counter{0};
-    // atomic<uint64_t> destruct_lifetime_bucket_counter[kLifetimeBucketSize] = {0};
-    std::array<atomic<uint64_t>, kLifetimeBucketSize> destruct_lifetime_bucket_counter{0};
+    AllocSizeHistogram<atomic<uint64_t>> alloc_size_histogram;
+    LifetimeHistogram<atomic<uint64_t>> destruct_lifetime_histogram;
+    AllocSizeHistogram<atomic<uint64_t>> block_size_histogram;
+    UtilizationHistogram<atomic<uint64_t>> block_utilization_histogram;
     std::unordered_map<std::string, atomic<uint64_t>> arena_alloc_counter = {};  // arena identified by init() location
+    // the threads report concurrently, arena_alloc_counter may be rehashed while a new location is inserted.
+    mutable std::mutex arena_alloc_counter_mutex;
+    // guarded by arena_alloc_counter_mutex as well, the live counters are sums of wrapped deltas.
+    // the types overflowed the tables of the threads are keyed by nullptr.
+    std::unordered_map<const std::type_info*, TypeStats> type_counter = {};
 
     void reset() {  // lockless and races for metric-data is acceptable
         init_count.store(0, std::memory_order::relaxed);
@@ -96,80 +390,220 @@ struct GlobalArenaMetrics
         space_resettled.store(0, std::memory_order::relaxed);
         space_used.store(0, std::memory_order::relaxed);
         space_wasted.store(0, std::memory_order::relaxed);
-        for (auto& counter : alloc_size_bucket_counter) {
-            counter.store(0, std::memory_order::relaxed);
-        }
-        for (auto& counter : destruct_lifetime_bucket_counter) {
-            counter.store(0, std::memory_order::relaxed);
-        }
+        space_released.store(0, std::memory_order::relaxed);
+        block_count.store(0, std::memory_order::relaxed);
+        block_cleanup.store(0, std::memory_order::relaxed);
+        block_alignment_waste.store(0, std::memory_order::relaxed);
+        block_tail_waste.store(0, std::memory_order::relaxed);
+        alloc_size_histogram.clear();
+        destruct_lifetime_histogram.clear();
+        block_size_histogram.clear();
+        block_utilization_histogram.clear();
+        std::lock_guard<std::mutex> guard(arena_alloc_counter_mutex);
         for (auto& [key, counter] : arena_alloc_counter) {
             counter.store(0, std::memory_order::relaxed);
         }
+        type_counter.clear();
     }
 
-    [[nodiscard]] auto string() const -> std::string {
-        std::string str;
-        //        str.reserve(kKiloByte);
-        str += std::format(
-          "Summary:\n"
-          "  init_count: {}\n"
-          "  reset_count: {}\n"
-          "  destruct_count: {}\n"
-          "  alloc_count: {}\n"
-          "  newblock_count: {}\n"
-          "  space_allocated: {}\n"
-          "  space_used: {}\n"
-          "  space_wasted: {}\n"
-          "  space_resettled: {}\nAllocSize distribution:",
-          init_count, reset_count, destruct_count, alloc_count, newblock_count, space_allocated, space_used,
-          space_wasted, space_resettled);
-
-        constexpr uint64_t kPercentMagic = 100UL;
-        for (uint64_t i = 0, count = 0; i < kAllocBucketSize; i++) {
-            count += alloc_size_bucket_counter.at(i);
-            // count < alloc_count
-            str += std::format("\n  le={}: {}%", alloc_size_bucket.at(i), count * kPercentMagic / alloc_count);
-        }
+    /*
+     * the reported metrics only, use scrape_arena_metrics() to include the unreported shards.
+     */
+    [[nodiscard]] auto string() const -> std::string;
+};
 
-        str += "\nLifetime distribution:";
-        for (uint64_t i = 0, count = 0; i < kLifetimeBucketSize; i++) {
-            count += destruct_lifetime_bucket_counter.at(i);
-            str += std::format("\n  le={}ms: {}", destruct_lifetime_bucket.at(i).count(),
-                               (count * kPercentMagic) / destruct_count);
-        }
+// process level global metrics
+extern GlobalArenaMetrics global_arena_metrics;
+
+struct LocalArenaMetrics;
+class LiveArenaShard;
+
+/*
+ * the intrusive node of the live arena registry, it is a part of the cookie of every instrumented arena.
+ */
+struct LiveArenaNode
+{
+    LiveArenaNode* prev = this;
+    LiveArenaNode* next = this;
+    // the shard it is linked in, it only changes while the owner thread exits.
+    atomic<LiveArenaShard*> shard{nullptr};
+};
 
-        str += "\nArena Location/AllocSize:";  // TODO(longqimin): re-evaluate str.reserve size
-        for (const auto& [loc, counter] : arena_alloc_counter) {
-            str += std::format("\n  {}: {}", loc, counter);
+/*
+ * LiveArenaShard is the circular list of the live arenas created by a thread, guarded by its own mutex.
+ * linking and unlinking are O(1), and only contend with the queries and the rare cross-thread destruction.
+ */
+class LiveArenaShard
+{
+   public:
+    LiveArenaShard() = default;
+    LiveArenaShard(const LiveArenaShard&) = delete;
+    LiveArenaShard(LiveArenaShard&&) = delete;
+    auto operator=(const LiveArenaShard&) -> LiveArenaShard& = delete;
+    auto operator=(LiveArenaShard&&) -> LiveArenaShard& = delete;
+    ~LiveArenaShard() = default;
+
+    /*
+     * call func() with the lock held.
+     */
+    template <typename Func>
+    auto with_lock(Func&& func) const {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return func();
+    }
+
+    void link(LiveArenaNode* node) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        node->shard.store(this, std::memory_order::relaxed);
+        node->prev = &_head;
+        node->next = _head.next;
+        _head.next->prev = node;
+        _head.next = node;
+    }
+
+    /*
+     * the lock of the shard of the node should be held.
+     */
+    static void unlink_locked(LiveArenaNode* node) noexcept {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = node;
+    }
+
+    /*
+     * move all nodes to the target, while the owner thread exits.
+     */
+    void splice_to(LiveArenaShard& target) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        std::lock_guard<std::mutex> target_guard(target._mutex);
+        while (_head.next != &_head) {
+            LiveArenaNode* node = _head.next;
+            unlink_locked(node);
+            node->shard.store(&target, std::memory_order::relaxed);
+            node->prev = &target._head;
+            node->next = target._head.next;
+            target._head.next->prev = node;
+            target._head.next = node;
         }
+    }
 
-        return str;
+    /*
+     * visit all nodes with func(node) with the lock held.
+     */
+    template <typename Func>
+    void for_each(Func&& func) const {
+        std::lock_guard<std::mutex> guard(_mutex);
+        for (const LiveArenaNode* node = _head.next; node != &_head; node = node->next) {
+            func(*node);
+        }
     }
-};
 
-// process level global metrics
-extern GlobalArenaMetrics global_arena_metrics;
+   private:
+    mutable std::mutex _mutex;
+    LiveArenaNode _head;
+};
 
-struct LocalArenaMetrics
+/*
+ * ArenaMetricsRegistry holds the metrics shards of all living threads, so the scraper can sum them on demand
+ * without any cooperation of the threads.
+ * the mutex is only taken by thread creation/exit and the scraper, never by the probes.
+ */
+class ArenaMetricsRegistry
 {
-    uint64_t init_count = 0;
-    uint64_t destruct_count = 0;
-    uint64_t alloc_count = 0;
-    uint64_t newblock_count = 0;
-    uint64_t reset_count = 0;
-    uint64_t space_allocated = 0;
-    uint64_t space_resettled = 0;
-    uint64_t space_used = 0;  // space_allocated > space_used means memory reused;
-                              // space_allocated < space_used means memory fragment or arena used extra memory；
-    uint64_t space_wasted = 0;
+   public:
+    void add(LocalArenaMetrics* shard) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _shards.push_back(shard);
+    }
 
-    // TODO(longqimin): other considerable metrics： fragments, arena-lifetime
+    /*
+     * the live arenas of the exiting thread are moved to the orphans.
+     */
+    void remove(LocalArenaMetrics* shard);
+
+    /*
+     * call func(shards) with the lock held, the shards can not exit while visiting.
+     */
+    template <typename Func>
+    auto with_shards(Func&& func) const {
+        std::lock_guard<std::mutex> guard(_mutex);
+        return func(_shards);
+    }
+
+    /*
+     * call func(shard) with the lock of the live arena shard of the node held, for the node of another thread,
+     * the registry lock keeps the shard from exiting.
+     */
+    template <typename Func>
+    void with_live_arena_shard(LiveArenaNode* node, Func&& func) {
+        std::lock_guard<std::mutex> guard(_mutex);
+        LiveArenaShard* shard = node->shard.load(std::memory_order::relaxed);
+        shard->with_lock([&] { func(*shard); });
+    }
 
-    // uint64_t alloc_size_bucket_counter[kAllocBucketSize] = {0};
-    std::array<uint64_t, kAllocBucketSize> alloc_size_bucket_counter{0};
-    // uint64_t destruct_lifetime_bucket_counter[kLifetimeBucketSize] = {0};
-    std::array<uint64_t, kLifetimeBucketSize> destruct_lifetime_bucket_counter{0};
-    std::unordered_map<std::string, uint64_t> arena_alloc_counter = {};  // arena identified by init() location
+    /*
+     * the live arenas whose creator threads have exited, only visit it in with_shards.
+     */
+    [[nodiscard]] auto orphans() const -> const LiveArenaShard& { return _orphans; }
+
+   private:
+    mutable std::mutex _mutex;
+    std::vector<LocalArenaMetrics*> _shards;
+    LiveArenaShard _orphans;
+};
+
+extern ArenaMetricsRegistry arena_metrics_registry;
+
+/*
+ * LocalArenaMetrics is the per-thread shard of the metrics, the probes only touch the shard of current thread.
+ * it registers itself to the arena_metrics_registry, and flushes itself into the global_arena_metrics while the
+ * thread exits, so no metric is lost even the thread never calls report_to_global_metrics.
+ */
+struct alignas(kMetricsCacheLineSize) LocalArenaMetrics
+{
+    ShardCounter init_count = 0;
+    ShardCounter destruct_count = 0;
+    ShardCounter alloc_count = 0;
+    ShardCounter newblock_count = 0;
+    ShardCounter reset_count = 0;
+    ShardCounter space_allocated = 0;
+    ShardCounter space_resettled = 0;
+    ShardCounter space_used = 0;  // space_allocated > space_used means memory reused;
+                                  // space_allocated < space_used means memory fragment or arena used extra memory；
+    ShardCounter space_wasted = 0;
+    ShardCounter space_released = 0;
+    ShardCounter block_count = 0;
+    ShardCounter block_cleanup = 0;
+    ShardCounter block_alignment_waste = 0;
+    ShardCounter block_tail_waste = 0;
+
+
+    AllocSizeHistogram<ShardCounter> alloc_size_histogram;
+    LifetimeHistogram<ShardCounter> destruct_lifetime_histogram;
+    AllocSizeHistogram<ShardCounter> block_size_histogram;
+    UtilizationHistogram<ShardCounter> block_utilization_histogram;
+    CallSiteCounter<kCallSiteCapacity> arena_alloc_counter;  // arena identified by init() location
+    TypeCounter<kTypeCapacity, ShardCounter> type_alloc_counter;
+    // the deltas of the live objects, the objects are freed by the thread which resets or destructs the arena.
+    TypeCounter<kTypeCapacity, ShardCounter> type_live_counter;
+
+    // odd while the shard is moving its counters to the global_arena_metrics, the scraper retries on it.
+    atomic<uint64_t> report_sequence{0};
+
+    // the live arenas created by this thread.
+    LiveArenaShard live_arenas;
+
+    LocalArenaMetrics() { arena_metrics_registry.add(this); }
+
+    LocalArenaMetrics(const LocalArenaMetrics&) = delete;
+    LocalArenaMetrics(LocalArenaMetrics&&) = delete;
+    auto operator=(const LocalArenaMetrics&) -> LocalArenaMetrics& = delete;
+    auto operator=(LocalArenaMetrics&&) -> LocalArenaMetrics& = delete;
+
+    ~LocalArenaMetrics() {
+        report_to_global_metrics();
+        arena_metrics_registry.remove(this);
+    }
 
     void reset() {
         init_count = 0;
@@ -181,38 +615,57 @@ struct LocalArenaMetrics
         space_resettled = 0;
         space_used = 0;
         space_wasted = 0;
+        space_released = 0;
+        block_count = 0;
+        block_cleanup = 0;
+        block_alignment_waste = 0;
+        block_tail_waste = 0;
 
-        alloc_size_bucket_counter.fill(0);
-        destruct_lifetime_bucket_counter.fill(0);
+        alloc_size_histogram.clear();
+        destruct_lifetime_histogram.clear();
+        block_size_histogram.clear();
+        block_utilization_histogram.clear();
 
         arena_alloc_counter.clear();
+        type_alloc_counter.clear();
+        type_live_counter.clear();
     }
 
     [[gnu::always_inline]] inline void increase_alloc_size_counter(uint64_t alloc_size) {
-        for (uint32_t i = 0; i < kAllocBucketSize; ++i) {
-            if (alloc_size <= alloc_size_bucket.at(i)) {
-                ++alloc_size_bucket_counter.at(i);
-                break;
-            }
-        }
+        alloc_size_histogram.record(alloc_size);
     }
 
-    [[gnu::always_inline]] inline void increase_destruct_lifetime_counter(const milliseconds& destruct_lifetime) {
-        for (uint32_t i = 0; i < kLifetimeBucketSize; ++i) {
-            // TODO(longqimin): find why clang-tidy warning.
-            if (destruct_lifetime <= destruct_lifetime_bucket.at(i)) {  // NOLINT
-                ++destruct_lifetime_bucket_counter.at(i);
-                break;
-            }
+    [[gnu::always_inline]] inline void increase_destruct_lifetime_counter(const microseconds& destruct_lifetime) {
+        destruct_lifetime_histogram.record(static_cast<uint64_t>(destruct_lifetime.count()));
+    }
+
+    /*
+     * the remain of a block is wasted when it is freed or reset.
+     */
+    [[gnu::always_inline]] inline void increase_block_counter(const ArenaBlockStats& stats) {
+        ++block_count;
+        block_cleanup += stats.cleanup;
+        block_alignment_waste += stats.alignment_waste;
+        block_tail_waste += stats.remain;
+        block_size_histogram.record(stats.size);
+        if (stats.size != 0) [[likely]] {
+            block_utilization_histogram.record((stats.used + stats.cleanup) * kPercent / stats.size);
         }
     }
 
     [[gnu::always_inline]] inline void increase_arena_alloc_counter(const boost::source_location& loc, uint64_t size) {
-        const std::string key = std::string(loc.file_name()) + ":" + std::to_string(loc.line());
-        arena_alloc_counter[key] += size;
+        arena_alloc_counter.add(loc.file_name(), static_cast<uint32_t>(loc.line()), size);
     }
 
+    /*
+     * move the counters of the shard into global_arena_metrics.
+     * it is optional since the scraper reads the shards directly, but it keeps the shard small and cheap to scrape.
+     */
     void report_to_global_metrics() {
+        // begin the write section of the seqlock.
+        report_sequence.store(report_sequence.load(std::memory_order::relaxed) + 1, std::memory_order::relaxed);
+        std::atomic_thread_fence(std::memory_order::release);
+
         // only guaranteed atomicity with `relaxed` order and is enough
         global_arena_metrics.init_count.fetch_add(init_count, std::memory_order::relaxed);
         global_arena_metrics.reset_count.fetch_add(reset_count, std::memory_order::relaxed);
@@ -223,39 +676,227 @@ struct LocalArenaMetrics
         global_arena_metrics.space_used.fetch_add(space_used, std::memory_order::relaxed);
         global_arena_metrics.space_wasted.fetch_add(space_wasted, std::memory_order::relaxed);
         global_arena_metrics.space_resettled.fetch_add(space_resettled, std::memory_order::relaxed);
-        for (uint32_t i = 0; i < kAllocBucketSize; ++i) {
-            global_arena_metrics.alloc_size_bucket_counter.at(i).fetch_add(alloc_size_bucket_counter.at(i),
-                                                                           std::memory_order::relaxed);
-        }
-        for (uint32_t i = 0; i < kLifetimeBucketSize; ++i) {
-            global_arena_metrics.destruct_lifetime_bucket_counter.at(i).fetch_add(
-              destruct_lifetime_bucket_counter.at(i), std::memory_order::relaxed);
+        global_arena_metrics.space_released.fetch_add(space_released, std::memory_order::relaxed);
+        global_arena_metrics.block_count.fetch_add(block_count, std::memory_order::relaxed);
+        global_arena_metrics.block_cleanup.fetch_add(block_cleanup, std::memory_order::relaxed);
+        global_arena_metrics.block_alignment_waste.fetch_add(block_alignment_waste, std::memory_order::relaxed);
+        global_arena_metrics.block_tail_waste.fetch_add(block_tail_waste, std::memory_order::relaxed);
+        global_arena_metrics.alloc_size_histogram.merge(alloc_size_histogram);
+        global_arena_metrics.destruct_lifetime_histogram.merge(destruct_lifetime_histogram);
+        global_arena_metrics.block_size_histogram.merge(block_size_histogram);
+        global_arena_metrics.block_utilization_histogram.merge(block_utilization_histogram);
+        if (arena_alloc_counter.size() != 0 || arena_alloc_counter.overflow() != 0) {
+            std::lock_guard<std::mutex> guard(global_arena_metrics.arena_alloc_counter_mutex);
+            arena_alloc_counter.for_each([](const char* file, uint32_t line, uint64_t count) {
+                global_arena_metrics.arena_alloc_counter[std::format("{}:{}", file, line)].fetch_add(
+                  count, std::memory_order::relaxed);
+            });
+            if (arena_alloc_counter.overflow() != 0) {
+                global_arena_metrics.arena_alloc_counter["<overflow>"].fetch_add(arena_alloc_counter.overflow(),
+                                                                                 std::memory_order::relaxed);
+            }
         }
-        for (const auto& [loc, count] : arena_alloc_counter) {
-            global_arena_metrics.arena_alloc_counter[loc].fetch_add(count, std::memory_order::relaxed);
+        bool type_overflow = type_alloc_counter.overflow_count() != 0 || type_live_counter.overflow_count() != 0;
+        if (type_alloc_counter.size() != 0 || type_live_counter.size() != 0 || type_overflow) {
+            std::lock_guard<std::mutex> guard(global_arena_metrics.arena_alloc_counter_mutex);
+            type_alloc_counter.for_each([](const std::type_info* type, uint64_t count, uint64_t bytes) {
+                auto& stats = global_arena_metrics.type_counter[type];
+                stats.count += count;
+                stats.bytes += bytes;
+            });
+            type_live_counter.for_each([](const std::type_info* type, uint64_t count, uint64_t bytes) {
+                auto& stats = global_arena_metrics.type_counter[type];
+                stats.live_count += count;
+                stats.live_bytes += bytes;
+            });
+            if (type_overflow) {
+                auto& stats = global_arena_metrics.type_counter[nullptr];
+                stats.count += type_alloc_counter.overflow_count();
+                stats.bytes += type_alloc_counter.overflow_bytes();
+                stats.live_count += type_live_counter.overflow_count();
+                stats.live_bytes += type_live_counter.overflow_bytes();
+            }
         }
 
         reset();
+        // end the write section.
+        report_sequence.store(report_sequence.load(std::memory_order::relaxed) + 1, std::memory_order::release);
     };
 };
 
 extern thread_local LocalArenaMetrics local_arena_metrics;
 
-struct ArenaMetricsCookie
+/*
+ * ArenaMetricsSnapshot is a plain copy of the metrics, summed from the global metrics and the shards.
+ */
+struct ArenaMetricsSnapshot
+{
+    uint64_t init_count = 0;
+    uint64_t destruct_count = 0;
+    uint64_t alloc_count = 0;
+    uint64_t newblock_count = 0;
+    uint64_t reset_count = 0;
+    uint64_t space_allocated = 0;
+    uint64_t space_resettled = 0;
+    uint64_t space_used = 0;
+    uint64_t space_wasted = 0;
+    uint64_t space_released = 0;
+    uint64_t block_count = 0;
+    uint64_t block_cleanup = 0;
+    uint64_t block_alignment_waste = 0;
+    uint64_t block_tail_waste = 0;
+    AllocSizeHistogram<uint64_t> alloc_size_histogram;
+    LifetimeHistogram<uint64_t> destruct_lifetime_histogram;
+    AllocSizeHistogram<uint64_t> block_size_histogram;
+    UtilizationHistogram<uint64_t> block_utilization_histogram;
+    std::unordered_map<std::string, uint64_t> arena_alloc_counter = {};
+    // keyed by the demangled type name, "<raw>" for AllocateAligned, "<overflow>" for the types out of the tables.
+    std::unordered_map<std::string, TypeStats> type_counter = {};
+
+    void merge(const GlobalArenaMetrics& metrics);
+    void merge(const LocalArenaMetrics& metrics);
+
+    [[nodiscard]] auto string() const -> std::string;
+
+    /*
+     * the demangled name of the type, the same as TYPENAME.
+     */
+    [[nodiscard]] static auto type_name(const std::type_info* type) -> std::string;
+
+   private:
+    // the counters shared by GlobalArenaMetrics and LocalArenaMetrics.
+    template <typename Metrics>
+    void merge_counters(const Metrics& metrics) {
+        init_count += metrics.init_count;
+        destruct_count += metrics.destruct_count;
+        alloc_count += metrics.alloc_count;
+        newblock_count += metrics.newblock_count;
+        reset_count += metrics.reset_count;
+        space_allocated += metrics.space_allocated;
+        space_resettled += metrics.space_resettled;
+        space_used += metrics.space_used;
+        space_wasted += metrics.space_wasted;
+        space_released += metrics.space_released;
+        block_count += metrics.block_count;
+        block_cleanup += metrics.block_cleanup;
+        block_alignment_waste += metrics.block_alignment_waste;
+        block_tail_waste += metrics.block_tail_waste;
+        alloc_size_histogram.merge(metrics.alloc_size_histogram);
+        destruct_lifetime_histogram.merge(metrics.destruct_lifetime_histogram);
+        block_size_histogram.merge(metrics.block_size_histogram);
+        block_utilization_histogram.merge(metrics.block_utilization_histogram);
+    }
+};
+
+/*
+ * sum the global metrics and the shards of all living threads, the threads need not to report.
+ * a shard which is reporting concurrently is retried, so no metric is counted twice or missed.
+ */
+[[nodiscard]] auto scrape_arena_metrics() -> ArenaMetricsSnapshot;
+
+/*
+ * a live instrumented arena, the arena pointer is only for identifying, it may be destroyed after the query.
+ */
+struct LiveArenaInfo
+{
+    const Arena* arena = nullptr;
+    boost::source_location init_location;
+    steady_clock::time_point init_time_point;
+    uint64_t space_allocated = 0;
+};
+
+/*
+ * the live arena registry, for finding the leaked or long-lived arenas.
+ * they lock the shards one by one, so the arenas are never blocked for long, and the cost is O(live arenas).
+ */
+[[nodiscard]] auto live_arenas() -> std::vector<LiveArenaInfo>;
+
+/*
+ * the n largest live arenas by space_allocated, in descending order.
+ */
+[[nodiscard]] auto top_live_arenas(size_t n) -> std::vector<LiveArenaInfo>;
+
+/*
+ * the live arenas created more than age ago, from the oldest.
+ */
+[[nodiscard]] auto live_arenas_older_than(steady_clock::duration age) -> std::vector<LiveArenaInfo>;
+
+/*
+ * the cookie lives in the small cookie storage of the arena, the per-type table is too large for it, so it is on
+ * the heap.
+ */
+struct ArenaMetricsCookie : LiveArenaNode
 {
     steady_clock::time_point init_time_point;
     boost::source_location init_location;  // arena.init() source_location
-    ArenaMetricsCookie(steady_clock::time_point init_tp, const boost::source_location& init_loc)
-        : init_time_point(init_tp), init_location(init_loc) {}
+    const Arena* arena;
+    // it is written by the thread using the arena, and read by the queries of the live arenas.
+    atomic<uint64_t> space_allocated{0};
+    // the objects allocated in the arena since the last reset, to count down the live objects.
+    std::unique_ptr<TypeCounter<kArenaTypeCapacity, uint64_t>> type_counter;
+    ArenaMetricsCookie(const Arena* owner, steady_clock::time_point init_tp, const boost::source_location& init_loc)
+        : init_time_point(init_tp),
+          init_location(init_loc),
+          arena(owner),
+          type_counter(std::make_unique<TypeCounter<kArenaTypeCapacity, uint64_t>>()) {}
+
+    /*
+     * the node is not linked, the caller replaces other by it in the live arena list.
+     */
+    ArenaMetricsCookie(ArenaMetricsCookie&& other) noexcept
+        : init_time_point(other.init_time_point),
+          init_location(other.init_location),
+          arena(other.arena),
+          space_allocated(other.space_allocated.load(std::memory_order::relaxed)),
+          type_counter(std::move(other.type_counter)) {}
+
+    ArenaMetricsCookie(const ArenaMetricsCookie&) = delete;
+    auto operator=(const ArenaMetricsCookie&) -> ArenaMetricsCookie& = delete;
+    auto operator=(ArenaMetricsCookie&&) -> ArenaMetricsCookie& = delete;
+    ~ArenaMetricsCookie() = default;
+
+    /*
+     * the objects in the arena are gone by reset or destruction.
+     */
+    void free_live_objects(LocalArenaMetrics& metrics) noexcept {
+        type_counter->for_each([&metrics](const std::type_info* type, uint64_t count, uint64_t bytes) {
+            // add the wrapped negative delta.
+            metrics.type_live_counter.add(type, 0 - count, 0 - bytes);
+        });
+        metrics.type_live_counter.add_overflow(0 - type_counter->overflow_count(),
+                                               0 - type_counter->overflow_bytes());
+        type_counter->clear();
+    }
 };
 
-[[gnu::always_inline]] inline auto metrics_probe_on_arena_init([[maybe_unused]] Arena* arena,
-                                                               const boost::source_location& loc) -> void* {
+static_assert(sizeof(ArenaMetricsCookie) <= Arena::kCookieStorageSize, "ArenaMetricsCookie should fit in Arena");
+static_assert(alignof(ArenaMetricsCookie) <= kInt128Size, "ArenaMetricsCookie should fit in Arena");
+
+/*
+ * the cookie is constructed in the cookie storage of the arena, only its per-type table is allocated.
+ */
+[[gnu::always_inline]] inline auto metrics_probe_on_arena_init(Arena* arena, const boost::source_location& loc)
+  -> void* {
     ++local_arena_metrics.init_count;
-    auto* cookie = new ArenaMetricsCookie(steady_clock::now(), loc);
+    auto* cookie = new (arena->cookie_storage()) ArenaMetricsCookie(arena, steady_clock::now(), loc);
+    local_arena_metrics.live_arenas.link(cookie);
     return cookie;
 }
-[[gnu::always_inline]] inline void metrics_probe_on_arena_allocation([[maybe_unused]] const std::type_info* alloc_type,
+
+/*
+ * call func(shard) with the lock of the live arena shard of the cookie held.
+ */
+template <typename Func>
+void with_live_arena_shard(ArenaMetricsCookie* cookie, Func&& func) {
+    // only the owner thread moves its arenas to the orphans, so the shard of current thread is stable.
+    LiveArenaShard* shard = cookie->shard.load(std::memory_order::relaxed);
+    if (shard == &local_arena_metrics.live_arenas) [[likely]] {
+        shard->with_lock([&] { func(*shard); });
+        return;
+    }
+    arena_metrics_registry.with_live_arena_shard(cookie, std::forward<Func>(func));
+}
+[[gnu::always_inline]] inline void metrics_probe_on_arena_allocation(const std::type_info* alloc_type,
                                                                      uint64_t alloc_size, void* cookie) {
     ++local_arena_metrics.alloc_count;
     local_arena_metrics.space_allocated += alloc_size;
@@ -263,30 +904,77 @@ struct ArenaMetricsCookie
 
     auto* cki = static_cast<ArenaMetricsCookie*>(cookie);
     local_arena_metrics.increase_arena_alloc_counter(cki->init_location, alloc_size);
+
+    const std::type_info* type = alloc_type == nullptr ? &typeid(void) : alloc_type;
+    local_arena_metrics.type_alloc_counter.add(type, 1, alloc_size);
+    // the objects overflowed the arena are counted down by its overflow bucket, so they are live in the overflow.
+    if (cki->type_counter->add(type, 1, alloc_size)) [[likely]] {
+        local_arena_metrics.type_live_counter.add(type, 1, alloc_size);
+    } else {
+        local_arena_metrics.type_live_counter.add_overflow(1, alloc_size);
+    }
 }
 [[gnu::always_inline]] inline void metrics_probe_on_arena_newblock([[maybe_unused]] uint64_t blk_num,
-                                                                   [[maybe_unused]] uint64_t blk_size,
-                                                                   [[maybe_unused]] void* cookie) {
+                                                                   uint64_t blk_size, void* cookie) {
     ++local_arena_metrics.newblock_count;
+    auto* cki = static_cast<ArenaMetricsCookie*>(cookie);
+    // single writer, no read-modify-write is needed.
+    cki->space_allocated.store(cki->space_allocated.load(std::memory_order::relaxed) + blk_size,
+                               std::memory_order::relaxed);
 }
-[[gnu::always_inline]] inline void metrics_probe_on_arena_reset([[maybe_unused]] Arena* arena,
-                                                                [[maybe_unused]] void* cookie, uint64_t space_used,
-                                                                uint64_t space_wasted) {
+[[gnu::always_inline]] inline void metrics_probe_on_arena_block(const ArenaBlockStats& stats,
+                                                                [[maybe_unused]] void* cookie) {
+    local_arena_metrics.increase_block_counter(stats);
+}
+[[gnu::always_inline]] inline void metrics_probe_on_arena_reset(Arena* arena, void* cookie, uint64_t space_used,
+                                                                uint64_t space_wasted, uint64_t space_released) {
     ++local_arena_metrics.reset_count;
+    auto* cki = static_cast<ArenaMetricsCookie*>(cookie);
+    cki->free_live_objects(local_arena_metrics);
+    cki->space_allocated.store(arena->SpaceAllocated(), std::memory_order::relaxed);
     local_arena_metrics.space_resettled += space_used;
     local_arena_metrics.space_wasted += space_wasted;
+    local_arena_metrics.space_released += space_released;
 }
 [[gnu::always_inline]] inline auto metrics_probe_on_arena_destruction([[maybe_unused]] Arena* arena, void* cookie,
                                                                       uint64_t space_used, uint64_t space_wasted)
   -> void* {
+    // a moved-from arena has no cookie, it is counted by the arena it was moved into.
+    if (cookie == nullptr) [[unlikely]] {
+        return nullptr;
+    }
     ++local_arena_metrics.destruct_count;
     local_arena_metrics.space_used += space_used;
     local_arena_metrics.space_wasted += space_wasted;
 
-    std::unique_ptr<ArenaMetricsCookie> ck_unique_ptr(static_cast<ArenaMetricsCookie*>(cookie));
-    auto destruct_lifetime = steady_clock::now() - ck_unique_ptr->init_time_point;
-    local_arena_metrics.increase_destruct_lifetime_counter(std::chrono::duration_cast<milliseconds>(destruct_lifetime));
+    auto* cki = static_cast<ArenaMetricsCookie*>(cookie);
+    with_live_arena_shard(cki, [cki](LiveArenaShard& /*unused*/) { LiveArenaShard::unlink_locked(cki); });
+    cki->free_live_objects(local_arena_metrics);
+    auto destruct_lifetime = steady_clock::now() - cki->init_time_point;
+    local_arena_metrics.increase_destruct_lifetime_counter(std::chrono::duration_cast<microseconds>(destruct_lifetime));
+    // the storage is a part of the arena, just destroy the cookie.
+    cki->~ArenaMetricsCookie();
     return nullptr;
 }
 
+/*
+ * move the cookie into the storage of the moved arena, and replace the old node by it in the live arena list.
+ */
+[[gnu::always_inline]] inline void metrics_probe_on_arena_move(Arena* arena, void* cookie, void* old_cookie) {
+    auto* old_cki = static_cast<ArenaMetricsCookie*>(old_cookie);
+    with_live_arena_shard(old_cki, [cookie, old_cki, arena](LiveArenaShard& /*unused*/) {
+        auto* cki = old_cki;
+        if (cookie != old_cki) {
+            cki = new (cookie) ArenaMetricsCookie(std::move(*old_cki));
+            cki->prev = old_cki->prev;
+            cki->next = old_cki->next;
+            cki->prev->next = cki;
+            cki->next->prev = cki;
+            cki->shard.store(old_cki->shard.load(std::memory_order::relaxed), std::memory_order::relaxed);
+            old_cki->~ArenaMetricsCookie();
+        }
+        cki->arena = arena;
+    });
+}
+
 }  // namespace stdb::memory
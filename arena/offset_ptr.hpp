@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <compare>      // for strong_ordering
+#include <cstddef>      // for ptrdiff_t, nullptr_t
+#include <cstdint>      // for intptr_t
+#include <iterator>     // for random_access_iterator_tag
+#include <memory>       // for pointer_traits
+#include <type_traits>  // for add_lvalue_reference, remove_cv
+
+namespace stdb::memory {
+
+/*
+ * arena_offset_ptr is a self-relative pointer, it stores the distance from its own address to the pointee
+ * instead of the absolute address.
+ *
+ * an object graph which is linked by arena_offset_ptr only, and is placed in a single continuous region
+ * (a mapped file, a shared memory segment, or a single-block Arena), is position independent: the region can be
+ * memcpy-ed, snapshotted or mapped at a different address in another process, and be used without any fix-up.
+ *
+ * NOTICE:
+ * copy an arena_offset_ptr will re-compute the offset against the new address, so it is not trivially copyable,
+ * but it is trivially destructible, so a struct holding it can still be Create-ed in Arena without cleanup.
+ * the pointee must live in the same region as the arena_offset_ptr itself, or the region is not relocatable.
+ * std::pmr containers hold raw pointers inside, they are not relocatable even they were placed in the region.
+ */
+template <typename T>
+class arena_offset_ptr
+{
+    // offset 1 means nullptr, a pointer can not point to the second byte of itself.
+    static constexpr std::ptrdiff_t kNullOffset = 1;
+
+   public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using pointer = T*;
+    using reference = std::add_lvalue_reference_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::random_access_iterator_tag;
+
+    template <typename U>
+    using rebind = arena_offset_ptr<U>;
+
+    arena_offset_ptr() noexcept = default;
+
+    arena_offset_ptr(std::nullptr_t /*unused*/) noexcept {}  // NOLINT(google-explicit-constructor)
+
+    arena_offset_ptr(T* ptr) noexcept { set(ptr); }  // NOLINT(google-explicit-constructor)
+
+    arena_offset_ptr(const arena_offset_ptr& other) noexcept { set(other.get()); }
+
+    template <typename U>
+        requires std::is_convertible_v<U*, T*>
+    arena_offset_ptr(const arena_offset_ptr<U>& other) noexcept {  // NOLINT(google-explicit-constructor)
+        set(static_cast<T*>(other.get()));
+    }
+
+    auto operator=(const arena_offset_ptr& other) noexcept -> arena_offset_ptr& {
+        if (this != &other) [[likely]] {
+            set(other.get());
+        }
+        return *this;
+    }
+
+    auto operator=(T* ptr) noexcept -> arena_offset_ptr& {
+        set(ptr);
+        return *this;
+    }
+
+    auto operator=(std::nullptr_t /*unused*/) noexcept -> arena_offset_ptr& {
+        _offset = kNullOffset;
+        return *this;
+    }
+
+    ~arena_offset_ptr() = default;
+
+    /*
+     * get the raw pointer, it is only valid in current mapping of the region.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto get() const noexcept -> T* {
+        if (_offset == kNullOffset) {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + _offset);  // NOLINT
+    }
+
+    /*
+     * the raw offset from this to the pointee, just for testing and debugging.
+     */
+    [[nodiscard, gnu::always_inline]] inline auto offset() const noexcept -> std::ptrdiff_t { return _offset; }
+
+    [[nodiscard, gnu::always_inline]] inline explicit operator bool() const noexcept { return _offset != kNullOffset; }
+
+    [[nodiscard, gnu::always_inline]] inline auto operator->() const noexcept -> T* { return get(); }
+
+    template <typename U = T>
+        requires(!std::is_void_v<U>)
+    [[nodiscard, gnu::always_inline]] inline auto operator*() const noexcept -> U& {
+        return *get();
+    }
+
+    template <typename U = T>
+        requires(!std::is_void_v<U>)
+    [[nodiscard, gnu::always_inline]] inline auto operator[](difference_type idx) const noexcept -> U& {
+        return get()[idx];  // NOLINT
+    }
+
+    /*
+     * for std::pointer_traits, make arena_offset_ptr could be used as a fancy pointer of an allocator.
+     */
+    template <typename U = T>
+        requires(!std::is_void_v<U>)
+    [[nodiscard]] static auto pointer_to(U& ref) noexcept -> arena_offset_ptr {
+        return arena_offset_ptr(std::addressof(ref));
+    }
+
+    auto operator+=(difference_type n) noexcept -> arena_offset_ptr& {
+        _offset += n * static_cast<difference_type>(sizeof(T));
+        return *this;
+    }
+
+    auto operator-=(difference_type n) noexcept -> arena_offset_ptr& {
+        _offset -= n * static_cast<difference_type>(sizeof(T));
+        return *this;
+    }
+
+    auto operator++() noexcept -> arena_offset_ptr& { return *this += 1; }
+
+    auto operator--() noexcept -> arena_offset_ptr& { return *this -= 1; }
+
+    auto operator++(int) noexcept -> arena_offset_ptr {
+        arena_offset_ptr tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    auto operator--(int) noexcept -> arena_offset_ptr {
+        arena_offset_ptr tmp(*this);
+        --*this;
+        return tmp;
+    }
+
+    [[nodiscard]] friend auto operator+(const arena_offset_ptr& ptr, difference_type n) noexcept
+      -> arena_offset_ptr {
+        return arena_offset_ptr(ptr.get() + n);  // NOLINT
+    }
+
+    [[nodiscard]] friend auto operator-(const arena_offset_ptr& ptr, difference_type n) noexcept
+      -> arena_offset_ptr {
+        return arena_offset_ptr(ptr.get() - n);  // NOLINT
+    }
+
+    [[nodiscard]] friend auto operator-(const arena_offset_ptr& lhs, const arena_offset_ptr& rhs) noexcept
+      -> difference_type {
+        return lhs.get() - rhs.get();
+    }
+
+    [[nodiscard]] friend auto operator==(const arena_offset_ptr& lhs, const arena_offset_ptr& rhs) noexcept -> bool {
+        return lhs.get() == rhs.get();
+    }
+
+    [[nodiscard]] friend auto operator==(const arena_offset_ptr& lhs, std::nullptr_t /*unused*/) noexcept -> bool {
+        return lhs._offset == kNullOffset;
+    }
+
+    [[nodiscard]] friend auto operator<=>(const arena_offset_ptr& lhs, const arena_offset_ptr& rhs) noexcept
+      -> std::strong_ordering {
+        return lhs.get() <=> rhs.get();
+    }
+
+   private:
+    [[gnu::always_inline]] inline void set(T* ptr) noexcept {
+        if (ptr == nullptr) {
+            _offset = kNullOffset;
+        } else {
+            // NOLINTNEXTLINE
+            _offset = reinterpret_cast<std::intptr_t>(ptr) - reinterpret_cast<std::intptr_t>(this);
+        }
+    }
+
+    std::ptrdiff_t _offset{kNullOffset};
+};
+
+}  // namespace stdb::memory
+
+/*
+ * pointer_traits for arena_offset_ptr, std::to_address and the allocator_traits depend on it.
+ */
+template <typename T>
+struct std::pointer_traits<stdb::memory::arena_offset_ptr<T>>
+{
+    using pointer = stdb::memory::arena_offset_ptr<T>;
+    using element_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    template <typename U>
+    using rebind = stdb::memory::arena_offset_ptr<U>;
+
+    template <typename U = T>
+        requires(!std::is_void_v<U>)
+    [[nodiscard]] static auto pointer_to(U& ref) noexcept -> pointer {
+        return pointer::pointer_to(ref);
+    }
+
+    [[nodiscard]] static auto to_address(const pointer& ptr) noexcept -> T* { return ptr.get(); }
+};
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "open_metrics.hpp"
+
+#include <cstdint>      // for uint64_t
+#include <format>       // for format_to
+#include <iterator>     // for back_inserter
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+namespace stdb::memory {
+
+namespace {
+
+/*
+ * escape the label value, backslash, double-quote and line feed should be escaped.
+ */
+auto escape_label(std::string_view value) -> std::string {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char chr : value) {
+        switch (chr) {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += chr;
+        }
+    }
+    return escaped;
+}
+
+void append_counter(std::string& out, std::string_view prefix, std::string_view name, std::string_view unit,
+                    std::string_view help, uint64_t value) {
+    auto inserter = std::back_inserter(out);
+    std::format_to(inserter, "# TYPE {}_{} counter\n", prefix, name);
+    if (not unit.empty()) {
+        std::format_to(inserter, "# UNIT {}_{} {}\n", prefix, name, unit);
+    }
+    std::format_to(inserter, "# HELP {}_{} {}\n{}_{}_total {}\n", prefix, name, help, prefix, name, value);
+}
+
+/*
+ * the le of a bucket is the max value of it, and scaled by divisor to the base unit.
+ * the last bucket holds the clamped values too, so it has no finite le and is counted by +Inf only.
+ */
+template <typename Histogram>
+void append_histogram(std::string& out, std::string_view prefix, std::string_view name, std::string_view unit,
+                      std::string_view help, const Histogram& histogram, double divisor) {
+    auto inserter = std::back_inserter(out);
+    std::format_to(inserter, "# TYPE {0}_{1} histogram\n# UNIT {0}_{1} {2}\n# HELP {0}_{1} {3}\n", prefix, name, unit,
+                   help);
+    uint64_t cumulative = 0;
+    for (uint32_t idx = 0; idx + 1 < Histogram::kBucketCount; ++idx) {
+        uint64_t count = histogram.count(idx);
+        if (count == 0) {
+            continue;
+        }
+        cumulative += count;
+        auto le = static_cast<double>(Histogram::bucket_upper(idx) - 1) / divisor;
+        std::format_to(inserter, "{}_{}_bucket{{le=\"{}\"}} {}\n", prefix, name, le, cumulative);
+    }
+    cumulative += histogram.count(Histogram::kBucketCount - 1);
+    std::format_to(inserter, "{0}_{1}_bucket{{le=\"+Inf\"}} {2}\n{0}_{1}_count {2}\n{0}_{1}_sum {3}\n", prefix, name,
+                   cumulative, static_cast<double>(histogram.sum()) / divisor);
+}
+
+}  // namespace
+
+auto to_open_metrics(const ArenaMetricsSnapshot& snapshot, std::string_view prefix) -> std::string {
+    constexpr uint64_t kReserveSize = 4096;
+    constexpr double kMicrosecondsPerSecond = 1e6;
+    std::string out;
+    out.reserve(kReserveSize);
+
+    append_counter(out, prefix, "init", "", "Arenas constructed.", snapshot.init_count);
+    append_counter(out, prefix, "destruct", "", "Arenas destructed.", snapshot.destruct_count);
+    append_counter(out, prefix, "reset", "", "Arena resets.", snapshot.reset_count);
+    append_counter(out, prefix, "alloc", "", "Allocations in arenas.", snapshot.alloc_count);
+    append_counter(out, prefix, "newblock", "", "Blocks allocated by arenas.", snapshot.newblock_count);
+    append_counter(out, prefix, "space_allocated_bytes", "bytes", "Bytes allocated in arenas.",
+                   snapshot.space_allocated);
+    append_counter(out, prefix, "space_used_bytes", "bytes", "Bytes held by arenas at destruction.",
+                   snapshot.space_used);
+    append_counter(out, prefix, "space_wasted_bytes", "bytes", "Bytes unused in blocks at reset and destruction.",
+                   snapshot.space_wasted);
+    append_counter(out, prefix, "space_resettled_bytes", "bytes", "Bytes held by arenas at reset.",
+                   snapshot.space_resettled);
+    append_counter(out, prefix, "space_released_bytes", "bytes", "Bytes given back to the kernel at reset.",
+                   snapshot.space_released);
+    append_counter(out, prefix, "block", "", "Blocks freed or reset.", snapshot.block_count);
+    append_counter(out, prefix, "block_cleanup_bytes", "bytes", "Bytes of cleanup nodes in freed or reset blocks.",
+                   snapshot.block_cleanup);
+    append_counter(out, prefix, "block_alignment_waste_bytes", "bytes",
+                   "Bytes of alignment padding in freed or reset blocks.", snapshot.block_alignment_waste);
+    append_counter(out, prefix, "block_tail_waste_bytes", "bytes", "Bytes never allocated in freed or reset blocks.",
+                   snapshot.block_tail_waste);
+
+    append_histogram(out, prefix, "alloc_size_bytes", "bytes", "Size of allocations in arenas.",
+                     snapshot.alloc_size_histogram, 1.0);
+    append_histogram(out, prefix, "lifetime_seconds", "seconds", "Lifetime of arenas.",
+                     snapshot.destruct_lifetime_histogram, kMicrosecondsPerSecond);
+    append_histogram(out, prefix, "block_size_bytes", "bytes", "Size of freed or reset blocks.",
+                     snapshot.block_size_histogram, 1.0);
+    append_histogram(out, prefix, "block_utilization_ratio", "ratio", "Utilization of freed or reset blocks.",
+                     snapshot.block_utilization_histogram, static_cast<double>(kPercent));
+
+    auto inserter = std::back_inserter(out);
+    std::format_to(inserter,
+                   "# TYPE {0}_site_alloc_bytes counter\n# UNIT {0}_site_alloc_bytes bytes\n"
+                   "# HELP {0}_site_alloc_bytes Bytes allocated by the arenas of a construction site.\n",
+                   prefix);
+    for (const auto& [site, bytes] : snapshot.arena_alloc_counter) {
+        // the site is "file:line", or "<overflow>".
+        std::string_view site_view = site;
+        auto colon = site_view.rfind(':');
+        std::string_view file = colon == std::string_view::npos ? site_view : site_view.substr(0, colon);
+        std::string_view line = colon == std::string_view::npos ? "" : site_view.substr(colon + 1);
+        std::format_to(inserter, "{}_site_alloc_bytes_total{{file=\"{}\",line=\"{}\"}} {}\n", prefix,
+                       escape_label(file), escape_label(line), bytes);
+    }
+
+    std::format_to(inserter,
+                   "# TYPE {0}_type_alloc counter\n"
+                   "# HELP {0}_type_alloc Allocations in arenas by type.\n",
+                   prefix);
+    for (const auto& [type, stats] : snapshot.type_counter) {
+        std::format_to(inserter, "{}_type_alloc_total{{type=\"{}\"}} {}\n", prefix, escape_label(type), stats.count);
+    }
+    std::format_to(inserter,
+                   "# TYPE {0}_type_alloc_bytes counter\n# UNIT {0}_type_alloc_bytes bytes\n"
+                   "# HELP {0}_type_alloc_bytes Bytes allocated in arenas by type.\n",
+                   prefix);
+    for (const auto& [type, stats] : snapshot.type_counter) {
+        std::format_to(inserter, "{}_type_alloc_bytes_total{{type=\"{}\"}} {}\n", prefix, escape_label(type),
+                       stats.bytes);
+    }
+    std::format_to(inserter,
+                   "# TYPE {0}_type_live_objects gauge\n"
+                   "# HELP {0}_type_live_objects Objects in arenas not reset or destructed yet by type.\n",
+                   prefix);
+    for (const auto& [type, stats] : snapshot.type_counter) {
+        std::format_to(inserter, "{}_type_live_objects{{type=\"{}\"}} {}\n", prefix, escape_label(type),
+                       stats.live_count);
+    }
+    std::format_to(inserter,
+                   "# TYPE {0}_type_live_bytes gauge\n# UNIT {0}_type_live_bytes bytes\n"
+                   "# HELP {0}_type_live_bytes Bytes in arenas not reset or destructed yet by type.\n",
+                   prefix);
+    for (const auto& [type, stats] : snapshot.type_counter) {
+        std::format_to(inserter, "{}_type_live_bytes{{type=\"{}\"}} {}\n", prefix, escape_label(type),
+                       stats.live_bytes);
+    }
+
+    out += "# EOF\n";
+    return out;
+}
+
+}  // namespace stdb::memory
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+#include "metrics.hpp"  // for ArenaMetricsSnapshot
+
+namespace stdb::memory {
+
+/*
+ * render the arena metrics in the OpenMetrics text format (https://openmetrics.io), for a Prometheus scraper.
+ *
+ * the counters are exported as <prefix>_<name>_total, the histograms as cumulative <prefix>_<name>_bucket series
+ * with only the non-empty buckets and +Inf, the per call-site alloc bytes with the file and line labels, and the
+ * per-type counters and live gauges with the demangled type label.
+ * it works on a snapshot, so the allocating threads are never blocked, use it as:
+ *     auto text = to_open_metrics(scrape_arena_metrics());
+ */
+[[nodiscard]] auto to_open_metrics(const ArenaMetricsSnapshot& snapshot, std::string_view prefix = "stdb_arena")
+  -> std::string;
+
+}  // namespace stdb::memory
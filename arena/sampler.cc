@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "sampler.hpp"
+
+#include <boost/core/demangle.hpp>  // for demangle
+#include <cmath>                    // for exp
+#include <cstdint>                  // for uint64_t, uintptr_t
+#include <format>                   // for format_to
+#include <fstream>                  // for ifstream
+#include <iterator>                 // for back_inserter, istreambuf_iterator
+#include <map>                      // for map
+#include <mutex>                    // for lock_guard
+#include <string>                   // for string
+#include <tuple>                    // for get
+#include <typeindex>                // for type_index
+#include <typeinfo>                 // for type_info
+#include <utility>                  // for pair
+
+namespace stdb::memory {
+
+ArenaAllocationProfile arena_allocation_profile;
+
+namespace {
+
+/*
+ * an allocation of size is sampled with probability 1 - exp(-size / interval), scale the sampled bytes back.
+ */
+auto unsample_scale(const ArenaAllocationProfile::Entry& entry) -> double {
+    if (entry.count == 0 || entry.interval == 0) [[unlikely]] {
+        return 1.0;
+    }
+    double average = static_cast<double>(entry.bytes) / static_cast<double>(entry.count);
+    return 1.0 / (1.0 - std::exp(-average / static_cast<double>(entry.interval)));
+}
+
+/*
+ * the interval shared by all entries, 0 if they are sampled with different intervals.
+ */
+template <typename Entries>
+auto common_interval(const Entries& entries) -> uint64_t {
+    uint64_t interval = entries.empty() ? 0 : entries.begin()->second.interval;
+    for (const auto& [_, entry] : entries) {
+        if (entry.interval != interval) {
+            return 0;
+        }
+    }
+    return interval;
+}
+
+auto type_name(const std::type_index& type) -> std::string {
+    return type == std::type_index(typeid(void)) ? "<raw>" : boost::core::demangle(type.name());
+}
+
+}  // namespace
+
+void ArenaAllocationProfile::add(const ArenaAllocationSample& sample) {
+    Stack stack;
+    stack.reserve(sample.depth);
+    for (uint32_t i = 0; i < sample.depth; ++i) {
+        stack.push_back(reinterpret_cast<uintptr_t>(sample.stack[i]));  // NOLINT
+    }
+    std::type_index type = sample.type == nullptr ? std::type_index(typeid(void)) : std::type_index(*sample.type);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto& entry = _entries[{type, std::move(stack), sample.interval}];
+    entry.interval = sample.interval;
+    ++entry.count;
+    entry.bytes += sample.size;
+}
+
+void ArenaAllocationProfile::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+}
+
+auto ArenaAllocationProfile::size() const -> size_t {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+auto ArenaAllocationProfile::estimated_bytes() const -> uint64_t {
+    std::lock_guard<std::mutex> lock(_mutex);
+    double total = 0;
+    for (const auto& [_, entry] : _entries) {
+        total += static_cast<double>(entry.bytes) * unsample_scale(entry);
+    }
+    return static_cast<uint64_t>(total);
+}
+
+auto ArenaAllocationProfile::to_pprof() const -> std::string {
+    std::string out;
+    auto inserter = std::back_inserter(out);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint64_t interval = common_interval(_entries);
+        // the sampled count and bytes of an entry, or the estimated ones if pprof cannot unsample them.
+        auto columns = [interval](const Entry& entry) -> std::pair<uint64_t, uint64_t> {
+            if (interval != 0) [[likely]] {
+                return {entry.count, entry.bytes};
+            }
+            double scale = unsample_scale(entry);
+            return {static_cast<uint64_t>(static_cast<double>(entry.count) * scale),
+                    static_cast<uint64_t>(static_cast<double>(entry.bytes) * scale)};
+        };
+        uint64_t total_count = 0;
+        uint64_t total_bytes = 0;
+        for (const auto& [_, entry] : _entries) {
+            auto [count, bytes] = columns(entry);
+            total_count += count;
+            total_bytes += bytes;
+        }
+        std::format_to(inserter, "heap profile: {:6}: {:8} [{:6}: {:8}] @ heap_v2/{}\n", total_count, total_bytes,
+                       total_count, total_bytes, interval == 0 ? 1 : interval);
+        for (const auto& [key, entry] : _entries) {
+            auto [count, bytes] = columns(entry);
+            std::format_to(inserter, "{:6}: {:8} [{:6}: {:8}] @", count, bytes, count, bytes);
+            for (uintptr_t address : std::get<1>(key)) {
+                std::format_to(inserter, " 0x{:x}", address);
+            }
+            out += '\n';
+        }
+    }
+    // pprof maps the addresses to the binaries by the mapped libraries.
+    out += "\nMAPPED_LIBRARIES:\n";
+    std::ifstream maps("/proc/self/maps");
+    if (maps.is_open()) [[likely]] {
+        out.append(std::istreambuf_iterator<char>(maps), std::istreambuf_iterator<char>());
+    }
+    return out;
+}
+
+auto ArenaAllocationProfile::string() const -> std::string {
+    std::map<std::string, std::pair<double, double>> types;
+    uint64_t interval = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        interval = common_interval(_entries);
+        for (const auto& [key, entry] : _entries) {
+            double scale = unsample_scale(entry);
+            auto& [count, bytes] = types[type_name(std::get<0>(key))];
+            count += static_cast<double>(entry.count) * scale;
+            bytes += static_cast<double>(entry.bytes) * scale;
+        }
+    }
+    std::string str = interval == 0 && !types.empty()
+                        ? std::string("Sampled Allocations (interval: mixed):")
+                        : std::format("Sampled Allocations (interval: {}B):", interval);
+    for (const auto& [name, estimated] : types) {
+        str += std::format("\n  {}: count {} bytes {}", name, static_cast<uint64_t>(estimated.first),
+                           static_cast<uint64_t>(estimated.second));
+    }
+    return str;
+}
+
+}  // namespace stdb::memory
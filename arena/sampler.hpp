@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t, uintptr_t
+#include <map>        // for map
+#include <mutex>      // for mutex, lock_guard
+#include <string>     // for string
+#include <tuple>      // for tuple, get
+#include <typeindex>  // for type_index
+#include <vector>     // for vector
+
+#include "arena.hpp"  // for ArenaAllocationSample
+
+namespace stdb::memory {
+
+/*
+ * ArenaAllocationProfile collects the sampled allocations of the arenas, grouped by the type and the stack trace.
+ * it is the heap profiler of the arenas like tcmalloc's, for finding the code paths which inflate the arenas:
+ *     ops.sample_interval = 512 * kKiloByte;
+ *     ops.on_arena_sample = &sampler_probe_on_arena_sample;
+ *     ... run the workload ...
+ *     auto text = arena_allocation_profile.to_pprof();
+ * and analyze it offline with `pprof -sample_index=alloc_space <binary> <profile>`.
+ *
+ * the sampling is only on the allocating threads, it is thread-safe but guarded by a mutex, so the interval should
+ * be large enough, such as hundreds of KB.
+ */
+class ArenaAllocationProfile
+{
+   public:
+    struct Entry
+    {
+        uint64_t count = 0;     // the sampled count.
+        uint64_t bytes = 0;     // the sampled bytes.
+        uint64_t interval = 0;  // the sample interval of the arenas, the entries are split by it.
+    };
+
+    using Stack = std::vector<uintptr_t>;
+
+    void add(const ArenaAllocationSample& sample);
+
+    void clear();
+
+    /*
+     * the number of distinct (type, stack).
+     */
+    [[nodiscard]] auto size() const -> size_t;
+
+    /*
+     * visit the entries by fn(const std::type_info& type, const Stack& stack, const Entry& entry),
+     * the type of the raw allocations is typeid(void).
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& [key, entry] : _entries) {
+            fn(std::get<0>(key), std::get<1>(key), entry);
+        }
+    }
+
+    /*
+     * the estimated bytes allocated in total, the sampled bytes are scaled by the probability of being sampled.
+     */
+    [[nodiscard]] auto estimated_bytes() const -> uint64_t;
+
+    /*
+     * render the profile in the legacy heap profile format of gperftools (heap_v2), which is supported by pprof.
+     * the arenas free the objects all at once, so the in-use and the allocated columns are the same cumulative
+     * allocations, and the mapped libraries of the process are appended for the offline symbolization.
+     * the header has one interval only, if the arenas sampled with different intervals, the entries are unsampled
+     * here and the interval is 1, which pprof does not scale.
+     */
+    [[nodiscard]] auto to_pprof() const -> std::string;
+
+    /*
+     * the estimated count and bytes per type, for human reading.
+     */
+    [[nodiscard]] auto string() const -> std::string;
+
+   private:
+    mutable std::mutex _mutex;
+    // keyed by (type, stack, interval).
+    std::map<std::tuple<std::type_index, Stack, uint64_t>, Entry> _entries;
+};
+
+extern ArenaAllocationProfile arena_allocation_profile;
+
+[[gnu::always_inline]] inline void sampler_probe_on_arena_sample(const ArenaAllocationSample& sample,
+                                                                 [[maybe_unused]] void* cookie) {
+    arena_allocation_profile.add(sample);
+}
+
+}  // namespace stdb::memory
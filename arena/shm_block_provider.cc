@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "arena/shm_block_provider.hpp"
+
+#include <fcntl.h>     // for O_CREAT, O_RDWR
+#include <sys/mman.h>  // for mmap, munmap, memfd_create, shm_open
+#include <unistd.h>    // for close, ftruncate
+
+#include <algorithm>  // for max, min
+#include <array>      // for array
+#include <bit>        // for countr_zero, popcount
+#include <cstdint>    // for uintptr_t
+#include <format>     // for format
+#include <new>        // for placement new, nothrow
+
+#include "align/align.hpp"  // for AlignUp
+
+namespace stdb::memory {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the bitmap in shared memory requires lock-free atomic");
+
+namespace {
+constexpr uint64_t kShmProviderMagic = 0x5354'4442'5348'4d31ULL;  // "STDBSHM1"
+
+constexpr auto run_mask(uint64_t run) noexcept -> uint64_t {
+    return run >= ShmBlockProvider::kBitsPerWord ? ~0ULL : ((1ULL << run) - 1);
+}
+
+/*
+ * find the lowest position of `run` continuous zero bits in word, return kBitsPerWord if not found.
+ */
+auto find_free_run(uint64_t word, uint64_t run) noexcept -> uint64_t {
+    uint64_t free = ~word;
+    uint64_t candidates = free;
+    // candidates' bit p is set only if free bits [p, p + run) are all set.
+    for (uint64_t i = 1; i < run && candidates != 0; ++i) {
+        candidates &= free >> i;
+    }
+    return candidates == 0 ? ShmBlockProvider::kBitsPerWord : static_cast<uint64_t>(std::countr_zero(candidates));
+}
+}  // namespace
+
+auto ShmBlockProvider::region_size_of(uint64_t block_size, uint64_t block_num) noexcept -> uint64_t {
+    uint64_t word_num = (block_num + kBitsPerWord - 1) / kBitsPerWord;
+    uint64_t meta_size = sizeof(Header) + (word_num * sizeof(uint64_t)) + block_num;
+    return align::AlignUp(meta_size, kRegionAlignment) + (block_size * block_num);
+}
+
+void ShmBlockProvider::layout() noexcept {
+    auto* base = reinterpret_cast<char*>(_header);                                   // NOLINT
+    _bitmap = reinterpret_cast<std::atomic<uint64_t>*>(base + sizeof(Header));         // NOLINT
+    _run_length = reinterpret_cast<uint8_t*>(_bitmap + words());                      // NOLINT
+    _blocks = base + (_region_size - (_block_size * _block_num));                      // NOLINT
+}
+
+auto ShmBlockProvider::map_region(int fd, uint64_t region_size, bool init, uint64_t block_size,
+                                  uint64_t block_num) noexcept -> std::unique_ptr<ShmBlockProvider> {
+    void* mem = ::mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) [[unlikely]] {
+        ::close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<ShmBlockProvider> provider(new (std::nothrow) ShmBlockProvider());
+    if (provider == nullptr) [[unlikely]] {
+        ::munmap(mem, region_size);
+        ::close(fd);
+        return nullptr;
+    }
+    provider->_fd = fd;
+    provider->_region_size = region_size;
+    provider->_header = static_cast<Header*>(mem);
+    if (init) {
+        // the memory of a fresh shm is zero filled, so all blocks are free.
+        new (mem) Header{.magic = kShmProviderMagic,
+                         .block_size = block_size,
+                         .block_num = block_num,
+                         .region_size = region_size,
+                         .hint{0}};
+    } else if (provider->_header->magic != kShmProviderMagic) [[unlikely]] {
+        // the destructor will unmap the region.
+        return nullptr;
+    }
+    provider->_block_size = provider->_header->block_size;
+    provider->_block_num = provider->_header->block_num;
+    provider->layout();
+    if (init) {
+        // mark the tail bits of the last word as used, they have no blocks.
+        if (uint64_t tail = block_num % kBitsPerWord; tail != 0) {
+            provider->_bitmap[provider->words() - 1].store(~run_mask(tail), std::memory_order::release);  // NOLINT
+        }
+    }
+    return provider;
+}
+
+auto ShmBlockProvider::Create(uint64_t block_size, uint64_t block_num) noexcept -> std::unique_ptr<ShmBlockProvider> {
+    if (block_size == 0 || block_num == 0 || block_size % kByteSize != 0) [[unlikely]] {
+        return nullptr;
+    }
+    uint64_t region_size = region_size_of(block_size, block_num);
+#if defined(__linux__)
+    int fd = ::memfd_create("stdb-arena-shm", MFD_CLOEXEC);
+    if (fd < 0) [[unlikely]] {
+        return nullptr;
+    }
+#else
+    // without memfd, create a named shm, and unlink it at once.
+    auto name = std::format("/stdb-arena-shm-{}-{}", ::getpid(), reinterpret_cast<uintptr_t>(&region_size));
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) [[unlikely]] {
+        return nullptr;
+    }
+    ::shm_unlink(name.c_str());
+#endif
+    if (::ftruncate(fd, static_cast<off_t>(region_size)) != 0) [[unlikely]] {
+        ::close(fd);
+        return nullptr;
+    }
+    return map_region(fd, region_size, true, block_size, block_num);
+}
+
+auto ShmBlockProvider::CreateNamed(const std::string& name, uint64_t block_size, uint64_t block_num) noexcept
+  -> std::unique_ptr<ShmBlockProvider> {
+    if (block_size == 0 || block_num == 0 || block_size % kByteSize != 0) [[unlikely]] {
+        return nullptr;
+    }
+    uint64_t region_size = region_size_of(block_size, block_num);
+    int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) [[unlikely]] {
+        return nullptr;
+    }
+    if (::ftruncate(fd, static_cast<off_t>(region_size)) != 0) [[unlikely]] {
+        ::close(fd);
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    auto provider = map_region(fd, region_size, true, block_size, block_num);
+    if (provider == nullptr) [[unlikely]] {
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    try {
+        provider->_unlink_name = name;
+    } catch (...) {
+        // the provider will be freed, and the name should be unlinked by the caller.
+        return nullptr;
+    }
+    return provider;
+}
+
+auto ShmBlockProvider::OpenNamed(const std::string& name) noexcept -> std::unique_ptr<ShmBlockProvider> {
+    int fd = ::shm_open(name.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) [[unlikely]] {
+        return nullptr;
+    }
+    // magic, block_size, block_num, region_size
+    std::array<uint64_t, 4> fields{};
+    if (::pread(fd, fields.data(), sizeof(fields), 0) != static_cast<ssize_t>(sizeof(fields)) ||
+        fields[0] != kShmProviderMagic) [[unlikely]] {
+        ::close(fd);
+        return nullptr;
+    }
+    return map_region(fd, fields[3], false, fields[1], fields[2]);
+}
+
+ShmBlockProvider::~ShmBlockProvider() {
+    if (_header != nullptr) {
+        ::munmap(_header, _region_size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+    if (not _unlink_name.empty()) {
+        ::shm_unlink(_unlink_name.c_str());
+    }
+}
+
+auto ShmBlockProvider::Allocate(uint64_t size) noexcept -> void* {
+    uint64_t run = (size + _block_size - 1) / _block_size;
+    if (run == 0 || run > kBitsPerWord) [[unlikely]] {
+        return nullptr;
+    }
+    const uint64_t word_num = words();
+    const uint64_t mask = run_mask(run);
+    const uint64_t start = _header->hint.load(std::memory_order::relaxed) % word_num;
+    for (uint64_t i = 0; i < word_num; ++i) {
+        uint64_t word_idx = (start + i) % word_num;
+        auto& word = _bitmap[word_idx];  // NOLINT
+        uint64_t value = word.load(std::memory_order::relaxed);
+        for (uint64_t pos = find_free_run(value, run); pos < kBitsPerWord; pos = find_free_run(value, run)) {
+            // on failure, the value is reloaded, and retry in the same word.
+            if (word.compare_exchange_weak(value, value | (mask << pos), std::memory_order::acquire,
+                                           std::memory_order::relaxed)) {
+                uint64_t block_idx = (word_idx * kBitsPerWord) + pos;
+                _run_length[block_idx] = static_cast<uint8_t>(run);  // NOLINT
+                if ((value | (mask << pos)) == ~0ULL) {
+                    // the word is full, let the followers start from the next word.
+                    _header->hint.store(word_idx + 1, std::memory_order::relaxed);
+                }
+                return _blocks + (block_idx * _block_size);  // NOLINT
+            }
+        }
+    }
+    return nullptr;
+}
+
+void ShmBlockProvider::Deallocate(void* ptr) noexcept {
+    if (ptr == nullptr) [[unlikely]] {
+        return;
+    }
+    Assert(contains(ptr), "ShmBlockProvider::Deallocate should get the ptr alloced by itself");
+    auto offset = static_cast<uint64_t>(static_cast<char*>(ptr) - _blocks);
+    Assert(offset % _block_size == 0, "ShmBlockProvider::Deallocate should get the start of a block");
+    uint64_t block_idx = offset / _block_size;
+    uint64_t run = _run_length[block_idx];  // NOLINT
+    Assert(run > 0 && run <= kBitsPerWord, "ShmBlockProvider::Deallocate got a broken run length");
+    uint64_t word_idx = block_idx / kBitsPerWord;
+    uint64_t pos = block_idx % kBitsPerWord;
+    _bitmap[word_idx].fetch_and(~(run_mask(run) << pos), std::memory_order::release);  // NOLINT
+}
+
+auto ShmBlockProvider::free_blocks() const noexcept -> uint64_t {
+    uint64_t used = 0;
+    for (uint64_t i = 0; i < words(); ++i) {
+        used += static_cast<uint64_t>(std::popcount(_bitmap[i].load(std::memory_order::relaxed)));  // NOLINT
+    }
+    // the tail bits of the last word are always marked as used.
+    return (words() * kBitsPerWord) - used;
+}
+
+void ShmBlockProvider::Apply(Arena::Options& ops) noexcept {
+    ops.block_alloc_with_context = &ShmBlockProvider::AllocateWithContext;
+    ops.block_dealloc_with_context = &ShmBlockProvider::DeallocateWithContext;
+    ops.block_context = this;
+    // a block of the Arena should be a whole block of the provider, the bigger ones should be multiple of it.
+    ops.normal_block_size = _block_size;
+    ops.suggested_init_block_size = align::AlignUp(std::max(ops.suggested_init_block_size, _block_size), _block_size);
+    ops.huge_block_size = align::AlignUp(std::max(ops.huge_block_size, _block_size), _block_size);
+    ops.huge_block_size = std::min(ops.huge_block_size, _block_size * kBitsPerWord);
+}
+
+}  // namespace stdb::memory
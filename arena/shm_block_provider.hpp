@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <atomic>   // for atomic
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t, uint8_t
+#include <memory>   // for unique_ptr
+#include <string>   // for string
+
+#include "arena.hpp"  // for Arena
+
+namespace stdb::memory {
+
+/*
+ * ShmBlockProvider is a block provider for Arena, it carves the blocks from a shared memory region.
+ *
+ * the region is created by memfd_create (or shm_open), and mapped with MAP_SHARED, so the processes forked
+ * after the creation see the same memory in the same address, they can share the Arena's data without
+ * copy-on-write. the processes attached by name can read the data through arena_offset_ptr.
+ *
+ * the free blocks are recorded in a bitmap inside the region, the bitmap is lock-free and shared
+ * by all processes. an allocation of n blocks (n <= 64) is a CAS on a single bitmap word, so it never crosses
+ * the boundary of a word, the allocation larger than 64 blocks will fail with nullptr.
+ *
+ * the memory layout of the region:
+ *  +--------+-----------------+-------------------+------------------------+
+ *  | Header | bitmap (words)  | run length (bytes)| blocks (page aligned)  |
+ *  +--------+-----------------+-------------------+------------------------+
+ */
+class ShmBlockProvider
+{
+   public:
+    static constexpr uint64_t kBitsPerWord = 64;
+    static constexpr uint64_t kRegionAlignment = 4096;
+
+    ShmBlockProvider(const ShmBlockProvider&) = delete;
+    auto operator=(const ShmBlockProvider&) -> ShmBlockProvider& = delete;
+    ShmBlockProvider(ShmBlockProvider&&) = delete;
+    auto operator=(ShmBlockProvider&&) -> ShmBlockProvider& = delete;
+
+    ~ShmBlockProvider();
+
+    /*
+     * create an anonymous region by memfd_create, it can only be shared with the forked processes.
+     * return nullptr means failure.
+     */
+    [[nodiscard]] static auto Create(uint64_t block_size, uint64_t block_num) noexcept
+      -> std::unique_ptr<ShmBlockProvider>;
+
+    /*
+     * create a named region by shm_open, the region will be unlinked while the creator is destroyed.
+     * return nullptr means failure.
+     */
+    [[nodiscard]] static auto CreateNamed(const std::string& name, uint64_t block_size, uint64_t block_num) noexcept
+      -> std::unique_ptr<ShmBlockProvider>;
+
+    /*
+     * attach an existing named region, the block_size and block_num are read from the region header.
+     * return nullptr means failure.
+     */
+    [[nodiscard]] static auto OpenNamed(const std::string& name) noexcept -> std::unique_ptr<ShmBlockProvider>;
+
+    /*
+     * alloc continuous blocks which can hold size bytes.
+     * return nullptr if there is no enough continuous blocks.
+     */
+    [[nodiscard]] auto Allocate(uint64_t size) noexcept -> void*;
+
+    /*
+     * give back the blocks alloced by Allocate.
+     */
+    void Deallocate(void* ptr) noexcept;
+
+    /*
+     * set the block provider to the Options, and make the block sizes of the Arena fit the provider.
+     */
+    void Apply(Arena::Options& ops) noexcept;
+
+    [[nodiscard]] auto block_size() const noexcept -> uint64_t { return _block_size; }
+    [[nodiscard]] auto block_num() const noexcept -> uint64_t { return _block_num; }
+
+    /*
+     * the count of the free blocks, it is just a snapshot under concurrency.
+     */
+    [[nodiscard]] auto free_blocks() const noexcept -> uint64_t;
+
+    /*
+     * check whether the ptr is inside the blocks area of the region.
+     */
+    [[nodiscard]] auto contains(const void* ptr) const noexcept -> bool {
+        const auto* cptr = static_cast<const char*>(ptr);
+        return cptr >= _blocks && cptr < _blocks + (_block_size * _block_num);  // NOLINT
+    }
+
+    // trampolines for Arena::Options::block_alloc_with_context and block_dealloc_with_context
+    static auto AllocateWithContext(void* context, std::size_t size) noexcept -> void* {
+        return static_cast<ShmBlockProvider*>(context)->Allocate(size);
+    }
+
+    static void DeallocateWithContext(void* context, void* ptr) noexcept {
+        static_cast<ShmBlockProvider*>(context)->Deallocate(ptr);
+    }
+
+   private:
+    struct Header
+    {
+        uint64_t magic;
+        uint64_t block_size;
+        uint64_t block_num;
+        uint64_t region_size;
+        // the word to start searching, spread the allocations to reduce the CAS contention.
+        std::atomic<uint64_t> hint;
+    };
+
+    ShmBlockProvider() = default;
+
+    [[nodiscard]] static auto region_size_of(uint64_t block_size, uint64_t block_num) noexcept -> uint64_t;
+    [[nodiscard]] static auto map_region(int fd, uint64_t region_size, bool init, uint64_t block_size,
+                                         uint64_t block_num) noexcept -> std::unique_ptr<ShmBlockProvider>;
+    void layout() noexcept;
+
+    [[nodiscard]] auto words() const noexcept -> uint64_t {
+        return (_block_num + kBitsPerWord - 1) / kBitsPerWord;
+    }
+
+    Header* _header{nullptr};
+    std::atomic<uint64_t>* _bitmap{nullptr};
+    uint8_t* _run_length{nullptr};
+    char* _blocks{nullptr};
+    uint64_t _block_size{0};
+    uint64_t _block_num{0};
+    uint64_t _region_size{0};
+    int _fd{-1};
+    std::string _unlink_name{};
+};
+
+}  // namespace stdb::memory
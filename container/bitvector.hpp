@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <algorithm>         // for upper_bound
+#include <bit>               // for popcount, countr_zero
+#include <cstddef>           // for size_t
+#include <cstdint>           // for uint64_t
+#include <initializer_list>  // for initializer_list
+#include <limits>            // for numeric_limits
+#include <span>              // for span
+#include <utility>           // for swap
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "assert_config.hpp"
+#include "container/simd.hpp"
+#include "container/stdb_vector.hpp"
+
+namespace stdb::container {
+
+/*
+ * stdb_bitvector is the packed vector of bool, core does not accept bool.
+ * the bits are stored in 64-bit words, 8x smaller than stdb_vector<uint8_t>, it is the selection vector and the
+ * null bitmap of the filters.
+ *
+ * count() works on the whole words by popcount, find_first/find_next by std::countr_zero, and the
+ * AND/OR/XOR/ANDNOT of two bitvectors use the simd::bitwise kernels.
+ * select() binary searches a rank directory, the popcount before every superblock of kSuperblockWords words, it is
+ * rebuilt by the first select() after a modification.
+ *
+ * NOTICE: the bits after size() in the last word are always zero, every modifier keeps it.
+ */
+class stdb_bitvector
+{
+   public:
+    using size_type = std::size_t;
+    using word_type = uint64_t;
+
+    static constexpr size_type kWordBits = 64;
+    // 512 bits, one cache line of words per rank directory entry.
+    static constexpr size_type kSuperblockWords = 8;
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    stdb_bitvector() = default;
+
+    explicit stdb_bitvector(size_type size, bool value = false) { resize(size, value); }
+
+    stdb_bitvector(std::initializer_list<bool> init) {
+        reserve(init.size());
+        for (bool bit : init) {
+            push_back(bit);
+        }
+    }
+
+    /*
+     * Capacity section
+     */
+    [[nodiscard, gnu::always_inline]] inline auto size() const noexcept -> size_type { return _size; }
+
+    [[nodiscard, gnu::always_inline]] inline auto empty() const noexcept -> bool { return _size == 0; }
+
+    [[nodiscard, gnu::always_inline]] inline auto capacity() const noexcept -> size_type {
+        return _words.capacity() * kWordBits;
+    }
+
+    void reserve(size_type bits) { _words.reserve(word_count(bits)); }
+
+    void shrink_to_fit() { _words.shrink_to_fit(); }
+
+    // the words of the bitmap, for the kernels working on the raw bitmap.
+    [[nodiscard, gnu::always_inline]] inline auto words() const noexcept -> std::span<const word_type> {
+        return {_words.data(), _words.size()};
+    }
+
+    // the caller may write the words, so the rank directory is dropped.
+    [[nodiscard, gnu::always_inline]] inline auto words() noexcept -> std::span<word_type> {
+        _rank_valid = false;
+        return {_words.data(), _words.size()};
+    }
+
+    /*
+     * Element access section
+     */
+    [[nodiscard, gnu::always_inline]] inline auto test(size_type pos) const noexcept -> bool {
+        Assert(pos < _size, "pos out of range");
+        return ((_words[pos / kWordBits] >> (pos % kWordBits)) & 1U) != 0;
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto operator[](size_type pos) const noexcept -> bool { return test(pos); }
+
+    [[gnu::always_inline]] inline void set(size_type pos) noexcept {
+        Assert(pos < _size, "pos out of range");
+        _rank_valid = false;
+        _words[pos / kWordBits] |= bit_mask(pos);
+    }
+
+    [[gnu::always_inline]] inline void set(size_type pos, bool value) noexcept {
+        Assert(pos < _size, "pos out of range");
+        _rank_valid = false;
+        // branchless, clear the bit and or the value.
+        word_type& word = _words[pos / kWordBits];
+        word = (word & ~bit_mask(pos)) | (static_cast<word_type>(value) << (pos % kWordBits));
+    }
+
+    [[gnu::always_inline]] inline void reset(size_type pos) noexcept {
+        Assert(pos < _size, "pos out of range");
+        _rank_valid = false;
+        _words[pos / kWordBits] &= ~bit_mask(pos);
+    }
+
+    [[gnu::always_inline]] inline void flip(size_type pos) noexcept {
+        Assert(pos < _size, "pos out of range");
+        _rank_valid = false;
+        _words[pos / kWordBits] ^= bit_mask(pos);
+    }
+
+    // set all the bits.
+    void set() noexcept {
+        _rank_valid = false;
+        for (auto& word : _words) {
+            word = ~word_type{0};
+        }
+        clear_tail();
+    }
+
+    // reset all the bits.
+    void reset() noexcept {
+        _rank_valid = false;
+        for (auto& word : _words) {
+            word = 0;
+        }
+    }
+
+    /*
+     * Bits section
+     */
+    [[nodiscard]] auto count() const noexcept -> size_type { return simd::count_bits(_words.data(), _words.size()); }
+
+    [[nodiscard]] auto any() const noexcept -> bool {
+        for (auto word : _words) {
+            if (word != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] auto none() const noexcept -> bool { return not any(); }
+
+    [[nodiscard]] auto all() const noexcept -> bool { return count() == _size; }
+
+    // the position of the first set bit, or npos.
+    [[nodiscard]] auto find_first() const noexcept -> size_type { return find_from_word(0); }
+
+    // the position of the first set bit after pos, or npos.
+    [[nodiscard]] auto find_next(size_type pos) const noexcept -> size_type {
+        ++pos;
+        if (pos >= _size) [[unlikely]] {
+            return npos;
+        }
+        const size_type index = pos / kWordBits;
+        // shift out the bits before pos.
+        if (word_type word = _words[index] >> (pos % kWordBits); word != 0) {
+            return pos + static_cast<size_type>(std::countr_zero(word));
+        }
+        return find_from_word(index + 1);
+    }
+
+    /*
+     * the position of the rank-th (from 0) set bit, or npos if count() <= rank.
+     * the superblock is found by a binary search of the rank directory, then at most kSuperblockWords words are
+     * skipped by popcount and the bit is selected in the word. O(log(n / 512)) once the directory is built.
+     *
+     * NOTICE: the first select() after a modification rebuilds the directory in O(n / 64), it writes the mutable
+     * directory, so the concurrent readers of a modified bitvector should call build_rank_directory() first.
+     */
+    [[nodiscard]] auto select(size_type rank) const -> size_type {
+        if (not _rank_valid) [[unlikely]] {
+            build_rank_directory();
+        }
+        if (rank >= _rank_directory.back()) {
+            return npos;
+        }
+        // the last superblock whose preceding popcount is <= rank.
+        const auto found = std::upper_bound(_rank_directory.begin(), _rank_directory.end(), rank);
+        const auto superblock = static_cast<size_type>(found - _rank_directory.begin()) - 1;
+        rank -= _rank_directory[superblock];
+        for (size_type index = superblock * kSuperblockWords;; ++index) {
+            const word_type word = _words[index];
+            const auto bits = static_cast<size_type>(std::popcount(word));
+            if (rank < bits) {
+                return index * kWordBits + select_in_word(word, rank);
+            }
+            rank -= bits;
+        }
+    }
+
+    // build the rank directory of select() now, the entry i is the popcount of the words before superblock i.
+    void build_rank_directory() const {
+        const size_type superblocks = (_words.size() + kSuperblockWords - 1) / kSuperblockWords;
+        _rank_directory.clear();
+        _rank_directory.reserve(superblocks + 1);
+        size_type total = 0;
+        for (size_type superblock = 0; superblock < superblocks; ++superblock) {
+            _rank_directory.push_back(total);
+            const size_type first = superblock * kSuperblockWords;
+            total += simd::count_bits(_words.data() + first, std::min(kSuperblockWords, _words.size() - first));
+        }
+        _rank_directory.push_back(total);
+        _rank_valid = true;
+    }
+
+    // call func(pos) for every set bit in order, it is the loop over a selection vector.
+    template <typename Func>
+    void for_each_set(Func&& func) const {
+        for (size_type index = 0; index < _words.size(); ++index) {
+            for (word_type word = _words[index]; word != 0; word &= word - 1) {
+                func(index * kWordBits + static_cast<size_type>(std::countr_zero(word)));
+            }
+        }
+    }
+
+    /*
+     * word-level operations with another bitvector of the same size.
+     */
+    auto operator&=(const stdb_bitvector& other) noexcept -> stdb_bitvector& {
+        return apply<simd::BitOp::And>(other);
+    }
+
+    auto operator|=(const stdb_bitvector& other) noexcept -> stdb_bitvector& { return apply<simd::BitOp::Or>(other); }
+
+    auto operator^=(const stdb_bitvector& other) noexcept -> stdb_bitvector& {
+        return apply<simd::BitOp::Xor>(other);
+    }
+
+    // this & ~other, remove the bits of other.
+    auto and_not(const stdb_bitvector& other) noexcept -> stdb_bitvector& {
+        return apply<simd::BitOp::AndNot>(other);
+    }
+
+    // flip all the bits.
+    void flip() noexcept {
+        _rank_valid = false;
+        for (auto& word : _words) {
+            word = ~word;
+        }
+        clear_tail();
+    }
+
+    /*
+     * Modifiers section
+     */
+    void push_back(bool value) {
+        _rank_valid = false;
+        if (_size % kWordBits == 0) {
+            _words.push_back(0);
+        }
+        _words.back() |= static_cast<word_type>(value) << (_size % kWordBits);
+        ++_size;
+    }
+
+    void pop_back() noexcept {
+        Assert(_size > 0, "pop_back should not be called with empty bitvector");
+        --_size;
+        _rank_valid = false;
+        reset_tail_word();
+    }
+
+    void resize(size_type size, bool value = false) {
+        const size_type old_size = _size;
+        _rank_valid = false;
+        _words.resize(word_count(size), value ? ~word_type{0} : word_type{0});
+        _size = size;
+        if (size > old_size) {
+            // the bits after old_size in the old last word are zero.
+            if (value and old_size % kWordBits != 0) {
+                _words[old_size / kWordBits] |= ~word_type{0} << (old_size % kWordBits);
+            }
+            clear_tail();
+        } else {
+            reset_tail_word();
+        }
+    }
+
+    void clear() noexcept {
+        _words.clear();
+        _size = 0;
+        _rank_valid = false;
+    }
+
+    void swap(stdb_bitvector& other) noexcept {
+        _words.swap(other._words);
+        std::swap(_size, other._size);
+        _rank_directory.swap(other._rank_directory);
+        std::swap(_rank_valid, other._rank_valid);
+    }
+
+    [[nodiscard]] friend auto operator==(const stdb_bitvector& lhs, const stdb_bitvector& rhs) noexcept -> bool {
+        return lhs._size == rhs._size and lhs._words == rhs._words;
+    }
+
+   private:
+    [[nodiscard, gnu::always_inline]] static constexpr auto word_count(size_type bits) noexcept -> size_type {
+        return (bits + kWordBits - 1) / kWordBits;
+    }
+
+    [[nodiscard, gnu::always_inline]] static constexpr auto bit_mask(size_type pos) noexcept -> word_type {
+        return word_type{1} << (pos % kWordBits);
+    }
+
+    // the position of the rank-th set bit in word, rank < popcount(word).
+    [[nodiscard, gnu::always_inline]] static auto select_in_word(word_type word, size_type rank) noexcept
+      -> size_type {
+#if defined(__BMI2__)
+        return static_cast<size_type>(std::countr_zero(_pdep_u64(word_type{1} << rank, word)));
+#else
+        // narrow down to the byte by the popcount of the halves, then clear the lower bits in the byte.
+        size_type pos = 0;
+        for (size_type width = 32; width >= 8; width /= 2) {
+            const auto low = static_cast<size_type>(std::popcount(word & ((word_type{1} << width) - 1)));
+            if (rank >= low) {
+                rank -= low;
+                word >>= width;
+                pos += width;
+            }
+        }
+        for (; rank > 0; --rank) {
+            word &= word - 1;
+        }
+        return pos + static_cast<size_type>(std::countr_zero(word));
+#endif
+    }
+
+    [[nodiscard]] auto find_from_word(size_type index) const noexcept -> size_type {
+        for (; index < _words.size(); ++index) {
+            if (word_type word = _words[index]; word != 0) {
+                return index * kWordBits + static_cast<size_type>(std::countr_zero(word));
+            }
+        }
+        return npos;
+    }
+
+    template <simd::BitOp Op>
+    auto apply(const stdb_bitvector& other) noexcept -> stdb_bitvector& {
+        Assert(_size == other._size, "the bitvectors should have the same size");
+        _rank_valid = false;
+        simd::bitwise<Op>(_words.data(), other._words.data(), _words.size());
+        return *this;
+    }
+
+    // zero the bits after _size in the last word.
+    void clear_tail() noexcept {
+        if (_size % kWordBits != 0) {
+            _words.back() &= (word_type{1} << (_size % kWordBits)) - 1;
+        }
+    }
+
+    // drop the last word if it holds no bit, or clear its tail.
+    void reset_tail_word() noexcept {
+        if (_words.size() > word_count(_size)) {
+            _words.pop_back();
+        }
+        clear_tail();
+    }
+
+    stdb_vector<word_type> _words;
+    size_type _size = 0;
+    // the rank directory of select(), it has the superblock count + 1 entries when _rank_valid.
+    mutable stdb_vector<size_type> _rank_directory;
+    mutable bool _rank_valid = false;
+};  // class stdb_bitvector
+
+}  // namespace stdb::container
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <algorithm>           // for min, max
+#include <atomic>              // for atomic, memory_order
+#include <condition_variable>  // for condition_variable
+#include <cstddef>             // for size_t
+#include <deque>               // for deque
+#include <exception>           // for exception_ptr, current_exception, rethrow_exception
+#include <mutex>               // for mutex, lock_guard, unique_lock
+#include <thread>              // for jthread, hardware_concurrency
+#include <vector>              // for vector
+
+namespace stdb::container {
+
+// ranges smaller than 64MB are not worth waking other threads.
+constexpr std::size_t kParallelThreshold = 64UL * 1024 * 1024;
+
+/*
+ * the std::execution::par of stdb_vector's bulk construct/copy/destroy.
+ * a range of at least threshold bytes is split by pages to the worker threads,
+ * so the pages are also first touched by them, which spreads the page faults and the NUMA placement.
+ */
+struct parallel_policy
+{
+    // the number of chunks, 0 means std::thread::hardware_concurrency(), they run on the parallel_pool.
+    std::size_t threads = 0;
+    std::size_t threshold = kParallelThreshold;
+};
+
+inline constexpr parallel_policy par{};
+
+/*
+ * a chunk of parallel_for, run(context, begin, end) must not throw, pending is decreased after it.
+ */
+struct parallel_task
+{
+    void (*run)(void* context, std::size_t begin, std::size_t end) noexcept;
+    void* context;
+    std::size_t begin;
+    std::size_t end;
+    std::atomic<std::size_t>* pending;
+};
+
+/*
+ * parallel_pool is the persistent worker threads of parallel_for, so a series of parallel operations does not pay
+ * for starting and joining threads each time. the waiting threads run the queued tasks as well, so a parallel_for
+ * nested in a task never waits for the workers blocked by itself.
+ */
+class parallel_pool
+{
+   public:
+    explicit parallel_pool(std::size_t workers) {
+        _workers.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            _workers.emplace_back([this] { work(); });
+        }
+    }
+
+    parallel_pool(const parallel_pool&) = delete;
+    parallel_pool(parallel_pool&&) = delete;
+    auto operator=(const parallel_pool&) -> parallel_pool& = delete;
+    auto operator=(parallel_pool&&) -> parallel_pool& = delete;
+
+    ~parallel_pool() {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _stopping = true;
+        }
+        _ready.notify_all();
+        _workers.clear();
+    }
+
+    /*
+     * the pool shared by all parallel_for, it is created by the first parallel operation with a worker for every
+     * hardware thread but the calling one.
+     */
+    [[nodiscard]] static auto global() -> parallel_pool& {
+        static parallel_pool pool(std::max<std::size_t>(1, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    [[nodiscard]] auto workers() const noexcept -> std::size_t { return _workers.size(); }
+
+    void push(const parallel_task& task) {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _tasks.push_back(task);
+        }
+        _ready.notify_one();
+    }
+
+    /*
+     * run the queued tasks until pending drops to 0.
+     */
+    void wait(std::atomic<std::size_t>& pending) {
+        for (std::size_t left = pending.load(std::memory_order::acquire); left != 0;
+             left = pending.load(std::memory_order::acquire)) {
+            if (not run_one()) {
+                pending.wait(left, std::memory_order::acquire);
+            }
+        }
+        // wait for the last notify_all on pending.
+        std::lock_guard<std::mutex> guard(_mutex);
+    }
+
+   private:
+    void run(const parallel_task& task) noexcept {
+        task.run(task.context, task.begin, task.end);
+        // pending is on the stack of the waiter, which returns only after it takes the lock.
+        std::lock_guard<std::mutex> guard(_mutex);
+        task.pending->fetch_sub(1, std::memory_order::release);
+        task.pending->notify_all();
+    }
+
+    auto run_one() -> bool {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_tasks.empty()) {
+            return false;
+        }
+        parallel_task task = _tasks.front();
+        _tasks.pop_front();
+        lock.unlock();
+        run(task);
+        return true;
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _ready.wait(lock, [this] { return _stopping or not _tasks.empty(); });
+            if (_tasks.empty()) {
+                return;
+            }
+            parallel_task task = _tasks.front();
+            _tasks.pop_front();
+            lock.unlock();
+            run(task);
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _ready;
+    std::deque<parallel_task> _tasks;
+    bool _stopping = false;
+    // the last member, the workers are joined before the queue is destroyed.
+    std::vector<std::jthread> _workers;
+};
+
+/*
+ * fork-join func(begin, end) over [0, count) on the parallel_pool, the chunk sizes are multiples of grain.
+ * the calling thread runs the first chunk, and the first exception is rethrown after all chunks are done.
+ */
+template <typename Func>
+void parallel_for(const parallel_policy& policy, std::size_t count, std::size_t grain, Func&& func) {
+    std::size_t threads =
+      policy.threads != 0 ? policy.threads : std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    std::size_t chunks = std::min(threads, (count + grain - 1) / grain);
+    if (chunks <= 1) {
+        func(std::size_t{0}, count);
+        return;
+    }
+    std::size_t step = ((count + chunks - 1) / chunks + grain - 1) / grain * grain;
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto run = [&func, &error, &error_mutex](std::size_t begin, std::size_t end) noexcept {
+        try {
+            func(begin, end);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(error_mutex);
+            if (error == nullptr) {
+                error = std::current_exception();
+            }
+        }
+    };
+    using run_type = decltype(run);
+    auto& pool = parallel_pool::global();
+    std::atomic<std::size_t> pending{0};
+    for (std::size_t begin = step; begin < count; begin += step) {
+        pending.fetch_add(1, std::memory_order::relaxed);
+        pool.push({.run = [](void* context, std::size_t first, std::size_t last) noexcept {
+                       (*static_cast<run_type*>(context))(first, last);
+                   },
+                   .context = &run,
+                   .begin = begin,
+                   .end = std::min(begin + step, count),
+                   .pending = &pending});
+    }
+    run(0, std::min(step, count));
+    pool.wait(pending);
+    if (error != nullptr) [[unlikely]] {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace stdb::container
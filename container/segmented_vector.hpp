@@ -0,0 +1,476 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <algorithm>    // for min
+#include <array>        // for array
+#include <bit>          // for bit_width, bit_ceil, countr_zero
+#include <cstddef>      // for size_t, ptrdiff_t, max_align_t
+#include <cstdlib>      // for malloc, free
+#include <iterator>     // for random_access_iterator_tag
+#include <limits>       // for numeric_limits
+#include <new>          // for bad_alloc, align_val_t, nothrow
+#include <span>         // for span
+#include <type_traits>  // for conditional_t
+#include <utility>      // for exchange, forward, move, swap
+
+#include "assert_config.hpp"
+#include "container/stdb_vector.hpp"
+
+namespace stdb::container {
+
+/*
+ * the segment sources of stdb_segmented_vector.
+ * allocate returns nullptr when failed, deallocate gets the same bytes and alignment as allocate.
+ * the arena one is memory::arena_segment_source in arena/arena_segment_source.hpp.
+ */
+struct malloc_segment_source
+{
+    [[nodiscard, gnu::always_inline]] static auto allocate(std::size_t bytes, std::size_t alignment) -> void* {
+        // malloc only aligns to max_align_t, the over-aligned types take the aligned operator new.
+        if (alignment > alignof(std::max_align_t)) [[unlikely]] {
+            return ::operator new(bytes, std::align_val_t(alignment), std::nothrow);
+        }
+        return std::malloc(bytes);
+    }
+
+    [[gnu::always_inline]] static void deallocate(void* ptr, std::size_t bytes, std::size_t alignment) noexcept {
+        if (alignment > alignof(std::max_align_t)) [[unlikely]] {
+            ::operator delete(ptr, bytes, std::align_val_t(alignment));
+            return;
+        }
+        std::free(ptr);
+    }
+};
+
+/*
+ * stdb_segmented_vector stores the elements in geometrically sized segments: segment k holds kFirstSegment << k
+ * elements. the segments are never moved, so the growth copies nothing and the element addresses are stable,
+ * the push_back latency has no O(n) spike at the doubling points.
+ *
+ * index to (segment, offset) is O(1) by std::bit_width, and every segment is contiguous, use
+ * for_each_segment/segment(k) to scan the elements as std::span.
+ */
+template <typename T, typename SegmentSource = malloc_segment_source>
+class stdb_segmented_vector
+{
+   public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+
+    static constexpr size_type kFirstSegment = std::bit_ceil(fast_vector_init_capacity(sizeof(T)));
+    static constexpr size_type kFirstShift = static_cast<size_type>(std::countr_zero(kFirstSegment));
+    static constexpr size_type kMaxSegments = std::numeric_limits<size_type>::digits - kFirstShift;
+
+    template <bool IsConst>
+    class segmented_iterator
+    {
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = std::conditional_t<IsConst, const T&, T&>;
+        using vector_pointer = std::conditional_t<IsConst, const stdb_segmented_vector*, stdb_segmented_vector*>;
+
+        segmented_iterator() noexcept = default;
+
+        segmented_iterator(vector_pointer vec, size_type index) noexcept : _vec(vec), _index(index) { seek(); }
+
+        // iterator to const_iterator.
+        operator segmented_iterator<true>() const noexcept {  // NOLINT(google-explicit-constructor)
+            return segmented_iterator<true>(_vec, _index);
+        }
+
+        [[nodiscard, gnu::always_inline]] inline auto operator*() const noexcept -> reference { return *_ptr; }
+
+        [[nodiscard, gnu::always_inline]] inline auto operator->() const noexcept -> pointer { return _ptr; }
+
+        [[nodiscard]] auto operator[](difference_type n) const noexcept -> reference {
+            return (*_vec)[static_cast<size_type>(static_cast<difference_type>(_index) + n)];
+        }
+
+        auto operator++() noexcept -> segmented_iterator& {
+            ++_index;
+            if (++_ptr == _segment_end) [[unlikely]] {
+                seek();
+            }
+            return *this;
+        }
+
+        auto operator--() noexcept -> segmented_iterator& {
+            --_index;
+            seek();
+            return *this;
+        }
+
+        auto operator++(int) noexcept -> segmented_iterator {
+            segmented_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        auto operator--(int) noexcept -> segmented_iterator {
+            segmented_iterator tmp(*this);
+            --*this;
+            return tmp;
+        }
+
+        auto operator+=(difference_type n) noexcept -> segmented_iterator& {
+            _index = static_cast<size_type>(static_cast<difference_type>(_index) + n);
+            seek();
+            return *this;
+        }
+
+        auto operator-=(difference_type n) noexcept -> segmented_iterator& { return *this += -n; }
+
+        [[nodiscard]] friend auto operator+(segmented_iterator iter, difference_type n) noexcept
+          -> segmented_iterator {
+            return iter += n;
+        }
+
+        [[nodiscard]] friend auto operator+(difference_type n, segmented_iterator iter) noexcept
+          -> segmented_iterator {
+            return iter += n;
+        }
+
+        [[nodiscard]] friend auto operator-(segmented_iterator iter, difference_type n) noexcept
+          -> segmented_iterator {
+            return iter -= n;
+        }
+
+        [[nodiscard]] friend auto operator-(const segmented_iterator& lhs, const segmented_iterator& rhs) noexcept
+          -> difference_type {
+            return static_cast<difference_type>(lhs._index) - static_cast<difference_type>(rhs._index);
+        }
+
+        [[nodiscard]] friend auto operator==(const segmented_iterator& lhs, const segmented_iterator& rhs) noexcept
+          -> bool {
+            return lhs._index == rhs._index;
+        }
+
+        [[nodiscard]] friend auto operator<=>(const segmented_iterator& lhs, const segmented_iterator& rhs) noexcept {
+            return lhs._index <=> rhs._index;
+        }
+
+       private:
+        // point _ptr to _index, the end iterator may be in a segment which is not allocated.
+        void seek() noexcept {
+            auto [seg, offset] = locate(_index);
+            if (seg < _vec->_segment_count) [[likely]] {
+                _ptr = _vec->_segments[seg] + offset;
+                _segment_end = _vec->_segments[seg] + segment_size(seg);
+            } else {
+                _ptr = _segment_end = nullptr;
+            }
+        }
+
+        vector_pointer _vec = nullptr;
+        size_type _index = 0;
+        pointer _ptr = nullptr;
+        pointer _segment_end = nullptr;
+    };
+
+    using iterator = segmented_iterator<false>;
+    using const_iterator = segmented_iterator<true>;
+
+    stdb_segmented_vector() = default;
+
+    explicit stdb_segmented_vector(SegmentSource source) noexcept : _source(std::move(source)) {}
+
+    stdb_segmented_vector(const stdb_segmented_vector& other) : _source(other._source) { copy_from(other); }
+
+    stdb_segmented_vector(stdb_segmented_vector&& other) noexcept
+        : _segments(std::exchange(other._segments, {})),
+          _segment_count(std::exchange(other._segment_count, 0)),
+          _size(std::exchange(other._size, 0)),
+          _finish(std::exchange(other._finish, nullptr)),
+          _segment_end(std::exchange(other._segment_end, nullptr)),
+          _source(std::move(other._source)) {}
+
+    auto operator=(const stdb_segmented_vector& other) -> stdb_segmented_vector& {
+        if (this == &other) [[unlikely]] {
+            return *this;
+        }
+        clear();
+        copy_from(other);
+        return *this;
+    }
+
+    auto operator=(stdb_segmented_vector&& other) noexcept -> stdb_segmented_vector& {
+        if (this == &other) [[unlikely]] {
+            return *this;
+        }
+        clear();
+        release_segments(0);
+        _segments = std::exchange(other._segments, {});
+        _segment_count = std::exchange(other._segment_count, 0);
+        _size = std::exchange(other._size, 0);
+        _finish = std::exchange(other._finish, nullptr);
+        _segment_end = std::exchange(other._segment_end, nullptr);
+        _source = std::move(other._source);
+        return *this;
+    }
+
+    ~stdb_segmented_vector() {
+        clear();
+        release_segments(0);
+    }
+
+    /*
+     * the segment and the offset in it of an index.
+     */
+    struct location
+    {
+        size_type segment;
+        size_type offset;
+    };
+
+    [[nodiscard, gnu::always_inline]] static constexpr auto locate(size_type index) noexcept -> location {
+        const auto segment = static_cast<size_type>(std::bit_width((index >> kFirstShift) + 1)) - 1;
+        return {segment, index + kFirstSegment - (kFirstSegment << segment)};
+    }
+
+    [[nodiscard, gnu::always_inline]] static constexpr auto segment_size(size_type segment) noexcept -> size_type {
+        return kFirstSegment << segment;
+    }
+
+    /*
+     * Capacity section
+     */
+    [[nodiscard, gnu::always_inline]] inline auto size() const noexcept -> size_type { return _size; }
+
+    [[nodiscard, gnu::always_inline]] inline auto empty() const noexcept -> bool { return _size == 0; }
+
+    // the segments 0..count-1 hold kFirstSegment * (2^count - 1) elements.
+    [[nodiscard, gnu::always_inline]] inline auto capacity() const noexcept -> size_type {
+        return (kFirstSegment << _segment_count) - kFirstSegment;
+    }
+
+    void reserve(size_type new_capacity) {
+        while (capacity() < new_capacity) {
+            allocate_segment();
+        }
+    }
+
+    // free the segments without any element.
+    void shrink_to_fit() noexcept {
+        release_segments(_size == 0 ? 0 : locate(_size - 1).segment + 1);
+        seek_tail();
+    }
+
+    /*
+     * Element access section
+     */
+    [[nodiscard, gnu::always_inline]] inline auto at(size_type index) noexcept -> reference {
+        Assert(index < _size, "index out of range");
+        auto [seg, offset] = locate(index);
+        return _segments[seg][offset];
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto at(size_type index) const noexcept -> const_reference {
+        Assert(index < _size, "index out of range");
+        auto [seg, offset] = locate(index);
+        return _segments[seg][offset];
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto operator[](size_type index) noexcept -> reference {
+        return at(index);
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto operator[](size_type index) const noexcept -> const_reference {
+        return at(index);
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto front() noexcept -> reference { return at(0); }
+
+    [[nodiscard, gnu::always_inline]] inline auto back() noexcept -> reference {
+        Assert(_size > 0, "back should not be called with empty vector");
+        return at(_size - 1);
+    }
+
+    // the number of segments holding elements.
+    [[nodiscard]] auto segment_count() const noexcept -> size_type {
+        return _size == 0 ? 0 : locate(_size - 1).segment + 1;
+    }
+
+    // the live elements of a segment.
+    [[nodiscard]] auto segment(size_type seg) noexcept -> std::span<T> {
+        Assert(seg < segment_count(), "segment out of range");
+        const size_type first = (kFirstSegment << seg) - kFirstSegment;
+        return std::span<T>(_segments[seg], std::min(segment_size(seg), _size - first));
+    }
+
+    [[nodiscard]] auto segment(size_type seg) const noexcept -> std::span<const T> {
+        Assert(seg < segment_count(), "segment out of range");
+        const size_type first = (kFirstSegment << seg) - kFirstSegment;
+        return std::span<const T>(_segments[seg], std::min(segment_size(seg), _size - first));
+    }
+
+    // call func with the std::span of every segment in order, the hot loops run on contiguous memory.
+    template <typename Func>
+    void for_each_segment(Func&& func) {
+        for (size_type seg = 0, count = segment_count(); seg < count; ++seg) {
+            func(segment(seg));
+        }
+    }
+
+    template <typename Func>
+    void for_each_segment(Func&& func) const {
+        for (size_type seg = 0, count = segment_count(); seg < count; ++seg) {
+            func(segment(seg));
+        }
+    }
+
+    /*
+     * Iterators section
+     */
+    [[nodiscard]] auto begin() noexcept -> iterator { return iterator(this, 0); }
+
+    [[nodiscard]] auto end() noexcept -> iterator { return iterator(this, _size); }
+
+    [[nodiscard]] auto begin() const noexcept -> const_iterator { return const_iterator(this, 0); }
+
+    [[nodiscard]] auto end() const noexcept -> const_iterator { return const_iterator(this, _size); }
+
+    [[nodiscard]] auto cbegin() const noexcept -> const_iterator { return begin(); }
+
+    [[nodiscard]] auto cend() const noexcept -> const_iterator { return end(); }
+
+    /*
+     * Modifiers section
+     */
+    template <typename... Args>
+    auto emplace_back(Args&&... args) -> reference {
+        if (_finish == _segment_end) [[unlikely]] {
+            next_segment();
+        }
+        // the elements are never moved, so args can refer to an element of this vector.
+        T* ptr = new (_finish) T(std::forward<Args>(args)...);
+        ++_finish;
+        ++_size;
+        return *ptr;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back() noexcept {
+        Assert(_size > 0, "pop_back should not be called with empty vector");
+        --_size;
+        auto [seg, offset] = locate(_size);
+        destroy_ptr(_segments[seg] + offset);
+        seek_tail();
+    }
+
+    void clear() noexcept {
+        for_each_segment([](std::span<T> seg) { destroy_range(seg.data(), seg.data() + seg.size()); });
+        _size = 0;
+        seek_tail();
+    }
+
+    void swap(stdb_segmented_vector& other) noexcept {
+        std::swap(_segments, other._segments);
+        std::swap(_segment_count, other._segment_count);
+        std::swap(_size, other._size);
+        std::swap(_finish, other._finish);
+        std::swap(_segment_end, other._segment_end);
+        std::swap(_source, other._source);
+    }
+
+   private:
+    void allocate_segment() {
+        Assert(_segment_count < kMaxSegments, "too many segments");
+        void* ptr = _source.allocate(segment_size(_segment_count) * sizeof(T), alignof(T));
+        if (ptr == nullptr) [[unlikely]] {
+            throw std::bad_alloc();
+        }
+        _segments[_segment_count++] = static_cast<T*>(ptr);
+    }
+
+    // the last segment is full, move the tail to the next one.
+    void next_segment() {
+        const size_type seg = locate(_size).segment;
+        if (seg == _segment_count) {
+            allocate_segment();
+        }
+        _finish = _segments[seg];
+        _segment_end = _segments[seg] + segment_size(seg);
+    }
+
+    // point the tail to _size, or nullptr when its segment is not allocated.
+    void seek_tail() noexcept {
+        auto [seg, offset] = locate(_size);
+        if (seg < _segment_count) {
+            _finish = _segments[seg] + offset;
+            _segment_end = _segments[seg] + segment_size(seg);
+        } else {
+            _finish = _segment_end = nullptr;
+        }
+    }
+
+    void release_segments(size_type keep) noexcept {
+        while (_segment_count > keep) {
+            --_segment_count;
+            _source.deallocate(_segments[_segment_count], segment_size(_segment_count) * sizeof(T), alignof(T));
+            _segments[_segment_count] = nullptr;
+        }
+    }
+
+    // copy into an empty vector.
+    void copy_from(const stdb_segmented_vector& other) {
+        Assert(_size == 0, "copy_from should be called with empty vector");
+        reserve(other._size);
+        other.for_each_segment([this](std::span<const T> seg) {
+            const size_type index = _size;
+            copy_range(_segments[locate(index).segment], seg.data(), seg.data() + seg.size());
+            _size += seg.size();
+        });
+        seek_tail();
+    }
+
+    std::array<T*, kMaxSegments> _segments{};
+    size_type _segment_count = 0;
+    size_type _size = 0;
+    T* _finish = nullptr;
+    T* _segment_end = nullptr;
+    [[no_unique_address]] SegmentSource _source{};
+};  // class stdb_segmented_vector
+
+}  // namespace stdb::container
@@ -0,0 +1,787 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <array>        // for array
+#include <bit>          // for bit_cast, countr_zero, popcount
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t, uint32_t, int8_t
+#include <type_traits>  // for conditional_t, is_arithmetic_v
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * find / count / remove kernels of arithmetic arrays for stdb_vector, and the word kernels of stdb_bitvector.
+ *
+ * every kernel has a scalar, a SSE4.1 (with popcnt), an AVX2 and an AVX-512 version, the instruction set is
+ * detected once at runtime, so the binary does not need to be built with -mavx2 or -mavx512*.
+ * the AVX-512 version needs avx512f and avx512bw, skylake-x on. the 8/16-bit remove and compress need vpcompressb/w
+ * of avx512vbmi2 in addition (ice lake or zen4), without it they take the AVX2 version.
+ *
+ * the floating point comparison is ordered, so NaN never equals to anything and -0.0 equals to 0.0,
+ * the same as operator==.
+ */
+namespace stdb::container::simd {
+
+enum class Level : uint8_t
+{
+    Scalar = 0,
+    SSE4_1 = 1,
+    AVX2 = 2,
+    AVX512 = 3,
+    // AVX512 with avx512vbmi2, for the 8/16-bit compress.
+    AVX512_VBMI2 = 4,
+};
+
+template <typename T>
+concept Element =
+  std::is_arithmetic_v<T> && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+
+[[nodiscard]] inline auto detect_level() noexcept -> Level {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw")) {
+        return __builtin_cpu_supports("avx512vbmi2") ? Level::AVX512_VBMI2 : Level::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return Level::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1") and __builtin_cpu_supports("popcnt")) {
+        return Level::SSE4_1;
+    }
+#endif
+    return Level::Scalar;
+}
+
+[[nodiscard, gnu::always_inline]] inline auto active_level() noexcept -> Level {
+    static const Level level = detect_level();
+    return level;
+}
+
+/*
+ * scalar kernels, they are also the tails of the vectorized ones.
+ */
+template <Element T>
+[[nodiscard]] inline auto find_scalar(const T* first, const T* last, T value) noexcept -> const T* {
+    for (; first != last; ++first) {
+        if (*first == value) {
+            return first;
+        }
+    }
+    return last;
+}
+
+template <Element T>
+[[nodiscard]] inline auto count_scalar(const T* first, const T* last, T value) noexcept -> std::size_t {
+    std::size_t count = 0;
+    for (; first != last; ++first) {
+        count += static_cast<std::size_t>(*first == value);
+    }
+    return count;
+}
+
+// copy the elements of [first, last) which are not equal to value to dst, dst should never be after first.
+template <Element T>
+[[nodiscard]] inline auto remove_scalar(T* dst, const T* first, const T* last, T value) noexcept -> T* {
+    for (; first != last; ++first) {
+        T elem = *first;
+        *dst = elem;
+        dst += static_cast<std::size_t>(elem != value);
+    }
+    return dst;
+}
+
+// copy src[i] to dst if the i-th bit of keep is set, size <= 64, dst should never be after src.
+template <Element T>
+[[nodiscard]] inline auto compress_scalar(T* dst, const T* src, std::size_t size, uint64_t keep) noexcept -> T* {
+    for (std::size_t i = 0; i < size; ++i) {
+        dst[0] = src[i];  // NOLINT
+        dst += (keep >> i) & 1U;
+    }
+    return dst;
+}
+
+/*
+ * word-level kernels of bitmaps, dst = dst op src.
+ */
+enum class BitOp : uint8_t
+{
+    And,
+    Or,
+    Xor,
+    AndNot,  // dst & ~src
+};
+
+template <BitOp Op>
+[[nodiscard, gnu::always_inline]] constexpr auto bit_op(uint64_t dst, uint64_t src) noexcept -> uint64_t {
+    if constexpr (Op == BitOp::And) {
+        return dst & src;
+    } else if constexpr (Op == BitOp::Or) {
+        return dst | src;
+    } else if constexpr (Op == BitOp::Xor) {
+        return dst ^ src;
+    } else {
+        return dst & ~src;
+    }
+}
+
+template <BitOp Op>
+inline void bitwise_scalar(uint64_t* dst, const uint64_t* src, std::size_t words) noexcept {
+    for (std::size_t i = 0; i < words; ++i) {
+        dst[i] = bit_op<Op>(dst[i], src[i]);  // NOLINT
+    }
+}
+
+[[nodiscard]] inline auto count_bits_scalar(const uint64_t* words, std::size_t size) noexcept -> std::size_t {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        count += static_cast<std::size_t>(std::popcount(words[i]));  // NOLINT
+    }
+    return count;
+}
+
+#if defined(__x86_64__)
+
+namespace detail {
+
+template <Element T>
+using lane_t = std::conditional_t<
+  sizeof(T) == 1, int8_t,
+  std::conditional_t<sizeof(T) == 2, int16_t, std::conditional_t<sizeof(T) == 4, int32_t, long long>>>;  // NOLINT
+
+// the permutation of 8 x 32-bit lanes which packs the kept lanes to the front, indexed by the keep mask.
+alignas(32) inline constexpr auto kPermuteLut = [] {
+    std::array<std::array<uint32_t, 8>, 256> lut{};
+    for (uint32_t mask = 0; mask < 256; ++mask) {
+        uint32_t out = 0;
+        for (uint32_t lane = 0; lane < 8; ++lane) {
+            if (((mask >> lane) & 1U) != 0) {
+                lut[mask][out++] = lane;
+            }
+        }
+    }
+    return lut;
+}();
+
+// the pshufb control of 4 x 32-bit lanes which packs the kept lanes to the front, indexed by the keep mask.
+alignas(16) inline constexpr auto kShuffleLut = [] {
+    std::array<std::array<uint8_t, 16>, 16> lut{};
+    for (uint32_t mask = 0; mask < 16; ++mask) {
+        uint32_t out = 0;
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            if (((mask >> lane) & 1U) != 0) {
+                for (uint32_t byte = 0; byte < 4; ++byte) {
+                    lut[mask][out++] = static_cast<uint8_t>(lane * 4 + byte);
+                }
+            }
+        }
+    }
+    return lut;
+}();
+
+// one bit of a 64-bit lane to two bits of its 32-bit halves, for the 32-bit permutation tables.
+[[nodiscard, gnu::always_inline]] constexpr auto spread_pairs(uint32_t bits) noexcept -> uint32_t {
+    return ((bits & 1U) * 3U) | ((bits & 2U) * 6U) | ((bits & 4U) * 12U) | ((bits & 8U) * 24U);
+}
+
+/*
+ * SSE4.1
+ */
+template <Element T>
+[[nodiscard, gnu::target("sse4.1"), gnu::always_inline]] inline auto broadcast_sse(T value) noexcept -> __m128i {
+    auto lane = std::bit_cast<lane_t<T>>(value);
+    if constexpr (sizeof(T) == 1) {
+        return _mm_set1_epi8(lane);
+    } else if constexpr (sizeof(T) == 2) {
+        return _mm_set1_epi16(lane);
+    } else if constexpr (sizeof(T) == 4) {
+        return _mm_set1_epi32(lane);
+    } else {
+        return _mm_set1_epi64x(lane);
+    }
+}
+
+template <Element T>
+[[nodiscard, gnu::target("sse4.1"), gnu::always_inline]] inline auto equal_sse(const T* src, __m128i needle) noexcept
+  -> __m128i {
+    auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));  // NOLINT
+    if constexpr (std::is_same_v<T, float>) {
+        return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(data), _mm_castsi128_ps(needle)));
+    } else if constexpr (std::is_same_v<T, double>) {
+        return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(data), _mm_castsi128_pd(needle)));
+    } else if constexpr (sizeof(T) == 1) {
+        return _mm_cmpeq_epi8(data, needle);
+    } else if constexpr (sizeof(T) == 2) {
+        return _mm_cmpeq_epi16(data, needle);
+    } else if constexpr (sizeof(T) == 4) {
+        return _mm_cmpeq_epi32(data, needle);
+    } else {
+        return _mm_cmpeq_epi64(data, needle);
+    }
+}
+
+template <Element T>
+[[nodiscard, gnu::target("sse4.1")]] inline auto find_sse(const T* first, const T* last, T value) noexcept
+  -> const T* {
+    constexpr std::size_t kLanes = sizeof(__m128i) / sizeof(T);
+    const __m128i needle = broadcast_sse(value);
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        if (auto bits = static_cast<uint32_t>(_mm_movemask_epi8(equal_sse(first, needle))); bits != 0) {
+            return first + static_cast<std::size_t>(std::countr_zero(bits)) / sizeof(T);
+        }
+    }
+    return find_scalar(first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target("sse4.1,popcnt")]] inline auto count_sse(const T* first, const T* last, T value) noexcept
+  -> std::size_t {
+    constexpr std::size_t kLanes = sizeof(__m128i) / sizeof(T);
+    const __m128i needle = broadcast_sse(value);
+    std::size_t matched_bytes = 0;
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        matched_bytes += static_cast<std::size_t>(
+          std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(equal_sse(first, needle)))));
+    }
+    return matched_bytes / sizeof(T) + count_scalar(first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target("sse4.1,popcnt")]] inline auto remove_sse(T* dst, const T* first, const T* last,
+                                                                   T value) noexcept -> T* {
+    if constexpr (sizeof(T) >= 4) {
+        constexpr std::size_t kLanes = sizeof(__m128i) / sizeof(T);
+        const __m128i needle = broadcast_sse(value);
+        for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+            auto equal = equal_sse(first, needle);
+            auto keep = ~static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(equal))) & 0xFU;
+            auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));                       // NOLINT
+            auto control = _mm_load_si128(reinterpret_cast<const __m128i*>(kShuffleLut[keep].data()));  // NOLINT
+            // the whole register is stored, the lanes after the kept ones were read already.
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(data, control));  // NOLINT
+            dst += static_cast<std::size_t>(std::popcount(keep)) * 4 / sizeof(T);
+        }
+    }
+    return remove_scalar(dst, first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target("sse4.1,popcnt")]] inline auto compress_sse(T* dst, const T* src, std::size_t size,
+                                                                     uint64_t keep) noexcept -> T* {
+    if constexpr (sizeof(T) >= 4) {
+        constexpr std::size_t kLanes = sizeof(__m128i) / sizeof(T);
+        for (; size >= kLanes; size -= kLanes, src += kLanes, keep >>= kLanes) {
+            auto bits = static_cast<uint32_t>(keep & ((1U << kLanes) - 1));
+            if constexpr (sizeof(T) == 8) {
+                bits = spread_pairs(bits);
+            }
+            auto data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));                         // NOLINT
+            auto control = _mm_load_si128(reinterpret_cast<const __m128i*>(kShuffleLut[bits].data()));  // NOLINT
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(data, control));         // NOLINT
+            dst += static_cast<std::size_t>(std::popcount(bits)) * 4 / sizeof(T);
+        }
+    }
+    return compress_scalar(dst, src, size, keep);
+}
+
+/*
+ * AVX2
+ */
+template <BitOp Op>
+[[gnu::target("sse4.1")]] inline void bitwise_sse(uint64_t* dst, const uint64_t* src, std::size_t words) noexcept {
+    constexpr std::size_t kLanes = sizeof(__m128i) / sizeof(uint64_t);
+    std::size_t i = 0;
+    for (; i + kLanes <= words; i += kLanes) {
+        auto lhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));  // NOLINT
+        auto rhs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));  // NOLINT
+        __m128i result;
+        if constexpr (Op == BitOp::And) {
+            result = _mm_and_si128(lhs, rhs);
+        } else if constexpr (Op == BitOp::Or) {
+            result = _mm_or_si128(lhs, rhs);
+        } else if constexpr (Op == BitOp::Xor) {
+            result = _mm_xor_si128(lhs, rhs);
+        } else {
+            result = _mm_andnot_si128(rhs, lhs);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);  // NOLINT
+    }
+    bitwise_scalar<Op>(dst + i, src + i, words - i);
+}
+
+// counting bits needs the popcnt instruction only, it is shared by all the levels.
+[[nodiscard, gnu::target("popcnt")]] inline auto count_bits_popcnt(const uint64_t* words, std::size_t size) noexcept
+  -> std::size_t {
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        count += static_cast<std::size_t>(std::popcount(words[i]));  // NOLINT
+    }
+    return count;
+}
+
+template <Element T>
+[[nodiscard, gnu::target("avx2"), gnu::always_inline]] inline auto broadcast_avx2(T value) noexcept -> __m256i {
+    auto lane = std::bit_cast<lane_t<T>>(value);
+    if constexpr (sizeof(T) == 1) {
+        return _mm256_set1_epi8(lane);
+    } else if constexpr (sizeof(T) == 2) {
+        return _mm256_set1_epi16(lane);
+    } else if constexpr (sizeof(T) == 4) {
+        return _mm256_set1_epi32(lane);
+    } else {
+        return _mm256_set1_epi64x(lane);
+    }
+}
+
+template <Element T>
+[[nodiscard, gnu::target("avx2"), gnu::always_inline]] inline auto equal_avx2(const T* src, __m256i needle) noexcept
+  -> __m256i {
+    auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));  // NOLINT
+    if constexpr (std::is_same_v<T, float>) {
+        return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(data), _mm256_castsi256_ps(needle), _CMP_EQ_OQ));
+    } else if constexpr (std::is_same_v<T, double>) {
+        return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(data), _mm256_castsi256_pd(needle), _CMP_EQ_OQ));
+    } else if constexpr (sizeof(T) == 1) {
+        return _mm256_cmpeq_epi8(data, needle);
+    } else if constexpr (sizeof(T) == 2) {
+        return _mm256_cmpeq_epi16(data, needle);
+    } else if constexpr (sizeof(T) == 4) {
+        return _mm256_cmpeq_epi32(data, needle);
+    } else {
+        return _mm256_cmpeq_epi64(data, needle);
+    }
+}
+
+template <Element T>
+[[nodiscard, gnu::target("avx2")]] inline auto find_avx2(const T* first, const T* last, T value) noexcept
+  -> const T* {
+    constexpr std::size_t kLanes = sizeof(__m256i) / sizeof(T);
+    const __m256i needle = broadcast_avx2(value);
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        if (auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(equal_avx2(first, needle))); bits != 0) {
+            return first + static_cast<std::size_t>(std::countr_zero(bits)) / sizeof(T);
+        }
+    }
+    return find_sse(first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target("avx2,popcnt")]] inline auto count_avx2(const T* first, const T* last, T value) noexcept
+  -> std::size_t {
+    constexpr std::size_t kLanes = sizeof(__m256i) / sizeof(T);
+    const __m256i needle = broadcast_avx2(value);
+    std::size_t matched_bytes = 0;
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        matched_bytes += static_cast<std::size_t>(
+          std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(equal_avx2(first, needle)))));
+    }
+    return matched_bytes / sizeof(T) + count_sse(first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target("avx2,popcnt")]] inline auto remove_avx2(T* dst, const T* first, const T* last,
+                                                                  T value) noexcept -> T* {
+    if constexpr (sizeof(T) >= 4) {
+        constexpr std::size_t kLanes = sizeof(__m256i) / sizeof(T);
+        const __m256i needle = broadcast_avx2(value);
+        for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+            auto equal = equal_avx2(first, needle);
+            auto keep = ~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(equal))) & 0xFFU;
+            auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));                       // NOLINT
+            auto control = _mm256_load_si256(reinterpret_cast<const __m256i*>(kPermuteLut[keep].data()));  // NOLINT
+            // the whole register is stored, the lanes after the kept ones were read already.
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(data, control));  // NOLINT
+            dst += static_cast<std::size_t>(std::popcount(keep)) * 4 / sizeof(T);
+        }
+    }
+    return remove_sse(dst, first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target("avx2,popcnt")]] inline auto compress_avx2(T* dst, const T* src, std::size_t size,
+                                                                    uint64_t keep) noexcept -> T* {
+    if constexpr (sizeof(T) >= 4) {
+        constexpr std::size_t kLanes = sizeof(__m256i) / sizeof(T);
+        for (; size >= kLanes; size -= kLanes, src += kLanes, keep >>= kLanes) {
+            auto bits = static_cast<uint32_t>(keep & ((1U << kLanes) - 1));
+            if constexpr (sizeof(T) == 8) {
+                bits = spread_pairs(bits);
+            }
+            auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));                         // NOLINT
+            auto control = _mm256_load_si256(reinterpret_cast<const __m256i*>(kPermuteLut[bits].data()));  // NOLINT
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_permutevar8x32_epi32(data, control));  // NOLINT
+            dst += static_cast<std::size_t>(std::popcount(bits)) * 4 / sizeof(T);
+        }
+    }
+    return compress_sse(dst, src, size, keep);
+}
+
+template <BitOp Op>
+[[gnu::target("avx2")]] inline void bitwise_avx2(uint64_t* dst, const uint64_t* src, std::size_t words) noexcept {
+    constexpr std::size_t kLanes = sizeof(__m256i) / sizeof(uint64_t);
+    std::size_t i = 0;
+    for (; i + kLanes <= words; i += kLanes) {
+        auto lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));  // NOLINT
+        auto rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));  // NOLINT
+        __m256i result;
+        if constexpr (Op == BitOp::And) {
+            result = _mm256_and_si256(lhs, rhs);
+        } else if constexpr (Op == BitOp::Or) {
+            result = _mm256_or_si256(lhs, rhs);
+        } else if constexpr (Op == BitOp::Xor) {
+            result = _mm256_xor_si256(lhs, rhs);
+        } else {
+            result = _mm256_andnot_si256(rhs, lhs);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);  // NOLINT
+    }
+    bitwise_sse<Op>(dst + i, src + i, words - i);
+}
+
+/*
+ * AVX-512, the lane masks are native, and vpcompress packs the kept lanes.
+ * vpcompressd/q are avx512f, vpcompressb/w are avx512vbmi2, so the 8/16-bit remove and compress have their own
+ * STDB_SIMD_AVX512_VBMI2 versions, and the other kernels run on skylake-x and cascade lake too.
+ */
+#define STDB_SIMD_AVX512 "avx512f,avx512bw,popcnt"                     // NOLINT
+#define STDB_SIMD_AVX512_VBMI2 "avx512f,avx512bw,avx512vbmi2,popcnt"  // NOLINT
+
+template <Element T>
+[[nodiscard, gnu::target(STDB_SIMD_AVX512), gnu::always_inline]] inline auto broadcast_avx512(T value) noexcept
+  -> __m512i {
+    auto lane = std::bit_cast<lane_t<T>>(value);
+    if constexpr (sizeof(T) == 1) {
+        return _mm512_set1_epi8(lane);
+    } else if constexpr (sizeof(T) == 2) {
+        return _mm512_set1_epi16(lane);
+    } else if constexpr (sizeof(T) == 4) {
+        return _mm512_set1_epi32(lane);
+    } else {
+        return _mm512_set1_epi64(lane);
+    }
+}
+
+template <Element T>
+[[nodiscard, gnu::target(STDB_SIMD_AVX512), gnu::always_inline]] inline auto equal_avx512(__m512i data,
+                                                                                          __m512i needle) noexcept
+  -> uint64_t {
+    if constexpr (std::is_same_v<T, float>) {
+        return _mm512_cmp_ps_mask(_mm512_castsi512_ps(data), _mm512_castsi512_ps(needle), _CMP_EQ_OQ);
+    } else if constexpr (std::is_same_v<T, double>) {
+        return _mm512_cmp_pd_mask(_mm512_castsi512_pd(data), _mm512_castsi512_pd(needle), _CMP_EQ_OQ);
+    } else if constexpr (sizeof(T) == 1) {
+        return _mm512_cmpeq_epi8_mask(data, needle);
+    } else if constexpr (sizeof(T) == 2) {
+        return _mm512_cmpeq_epi16_mask(data, needle);
+    } else if constexpr (sizeof(T) == 4) {
+        return _mm512_cmpeq_epi32_mask(data, needle);
+    } else {
+        return _mm512_cmpeq_epi64_mask(data, needle);
+    }
+}
+
+template <Element T>
+    requires(sizeof(T) >= 4)
+[[nodiscard, gnu::target(STDB_SIMD_AVX512), gnu::always_inline]] inline auto compress_avx512(uint64_t keep,
+                                                                                             __m512i data) noexcept
+  -> __m512i {
+    if constexpr (sizeof(T) == 4) {
+        return _mm512_maskz_compress_epi32(static_cast<__mmask16>(keep), data);
+    } else {
+        return _mm512_maskz_compress_epi64(static_cast<__mmask8>(keep), data);
+    }
+}
+
+template <Element T>
+    requires(sizeof(T) <= 2)
+[[nodiscard, gnu::target(STDB_SIMD_AVX512_VBMI2), gnu::always_inline]] inline auto compress_vbmi2(uint64_t keep,
+                                                                                                  __m512i data) noexcept
+  -> __m512i {
+    if constexpr (sizeof(T) == 1) {
+        return _mm512_maskz_compress_epi8(keep, data);
+    } else {
+        return _mm512_maskz_compress_epi16(static_cast<__mmask32>(keep), data);
+    }
+}
+
+template <Element T>
+[[nodiscard, gnu::target(STDB_SIMD_AVX512)]] inline auto find_avx512(const T* first, const T* last, T value) noexcept
+  -> const T* {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(T);
+    const __m512i needle = broadcast_avx512(value);
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        auto data = _mm512_loadu_si512(first);
+        if (auto bits = equal_avx512<T>(data, needle); bits != 0) {
+            return first + std::countr_zero(bits);
+        }
+    }
+    return find_avx2(first, last, value);
+}
+
+template <Element T>
+[[nodiscard, gnu::target(STDB_SIMD_AVX512)]] inline auto count_avx512(const T* first, const T* last, T value) noexcept
+  -> std::size_t {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(T);
+    const __m512i needle = broadcast_avx512(value);
+    std::size_t count = 0;
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        count += static_cast<std::size_t>(std::popcount(equal_avx512<T>(_mm512_loadu_si512(first), needle)));
+    }
+    return count + count_avx2(first, last, value);
+}
+
+template <Element T>
+    requires(sizeof(T) >= 4)
+[[nodiscard, gnu::target(STDB_SIMD_AVX512)]] inline auto remove_avx512(T* dst, const T* first, const T* last,
+                                                                       T value) noexcept -> T* {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(T);
+    constexpr uint64_t kAllLanes = (uint64_t{1} << kLanes) - 1;
+    const __m512i needle = broadcast_avx512(value);
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        auto data = _mm512_loadu_si512(first);
+        auto keep = ~equal_avx512<T>(data, needle) & kAllLanes;
+        // the whole register is stored, the lanes after the kept ones were read already.
+        _mm512_storeu_si512(dst, compress_avx512<T>(keep, data));
+        dst += std::popcount(keep);
+    }
+    return remove_avx2(dst, first, last, value);
+}
+
+template <Element T>
+    requires(sizeof(T) <= 2)
+[[nodiscard, gnu::target(STDB_SIMD_AVX512_VBMI2)]] inline auto remove_vbmi2(T* dst, const T* first, const T* last,
+                                                                            T value) noexcept -> T* {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(T);
+    constexpr uint64_t kAllLanes = kLanes == 64 ? ~uint64_t{0} : (uint64_t{1} << kLanes) - 1;
+    const __m512i needle = broadcast_avx512(value);
+    for (; static_cast<std::size_t>(last - first) >= kLanes; first += kLanes) {
+        auto data = _mm512_loadu_si512(first);
+        auto keep = ~equal_avx512<T>(data, needle) & kAllLanes;
+        _mm512_storeu_si512(dst, compress_vbmi2<T>(keep, data));
+        dst += std::popcount(keep);
+    }
+    return remove_avx2(dst, first, last, value);
+}
+
+template <Element T>
+    requires(sizeof(T) >= 4)
+[[nodiscard, gnu::target(STDB_SIMD_AVX512)]] inline auto compress_avx512(T* dst, const T* src, std::size_t size,
+                                                                         uint64_t keep) noexcept -> T* {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(T);
+    constexpr uint64_t kAllLanes = (uint64_t{1} << kLanes) - 1;
+    for (; size >= kLanes; size -= kLanes, src += kLanes) {
+        auto bits = keep & kAllLanes;
+        _mm512_storeu_si512(dst, compress_avx512<T>(bits, _mm512_loadu_si512(src)));
+        dst += std::popcount(bits);
+        keep >>= kLanes;
+    }
+    return compress_avx2(dst, src, size, keep);
+}
+
+template <Element T>
+    requires(sizeof(T) <= 2)
+[[nodiscard, gnu::target(STDB_SIMD_AVX512_VBMI2)]] inline auto compress_vbmi2(T* dst, const T* src, std::size_t size,
+                                                                              uint64_t keep) noexcept -> T* {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(T);
+    constexpr uint64_t kAllLanes = kLanes == 64 ? ~uint64_t{0} : (uint64_t{1} << kLanes) - 1;
+    for (; size >= kLanes; size -= kLanes, src += kLanes) {
+        auto bits = keep & kAllLanes;
+        _mm512_storeu_si512(dst, compress_vbmi2<T>(bits, _mm512_loadu_si512(src)));
+        dst += std::popcount(bits);
+        // shift by 64 is undefined.
+        keep = kLanes == 64 ? 0 : keep >> (kLanes % 64);
+    }
+    return compress_avx2(dst, src, size, keep);
+}
+
+template <BitOp Op>
+[[gnu::target(STDB_SIMD_AVX512)]] inline void bitwise_avx512(uint64_t* dst, const uint64_t* src,
+                                                             std::size_t words) noexcept {
+    constexpr std::size_t kLanes = sizeof(__m512i) / sizeof(uint64_t);
+    std::size_t i = 0;
+    for (; i + kLanes <= words; i += kLanes) {
+        auto lhs = _mm512_loadu_si512(dst + i);
+        auto rhs = _mm512_loadu_si512(src + i);
+        __m512i result;
+        if constexpr (Op == BitOp::And) {
+            result = _mm512_and_si512(lhs, rhs);
+        } else if constexpr (Op == BitOp::Or) {
+            result = _mm512_or_si512(lhs, rhs);
+        } else if constexpr (Op == BitOp::Xor) {
+            result = _mm512_xor_si512(lhs, rhs);
+        } else {
+            // lhs & ~rhs, _mm512_andnot_si512 trips -Wmaybe-uninitialized in the g++ 12 headers.
+            result = _mm512_xor_si512(lhs, _mm512_and_si512(lhs, rhs));
+        }
+        _mm512_storeu_si512(dst + i, result);
+    }
+    bitwise_avx2<Op>(dst + i, src + i, words - i);
+}
+
+#undef STDB_SIMD_AVX512
+#undef STDB_SIMD_AVX512_VBMI2
+
+}  // namespace detail
+
+#endif  // __x86_64__
+
+/*
+ * the dispatchers, level should never be higher than detect_level(), it is only for testing.
+ */
+template <Element T>
+[[nodiscard]] inline auto find(const T* first, const T* last, T value, Level level = active_level()) noexcept
+  -> const T* {
+    switch (level) {
+#if defined(__x86_64__)
+        case Level::AVX512_VBMI2:
+        case Level::AVX512:
+            return detail::find_avx512(first, last, value);
+        case Level::AVX2:
+            return detail::find_avx2(first, last, value);
+        case Level::SSE4_1:
+            return detail::find_sse(first, last, value);
+#endif
+        default:
+            return find_scalar(first, last, value);
+    }
+}
+
+template <Element T>
+[[nodiscard]] inline auto count(const T* first, const T* last, T value, Level level = active_level()) noexcept
+  -> std::size_t {
+    switch (level) {
+#if defined(__x86_64__)
+        case Level::AVX512_VBMI2:
+        case Level::AVX512:
+            return detail::count_avx512(first, last, value);
+        case Level::AVX2:
+            return detail::count_avx2(first, last, value);
+        case Level::SSE4_1:
+            return detail::count_sse(first, last, value);
+#endif
+        default:
+            return count_scalar(first, last, value);
+    }
+}
+
+/*
+ * remove the elements equal to value from [first, last) in place, and return the new last.
+ */
+template <Element T>
+[[nodiscard]] inline auto remove(T* first, T* last, T value, Level level = active_level()) noexcept -> T* {
+    switch (level) {
+#if defined(__x86_64__)
+        case Level::AVX512_VBMI2:
+            if constexpr (sizeof(T) <= 2) {
+                return detail::remove_vbmi2(first, first, last, value);
+            }
+            [[fallthrough]];
+        case Level::AVX512:
+            // the 8/16-bit lanes have no compress without avx512vbmi2.
+            if constexpr (sizeof(T) >= 4) {
+                return detail::remove_avx512(first, first, last, value);
+            }
+            [[fallthrough]];
+        case Level::AVX2:
+            return detail::remove_avx2(first, first, last, value);
+        case Level::SSE4_1:
+            return detail::remove_sse(first, first, last, value);
+#endif
+        default:
+            return remove_scalar(first, first, last, value);
+    }
+}
+
+/*
+ * keep src[i] if the i-th bit of keep is set, and pack them to dst, size <= 64, dst should never be after src.
+ * it is the compaction of erase_if, the keep mask is computed by the predicate.
+ */
+template <Element T>
+[[nodiscard]] inline auto compress(T* dst, const T* src, std::size_t size, uint64_t keep,
+                                   Level level = active_level()) noexcept -> T* {
+    switch (level) {
+#if defined(__x86_64__)
+        case Level::AVX512_VBMI2:
+            if constexpr (sizeof(T) <= 2) {
+                return detail::compress_vbmi2(dst, src, size, keep);
+            }
+            [[fallthrough]];
+        case Level::AVX512:
+            if constexpr (sizeof(T) >= 4) {
+                return detail::compress_avx512(dst, src, size, keep);
+            }
+            [[fallthrough]];
+        case Level::AVX2:
+            return detail::compress_avx2(dst, src, size, keep);
+        case Level::SSE4_1:
+            return detail::compress_sse(dst, src, size, keep);
+#endif
+        default:
+            return compress_scalar(dst, src, size, keep);
+    }
+}
+
+/*
+ * dst[i] = dst[i] op src[i] for the words of two bitmaps.
+ */
+template <BitOp Op>
+inline void bitwise(uint64_t* dst, const uint64_t* src, std::size_t words, Level level = active_level()) noexcept {
+    switch (level) {
+#if defined(__x86_64__)
+        case Level::AVX512_VBMI2:
+        case Level::AVX512:
+            return detail::bitwise_avx512<Op>(dst, src, words);
+        case Level::AVX2:
+            return detail::bitwise_avx2<Op>(dst, src, words);
+        case Level::SSE4_1:
+            return detail::bitwise_sse<Op>(dst, src, words);
+#endif
+        default:
+            return bitwise_scalar<Op>(dst, src, words);
+    }
+}
+
+// the number of set bits in words[0, size).
+[[nodiscard]] inline auto count_bits(const uint64_t* words, std::size_t size,
+                                     [[maybe_unused]] Level level = active_level()) noexcept -> std::size_t {
+#if defined(__x86_64__)
+    if (level != Level::Scalar) {
+        return detail::count_bits_popcnt(words, size);
+    }
+#endif
+    return count_bits_scalar(words, size);
+}
+
+}  // namespace stdb::container::simd
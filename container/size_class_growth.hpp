@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uintptr_t
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "container/stdb_vector.hpp"
+
+// provided by jemalloc and tcmalloc, it is nullptr with other mallocs.
+extern "C" {
+[[gnu::weak]] auto nallocx(std::size_t size, int flags) noexcept -> std::size_t;
+}
+
+namespace stdb::container {
+
+/*
+ * grow like default_growth, then round the bytes up to the size class of malloc (nallocx of jemalloc/tcmalloc),
+ * and adopt the tail slack of the allocated block (malloc_usable_size), so the capacity is what malloc gives.
+ * the buffers larger than kHugePageSize are rounded up to huge pages, and advised to be backed by THP.
+ */
+struct size_class_growth
+{
+    static constexpr std::size_t kHugePageSize = 2UL * 1024 * 1024;
+
+    template <typename T>
+    [[nodiscard]] static auto grow(std::size_t cap, std::size_t min_cap) noexcept -> std::size_t {
+        std::size_t bytes = default_growth::grow<T>(cap, min_cap) * sizeof(T);
+        if (bytes >= kHugePageSize) {
+            bytes = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+        } else if (nallocx != nullptr) {
+            bytes = nallocx(bytes, 0);
+        }
+        return bytes / sizeof(T);
+    }
+
+    [[nodiscard]] static auto allocated(void* ptr, std::size_t bytes) noexcept -> std::size_t {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        if (bytes >= kHugePageSize) {
+            // only the huge pages inside the buffer can be advised.
+            auto begin = (reinterpret_cast<uintptr_t>(ptr) + kHugePageSize - 1) & ~(kHugePageSize - 1);  // NOLINT
+            auto end = (reinterpret_cast<uintptr_t>(ptr) + bytes) & ~(kHugePageSize - 1);                // NOLINT
+            if (begin < end) {
+                ::madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);  // NOLINT
+            }
+        }
+#endif
+#if defined(__GLIBC__)
+        // jemalloc and tcmalloc export malloc_usable_size as well.
+        return ::malloc_usable_size(ptr);
+#else
+        return bytes;
+#endif
+    }
+};
+
+}  // namespace stdb::container
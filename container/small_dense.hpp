@@ -5,6 +5,7 @@
 #include <format>
 #include <print>
 #include "assert_config.hpp"
+#include "trace_config.hpp"
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -517,6 +518,8 @@ class inplace_table
     auto do_rehash_with_new_shift(uint8_t new_shifts) -> void {
         // assume that the _shifts is set correctly
         Assert(_shifts != new_shifts, "the new shifts was not changed!");
+        STDB_TRACE(inplace_table_rehash, this, _size, calc_num_buckets_by_shift<bucket_index_t>(_shifts),
+                   calc_num_buckets_by_shift<bucket_index_t>(new_shifts), sizeof(bucket_t));
         _shifts = new_shifts;
         auto num_of_new_buckets = calc_num_buckets_by_shift<bucket_index_t>(new_shifts);
         Assert(num_of_new_buckets * _max_load_factor >= _size, "the new bucket capacity is not enough");
@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <cstddef>      // for size_t
+#include <cstdlib>      // for malloc, free
+#include <new>          // for bad_alloc
+#include <span>         // for span
+#include <tuple>        // for tuple, get, apply, tuple_element_t
+#include <type_traits>  // for remove_reference_t, integral_constant, is_nothrow_default_constructible_v
+#include <utility>      // for index_sequence, exchange, forward
+
+#include "assert_config.hpp"
+#include "container/stdb_vector.hpp"
+
+namespace stdb::container {
+
+/*
+ * soa_vector is a columnar (struct of arrays) vector, every field is stored in its own buffer,
+ * and all the columns share one size and one capacity.
+ * a scan of one field touches that column only, column<I>() returns it as a std::span.
+ *
+ * the columns grow together: the new buffers are all allocated before any element is relocated,
+ * so a std::bad_alloc, or an exception from the constructor of a field, leaves the vector untouched.
+ */
+template <typename... Fields>
+    requires(sizeof...(Fields) > 0)
+class soa_vector
+{
+   public:
+    using size_type = std::size_t;
+    using value_type = std::tuple<Fields...>;
+    using reference = std::tuple<Fields&...>;
+    using const_reference = std::tuple<const Fields&...>;
+
+    template <std::size_t I>
+    using field_type = std::tuple_element_t<I, value_type>;
+
+    static constexpr std::size_t kColumns = sizeof...(Fields);
+
+    soa_vector() = default;
+
+    explicit soa_vector(size_type size) {
+        if (size > 0) {
+            _columns = allocate_columns(size);
+            try {
+                construct_columns(0, size);
+            } catch (...) {
+                free_columns(_columns);
+                throw;
+            }
+            _capacity = _size = size;
+        }
+    }
+
+    soa_vector(const soa_vector& other) {
+        if (other._size > 0) {
+            _columns = allocate_columns(other._size);
+            try {
+                copy_columns(other);
+            } catch (...) {
+                free_columns(_columns);
+                throw;
+            }
+            _capacity = _size = other._size;
+        }
+    }
+
+    soa_vector(soa_vector&& other) noexcept
+        : _columns(std::exchange(other._columns, {})),
+          _size(std::exchange(other._size, 0)),
+          _capacity(std::exchange(other._capacity, 0)) {}
+
+    auto operator=(const soa_vector& other) -> soa_vector& {
+        if (this == &other) [[unlikely]] {
+            return *this;
+        }
+        clear();
+        if (other._size > _capacity) {
+            release();
+            _columns = allocate_columns(other._size);
+            _capacity = other._size;
+        }
+        if (other._size > 0) {
+            // the vector is left empty if a field throws.
+            copy_columns(other);
+            _size = other._size;
+        }
+        return *this;
+    }
+
+    auto operator=(soa_vector&& other) noexcept -> soa_vector& {
+        if (this == &other) [[unlikely]] {
+            return *this;
+        }
+        clear();
+        release();
+        _columns = std::exchange(other._columns, {});
+        _size = std::exchange(other._size, 0);
+        _capacity = std::exchange(other._capacity, 0);
+        return *this;
+    }
+
+    ~soa_vector() {
+        clear();
+        release();
+    }
+
+    /*
+     * Capacity section
+     */
+    [[nodiscard, gnu::always_inline]] inline auto size() const noexcept -> size_type { return _size; }
+
+    [[nodiscard, gnu::always_inline]] inline auto capacity() const noexcept -> size_type { return _capacity; }
+
+    [[nodiscard, gnu::always_inline]] inline auto empty() const noexcept -> bool { return _size == 0; }
+
+    [[nodiscard, gnu::always_inline]] inline auto full() const noexcept -> bool { return _size == _capacity; }
+
+    void reserve(size_type new_capacity) {
+        if (new_capacity > _capacity) [[likely]] {
+            relocate_columns(new_capacity);
+        }
+    }
+
+    void shrink_to_fit() {
+        if (_size == _capacity) [[unlikely]] {
+            return;
+        }
+        if (_size == 0) {
+            release();
+            return;
+        }
+        relocate_columns(_size);
+    }
+
+    /*
+     * Element access section
+     */
+    template <std::size_t I>
+    [[nodiscard, gnu::always_inline]] inline auto column() noexcept -> std::span<field_type<I>> {
+        return std::span<field_type<I>>(std::get<I>(_columns), _size);
+    }
+
+    template <std::size_t I>
+    [[nodiscard, gnu::always_inline]] inline auto column() const noexcept -> std::span<const field_type<I>> {
+        return std::span<const field_type<I>>(std::get<I>(_columns), _size);
+    }
+
+    [[nodiscard]] auto operator[](size_type index) noexcept -> reference {
+        Assert(index < _size, "index out of range");
+        return std::apply([index](Fields*... columns) { return reference(columns[index]...); }, _columns);
+    }
+
+    [[nodiscard]] auto operator[](size_type index) const noexcept -> const_reference {
+        Assert(index < _size, "index out of range");
+        return std::apply([index](Fields*... columns) { return const_reference(columns[index]...); }, _columns);
+    }
+
+    [[nodiscard]] auto front() noexcept -> reference { return (*this)[0]; }
+
+    [[nodiscard]] auto front() const noexcept -> const_reference { return (*this)[0]; }
+
+    [[nodiscard]] auto back() noexcept -> reference { return (*this)[_size - 1]; }
+
+    [[nodiscard]] auto back() const noexcept -> const_reference { return (*this)[_size - 1]; }
+
+    /*
+     * Modifiers section
+     */
+    template <Safety safety = Safety::Safe, typename... Args>
+        requires(sizeof...(Args) == sizeof...(Fields))
+    void emplace_back(Args&&... args) {
+        if constexpr (safety == Safety::Safe) {
+            if (full()) [[unlikely]] {
+                // the new row is constructed before the old columns are freed, args may refer to them.
+                auto fresh = allocate_columns(next_capacity());
+                try {
+                    construct_row(fresh, _size, std::forward<Args>(args)...);
+                } catch (...) {
+                    free_columns(fresh);
+                    throw;
+                }
+                relocate_to(fresh);
+                _capacity = next_capacity();
+                ++_size;
+                return;
+            }
+        }
+        Assert(not full(), "emplace_back should not be called with full soa_vector");
+        construct_row(_columns, _size, std::forward<Args>(args)...);
+        ++_size;
+    }
+
+    template <Safety safety = Safety::Safe>
+    void push_back(const value_type& row) {
+        std::apply([this](const Fields&... fields) { emplace_back<safety>(fields...); }, row);
+    }
+
+    template <Safety safety = Safety::Safe>
+    void push_back(value_type&& row) {
+        std::apply([this](Fields&... fields) { emplace_back<safety>(std::move(fields)...); }, row);
+    }
+
+    void pop_back() noexcept {
+        Assert(_size > 0, "pop_back should not be called with empty soa_vector");
+        --_size;
+        for_each_column([this](auto* column) { destroy_ptr(column + _size); });
+    }
+
+    void resize(size_type count) {
+        if (count > _size) {
+            if (count > _capacity) {
+                relocate_columns(count);
+            }
+            construct_columns(_size, count);
+        } else {
+            for_each_column([this, count](auto* column) { destroy_range(column + count, column + _size); });
+        }
+        _size = count;
+    }
+
+    void clear() noexcept {
+        for_each_column([this](auto* column) { destroy_range(column, column + _size); });
+        _size = 0;
+    }
+
+    void swap(soa_vector& other) noexcept {
+        std::swap(_columns, other._columns);
+        std::swap(_size, other._size);
+        std::swap(_capacity, other._capacity);
+    }
+
+   private:
+    using columns_type = std::tuple<Fields*...>;
+
+    template <typename Func>
+    [[gnu::always_inline]] inline void for_each_column(Func&& func) {
+        std::apply([&func](auto*... columns) { (func(columns), ...); }, _columns);
+    }
+
+    [[nodiscard]] auto next_capacity() const noexcept -> size_type {
+        // a row is the unit of growth, like a stdb_vector of the row struct.
+        return default_growth::grow<value_type>(_capacity, _capacity + 1);
+    }
+
+    // allocate all the columns, or none of them.
+    [[nodiscard]] static auto allocate_columns(size_type capacity) -> columns_type {
+        columns_type columns{};
+        bool failed = false;
+        std::apply(
+          [capacity, &failed](auto*&... column) {
+              ((column = failed ? nullptr
+                                : static_cast<std::remove_reference_t<decltype(*column)>*>(
+                                    std::malloc(capacity * sizeof(*column))),
+                failed = failed or column == nullptr),
+               ...);
+          },
+          columns);
+        if (failed) [[unlikely]] {
+            free_columns(columns);
+            throw std::bad_alloc();
+        }
+        return columns;
+    }
+
+    static void free_columns(const columns_type& columns) noexcept {
+        std::apply([](auto*... column) { (std::free(column), ...); }, columns);
+    }
+
+    // construct the fields of a row in order, if one of them throws, the fields built already are destroyed.
+    template <typename... Args>
+    static void construct_row(const columns_type& columns, size_type index, Args&&... args) {
+        std::size_t built = 0;
+        try {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((new (std::get<I>(columns) + index) field_type<I>(std::forward<Args>(args)), ++built), ...);
+            }(std::index_sequence_for<Fields...>{});
+        } catch (...) {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((I < built ? destroy_ptr(std::get<I>(columns) + index) : void()), ...);
+            }(std::index_sequence_for<Fields...>{});
+            throw;
+        }
+    }
+
+    // relocate the elements to fresh columns, and free the old ones.
+    void relocate_to(const columns_type& fresh) noexcept {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            ((void)relocate_range(std::get<I>(fresh), std::get<I>(_columns), std::get<I>(_columns) + _size), ...);
+            (std::free(std::get<I>(_columns)), ...);
+        }(std::index_sequence_for<Fields...>{});
+        _columns = fresh;
+    }
+
+    void relocate_columns(size_type new_capacity) {
+        Assert(new_capacity >= _size, "new_capacity should be larger than size, or it will cause data loss");
+        relocate_to(allocate_columns(new_capacity));
+        _capacity = new_capacity;
+    }
+
+    // construct the rows [first, last) of a column by construct(ptr, row), the built ones are destroyed on exception.
+    template <typename T, typename Construct>
+    static void construct_column(T* column, size_type first, size_type last, Construct&& construct) {
+        size_type row = first;
+        try {
+            for (; row < last; ++row) {
+                construct(column + row, row);
+            }
+        } catch (...) {
+            destroy_range(column + first, column + row);
+            throw;
+        }
+    }
+
+    /*
+     * build the rows [first, last) column by column with build(std::integral_constant<std::size_t, I>), which cleans
+     * up its own column if it throws, then the columns built already are destroyed as well.
+     */
+    template <typename Build>
+    void build_columns(size_type first, size_type last, Build&& build) {
+        std::size_t built = 0;
+        try {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((build(std::integral_constant<std::size_t, I>{}), ++built), ...);
+            }(std::index_sequence_for<Fields...>{});
+        } catch (...) {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((I < built ? destroy_range(std::get<I>(_columns) + first, std::get<I>(_columns) + last) : void()),
+                 ...);
+            }(std::index_sequence_for<Fields...>{});
+            throw;
+        }
+    }
+
+    // value-initialize the rows [first, last), _size is not touched.
+    void construct_columns(size_type first, size_type last) {
+        build_columns(first, last, [this, first, last]<std::size_t I>(std::integral_constant<std::size_t, I>) {
+            using T = field_type<I>;
+            T* column = std::get<I>(_columns);
+            if constexpr (std::is_nothrow_default_constructible_v<T>) {
+                construct_range(column + first, column + last);
+            } else {
+                construct_column(column, first, last, [](T* ptr, size_type /*unused*/) { new (ptr) T(); });
+            }
+        });
+    }
+
+    // copy the rows of other, _size is not touched.
+    void copy_columns(const soa_vector& other) {
+        build_columns(0, other._size, [this, &other]<std::size_t I>(std::integral_constant<std::size_t, I>) {
+            using T = field_type<I>;
+            T* column = std::get<I>(_columns);
+            const T* src = std::get<I>(other._columns);
+            if constexpr (std::is_nothrow_copy_constructible_v<T>) {
+                copy_range(column, src, src + other._size);
+            } else {
+                construct_column(column, 0, other._size, [src](T* ptr, size_type row) { new (ptr) T(src[row]); });
+            }
+        });
+    }
+
+    void release() noexcept {
+        free_columns(_columns);
+        _columns = {};
+        _capacity = 0;
+    }
+
+    columns_type _columns{};
+    size_type _size = 0;
+    size_type _capacity = 0;
+};  // class soa_vector
+
+}  // namespace stdb::container
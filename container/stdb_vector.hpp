@@ -31,20 +31,26 @@
 */
 
 #pragma once
+#include <algorithm>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <format>
+#include <functional>
 #include <iterator>
 #include <limits>
 #include <new>
+#include <ranges>
 #include <span>
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
 
 #include "assert_config.hpp"
+#include "container/simd.hpp"
+#include "trace_config.hpp"
 
 namespace stdb {
 
@@ -56,6 +62,15 @@ template <typename T>
 struct ZeroInitable : std::false_type
 {};
 
+/*
+ * opt-in for growing stdb_vector<T> by std::realloc, only works for relocatable T.
+ * the malloc must support realloc really, (glibc, jemalloc and tcmalloc do, seastar's does not),
+ * then a large buffer may be extended in place or remapped (mremap) instead of being copied.
+ */
+template <typename T>
+struct Reallocatable : std::false_type
+{};
+
 }  // namespace stdb
 
 namespace stdb::container {
@@ -68,12 +83,21 @@ template <typename T>
 concept IsZeroInitable =
   std::is_trivially_default_constructible_v<T> || not std::is_class<T>::value || ZeroInitable<T>::value;
 
+template <typename T>
+concept IsReallocatable = IsRelocatable<T> && Reallocatable<T>::value;
+
 enum class Safety : bool
 {
     Safe = false,
     Unsafe = true
 };
 
+/*
+ * the policy of the parallel constructors, assign, resize and clear of stdb_vector.
+ * they are opt-in, include container/stdb_vector_parallel.hpp to use them.
+ */
+struct parallel_policy;
+
 // default stdb_vector capacity is 64 bytes.
 constexpr std::size_t kFastVectorDefaultCapacity = 64;
 constexpr std::size_t kFastVectorMaxSize = std::numeric_limits<std::ptrdiff_t>::max();
@@ -231,6 +255,46 @@ template <typename T>
     }
 }
 
+/*
+ * relocate [src, src_end) to [dst, dst + (src_end - src)), the source elements are dead after relocation.
+ * and return new_finish ptr
+ */
+template <typename T>
+[[gnu::always_inline, nodiscard]] inline auto relocate_range(T* __restrict__ dst, T* __restrict__ src,
+                                                             T* __restrict__ src_end) noexcept -> T* {
+    if (src == src_end) {
+        return dst;
+    }
+    T* new_finish = move_range_without_overlap(dst, src, src_end);
+    if constexpr (not IsRelocatable<T> and std::is_move_constructible_v<T>) {
+        // the moved-from elements still need their destructors.
+        destroy_range(src, src_end);
+    }
+    return new_finish;
+}
+
+/*
+ * relocate [src, src_end) to the right by (dst - src), the ranges may overlap.
+ * the source elements are dead after relocation, the destination slots should be dead or raw memory.
+ */
+template <typename T>
+[[gnu::always_inline]] inline void relocate_range_backward(T* dst, T* src, T* src_end) noexcept {
+    Assert(dst >= src, "relocate_range_backward only moves the range to the right");
+    if (src == src_end or dst == src) {
+        return;
+    }
+    if constexpr (IsRelocatable<T>) {
+        std::memmove(dst, src, (size_t)(src_end - src) * sizeof(T));  // NOLINT
+    } else {
+        // from the end, every destination slot was relocated already or is beyond the old end.
+        for (T* iter = src_end; iter != src;) {
+            --iter;
+            new (dst + (iter - src)) T(std::move(*iter));
+            iter->~T();
+        }
+    }
+}
+
 template <typename T>
 [[gnu::always_inline]] inline void move_range_forward(T* __restrict__ dst, T* __restrict__ src,
                                                       T* __restrict__ src_end) {
@@ -263,7 +327,8 @@ template <typename T>
  * realloc memory, if failed, throw std::bad_alloc, then move the old memory to new memory.
  * if new_size < old_size, the extra elements will be destroyed.
  *
- * not use default realloc because seastar's memory allocator does not support realloc really.
+ * not use default realloc because seastar's memory allocator does not support realloc really,
+ * unless T is opted in by Reallocatable.
  */
 template <typename T>
 auto realloc_with_move(T*& __restrict__ ptr, std::size_t old_size, std::size_t new_size) -> T* {
@@ -274,6 +339,15 @@ auto realloc_with_move(T*& __restrict__ ptr, std::size_t old_size, std::size_t n
         return ptr = static_cast<T*>(std::malloc(new_size * sizeof(T)));
     }
     Assert(new_size > 0, "new_size should be larger than zero");
+    if constexpr (IsReallocatable<T>) {
+        // relocatable elements can be moved by realloc itself, it may extend or remap the buffer without copy.
+        auto new_ptr = static_cast<T*>(std::realloc(ptr, new_size * sizeof(T)));
+        if (new_ptr == nullptr) [[unlikely]] {
+            throw std::bad_alloc();
+        }
+        ptr = new_ptr;
+        return ptr + std::min(old_size, new_size);
+    }
     auto new_ptr = static_cast<T*>(std::malloc(new_size * sizeof(T)));
     if (new_ptr == nullptr) [[unlikely]] {
         throw std::bad_alloc();
@@ -284,8 +358,64 @@ auto realloc_with_move(T*& __restrict__ ptr, std::size_t old_size, std::size_t n
     return new_finish;
 }
 
-// make T is not bool
+/*
+ * growth policies of stdb_vector, a policy has two static functions:
+ *     grow<T>(cap, min_cap) returns the next capacity which is at least min_cap, when cap is not enough.
+ *     allocated(ptr, bytes) is called after a heap buffer is allocated, and returns the bytes usable actually.
+ */
+[[nodiscard]] constexpr auto fast_vector_init_capacity(std::size_t elem_size) noexcept -> std::size_t {
+    return elem_size >= kFastVectorDefaultCapacity ? 1 : kFastVectorDefaultCapacity / elem_size;
+}
+
+/*
+ * 1.5x for the buffers smaller than 32 pages, to reuse the memory objects; 2x above it, to use whole pages.
+ */
+struct default_growth
+{
+    template <typename T>
+    [[nodiscard]] static constexpr auto grow(std::size_t cap, std::size_t min_cap) noexcept -> std::size_t {
+        constexpr std::size_t kInitCapacity = fast_vector_init_capacity(sizeof(T));
+        std::size_t next_capacity = kInitCapacity;
+        // NOLINTNEXTLINE
+        if (cap < 4096 * 32 / sizeof(T) and cap >= kInitCapacity) [[likely]] {
+            next_capacity = (cap * 3 + 1) / 2;
+        } else if (cap >= 4096 * 32 / sizeof(T)) [[likely]] {  // NOLINT
+            next_capacity = cap * 2;
+        }
+        return next_capacity > min_cap ? next_capacity : min_cap;
+    }
+
+    [[nodiscard, gnu::always_inline]] static auto allocated([[maybe_unused]] void* ptr, std::size_t bytes) noexcept
+      -> std::size_t {
+        return bytes;
+    }
+};
+
+/*
+ * the inline buffer of core, it holds N elements without heap allocation.
+ * N == 0 means no inline buffer, and it takes no space in core.
+ */
+template <typename T, std::size_t N>
+struct inline_storage
+{
+    alignas(T) std::byte _buffer[N * sizeof(T)];  // NOLINT
+
+    [[nodiscard, gnu::always_inline]] auto data() noexcept -> T* {
+        return reinterpret_cast<T*>(_buffer);  // NOLINT
+    }
+    [[nodiscard, gnu::always_inline]] auto data() const noexcept -> const T* {
+        return reinterpret_cast<const T*>(_buffer);  // NOLINT
+    }
+};
+
 template <typename T>
+struct inline_storage<T, 0>
+{};
+
+// make T is not bool, the packed bool vector is stdb_bitvector in container/bitvector.hpp
+// N is the inline capacity, the buffer spills to heap when it needs more than N elements.
+// Growth is the growth policy, see default_growth.
+template <typename T, std::size_t N = 0, typename Growth = default_growth>
 class core
 {
     using size_type = std::size_t;
@@ -298,23 +428,72 @@ class core
     using rvalue_reference = T&&;
 
    protected:
-    static constexpr std::size_t kFastVectorInitCapacity =
-      sizeof(T) >= kFastVectorDefaultCapacity ? 1 : kFastVectorDefaultCapacity / sizeof(T);
+    static constexpr std::size_t kFastVectorInitCapacity = fast_vector_init_capacity(sizeof(T));
     T* _start;   // buffer start // NOLINT
     T* _finish;  // valid end    // NOLINT
     T* _edge;    // buffer end   // NOLINT
+    [[no_unique_address]] inline_storage<T, N> _storage;  // NOLINT
+
+    // empty buffer, the inline one if it has, or nullptr.
+    [[gnu::always_inline]] void init_empty() noexcept {
+        if constexpr (N > 0) {
+            _start = _finish = _storage.data();
+            _edge = _start + N;
+        } else {
+            _start = _finish = _edge = nullptr;
+        }
+    }
+
+    // the edge of a newly allocated heap buffer, the growth policy may adopt the slack of malloc.
+    [[gnu::always_inline]] void set_heap_edge(size_type cap) noexcept {
+        _edge = _start + Growth::allocated(_start, cap * sizeof(T)) / sizeof(T);
+    }
+
+    // free the buffer, the inline buffer will never be freed.
+    [[gnu::always_inline]] void free_buffer(T* ptr) noexcept {
+        if constexpr (N > 0) {
+            if (ptr == _storage.data()) {
+                return;
+            }
+        }
+        // free will check nullptr itself
+        std::free(ptr);
+    }
+
+    // take the buffer of rhs, the inline elements are relocated, the heap buffer is stolen.
+    [[gnu::always_inline]] void steal(core& rhs) noexcept {
+        if constexpr (N > 0) {
+            if (rhs.is_inline()) {
+                init_empty();
+                _finish = relocate_range(_start, rhs._start, rhs._finish);
+                rhs._finish = rhs._start;
+                return;
+            }
+        }
+        _start = rhs._start;
+        _finish = rhs._finish;
+        _edge = rhs._edge;
+        rhs.init_empty();
+    }
 
    public:
     [[gnu::always_inline]] void allocate(size_type cap) {
         Assert(cap > 0, "allocate cap should be larger than zero");
+        if constexpr (N > 0) {
+            if (cap <= N) {
+                _start = _storage.data();
+                _edge = _start + N;
+                return;
+            }
+        }
         if (_start = static_cast<T*>(std::malloc(cap * sizeof(T))); _start != nullptr) [[likely]] {
-            _edge = _start + cap;
+            set_heap_edge(cap);
         } else {
             throw std::bad_alloc();
         }
     }
 
-    core() : _start(nullptr), _finish(nullptr), _edge(nullptr) {}
+    core() { init_empty(); }
 
     // this function will never be called without set values/ or construct values.
     core(size_type size, size_type cap) {
@@ -323,7 +502,7 @@ class core
             allocate(cap);
             _finish = _start + size;
         } else {
-            _start = _finish = _edge = nullptr;
+            init_empty();
         }
     }
 
@@ -334,15 +513,11 @@ class core
             copy_range(_start, rhs._start, rhs._finish);
             _finish = _start + size;
         } else {
-            _start = _finish = _edge = nullptr;
+            init_empty();
         }
     }
 
-    core(core&& rhs) noexcept : _start(rhs._start), _finish(rhs._finish), _edge(rhs._edge) {
-        rhs._start = nullptr;
-        rhs._finish = nullptr;
-        rhs._edge = nullptr;
-    }
+    core(core&& rhs) noexcept { steal(rhs); }
 
     auto operator=(const core& other) -> core& {
         if (this == &other) [[unlikely]] {
@@ -354,7 +529,7 @@ class core
             // destroy old data
             destroy_range(_start, _finish);
             // free old memory
-            std::free(_start);
+            free_buffer(_start);
             // allocate new memory
             allocate(new_size);
             // copy data
@@ -380,26 +555,41 @@ class core
         // destroy old data
         destroy_range(_start, _finish);
         // free old memory
-        std::free(_start);
+        free_buffer(_start);
         // move data
-        _start = std::exchange(other._start, nullptr);
-        _finish = std::exchange(other._finish, nullptr);
-        _edge = std::exchange(other._edge, nullptr);
+        steal(other);
         return *this;
     }
     ~core() {
         // destroy data
         destroy_range(_start, _finish);
-        // free will check nullptr itself
-        std::free(_start);
+        free_buffer(_start);
     }
 
-    constexpr void swap(core<T>& rhs) noexcept {
+    constexpr void swap(core& rhs) noexcept {
+        if constexpr (N > 0) {
+            // inline elements can not be swapped by pointers.
+            if (is_inline() or rhs.is_inline()) {
+                core tmp(std::move(rhs));
+                rhs = std::move(*this);
+                *this = std::move(tmp);
+                return;
+            }
+        }
         _start = std::exchange(rhs._start, _start);
         _finish = std::exchange(rhs._finish, _finish);
         _edge = std::exchange(rhs._edge, _edge);
     }
 
+    // whether the elements are stored in the inline buffer.
+    [[nodiscard, gnu::always_inline]] auto is_inline() const noexcept -> bool {
+        if constexpr (N > 0) {
+            return _start == _storage.data();
+        } else {
+            return false;
+        }
+    }
+
     [[nodiscard, gnu::always_inline]] constexpr auto size() const noexcept -> size_type {
         Assert(_finish >= _start, "finish should always after start");
         return (size_type)(_finish - _start);
@@ -428,8 +618,29 @@ class core
         // no check new_cap because it will be checked in caller.
         auto old_size = size();
         Assert(new_cap >= old_size, "new_cap should be larger than old_size, or it will cause data loss");
+        STDB_TRACE(stdb_vector_realloc, this, old_size, capacity(), new_cap, sizeof(T));
+        if constexpr (N > 0) {
+            if (new_cap <= N) {
+                // shrink to the inline buffer, or it is already inline.
+                if (not is_inline()) {
+                    T* heap = _start;
+                    T* heap_finish = _finish;
+                    init_empty();
+                    _finish = relocate_range(_start, heap, heap_finish);
+                    std::free(heap);
+                }
+                return;
+            }
+            if (is_inline()) {
+                // spill the inline elements to heap.
+                T* old_start = _start;
+                allocate(new_cap);
+                _finish = relocate_range(_start, old_start, old_start + old_size);
+                return;
+            }
+        }
         _finish = realloc_with_move(_start, old_size, new_cap);
-        _edge = _start + new_cap;
+        set_heap_edge(new_cap);
         return;
     }
 
@@ -438,6 +649,25 @@ class core
         // no check new_cap because it will be checked in caller.
         auto old_size = size();
         Assert(new_cap > old_size, "new_cap should be larger than old_size, or it will cause data loss");
+        STDB_TRACE(stdb_vector_realloc, this, old_size, capacity(), new_cap, sizeof(T));
+        if constexpr (IsReallocatable<T>) {
+            if (_start != nullptr and not is_inline()) [[likely]] {
+                // args may refer to an element of the old buffer, so construct it before realloc,
+                // then relocate it to the end.
+                alignas(T) std::byte slot[sizeof(T)];  // NOLINT
+                auto* value = new (slot) T(std::forward<Args>(args)...);
+                auto* new_start = static_cast<T*>(std::realloc(_start, new_cap * sizeof(T)));
+                if (new_start == nullptr) [[unlikely]] {
+                    destroy_ptr(value);
+                    throw std::bad_alloc();
+                }
+                _start = new_start;
+                _finish = _start + old_size;
+                set_heap_edge(new_cap);
+                std::memcpy((void*)_finish++, value, sizeof(T));  // NOLINT
+                return;
+            }
+        }
         // backup old _start, _finish, _edge
         auto* old_start = _start;
         auto* old_finish = _finish;
@@ -449,7 +679,7 @@ class core
             (void)move_range_without_overlap(_start, old_start, old_finish);
         }
         // free the original buffer finally.
-        std::free(old_start);
+        free_buffer(old_start);
         return;
     }
 
@@ -523,10 +753,16 @@ class core
 /*
  * stdb_vector is a vector-like container that uses a variadic size buffer to store elements.
  * it is designed to be used in the non-arena memory.
+ *
+ * N > 0 stores up to N elements inline without any malloc, see stdb_small_vector.
+ * Growth decides the next capacity, default_growth or size_class_growth (container/size_class_growth.hpp),
+ * or any type with the same interface.
  */
-template <typename T, typename Alloc = std::allocator<T>>
-class stdb_vector : public core<T>
+template <typename T, typename Alloc = std::allocator<T>, std::size_t N = 0, typename Growth = default_growth>
+class stdb_vector : public core<T, N, Growth>
 {
+    using core_type = core<T, N, Growth>;
+
    public:
     using size_type = std::size_t;
     using value_type = T;
@@ -544,27 +780,27 @@ class stdb_vector : public core<T>
      *
      * default constructor is not noexcept, because it may throw std::bad_alloc
      */
-    constexpr stdb_vector() : core<T>() {}
+    constexpr stdb_vector() : core_type() {}
 
-    constexpr explicit stdb_vector([[maybe_unused]] const Alloc& alloc) : core<T>() {}
+    constexpr explicit stdb_vector([[maybe_unused]] const Alloc& alloc) : core_type() {}
 
     /*
      * constructor with capacity
      */
-    constexpr explicit stdb_vector(std::size_t size) : core<T>(size, size) {
+    constexpr explicit stdb_vector(std::size_t size) : core_type(size, size) {
         if (size > 0) {
             construct_range(this->_start, this->_finish);
         }
     }
 
-    constexpr stdb_vector(std::size_t size, const T& value) : core<T>(size, size) {
+    constexpr stdb_vector(std::size_t size, const T& value) : core_type(size, size) {
         if (size > 0) {
             construct_range_with_cref(this->_start, this->_finish, value);
         }
     }
 
     template <std::forward_iterator InputIt>
-    constexpr stdb_vector(InputIt first, InputIt last) : core<T>() {
+    constexpr stdb_vector(InputIt first, InputIt last) : core_type() {
         int64_t size = last - first;
         // if size == 0, then do nothing.and just for caller convenience.
         Assert(size >= 0, "stdb_vector should be constructed with non-negative size");
@@ -578,6 +814,21 @@ class stdb_vector : public core<T>
 
     constexpr stdb_vector(std::initializer_list<T> init) : stdb_vector(init.begin(), init.end()) {}
 
+    /*
+     * parallel constructors, the elements are constructed by the worker threads of policy.
+     */
+    stdb_vector(const parallel_policy& policy, std::size_t size) : core_type(size, size) {
+        construct_range(policy, this->_start, this->_finish);
+    }
+
+    stdb_vector(const parallel_policy& policy, std::size_t size, const T& value) : core_type(size, size) {
+        construct_range_with_cref(policy, this->_start, this->_finish, value);
+    }
+
+    stdb_vector(const parallel_policy& policy, const stdb_vector& other) : core_type(other.size(), other.size()) {
+        copy_range(policy, this->_start, other._start, other._finish);
+    }
+
     /*
      * copy constructor of stdb_vector
      */
@@ -615,6 +866,16 @@ class stdb_vector : public core<T>
         construct_range_with_cref(this->_start, this->_finish, value);
     }
 
+    void assign(const parallel_policy& policy, std::size_t count, const T& value) {
+        if (count > this->capacity()) {
+            this->realloc_drop_old_data(count);
+        } else {
+            destroy_range(policy, this->_start, this->_finish);
+        }
+        this->_finish = this->_start + count;
+        construct_range_with_cref(policy, this->_start, this->_finish, value);
+    }
+
     template <std::forward_iterator Iterator>
     constexpr void assign(Iterator first, Iterator last) {
         // int64_t size_to_assign = last - first;
@@ -648,17 +909,17 @@ class stdb_vector : public core<T>
      * Capacity section
      */
     [[nodiscard, gnu::always_inline]] constexpr inline auto size() const noexcept -> size_type {
-        return core<T>::size();
+        return core_type::size();
     }
 
     [[nodiscard, gnu::always_inline]] constexpr inline auto capacity() const noexcept -> size_type {
-        return core<T>::capacity();
+        return core_type::capacity();
     }
 
     [[nodiscard, gnu::always_inline]] constexpr inline auto empty() const noexcept -> bool { return this->size() == 0; }
 
     [[nodiscard, gnu::always_inline]] constexpr inline auto max_size() const noexcept -> size_type {
-        return core<T>::max_size();
+        return core_type::max_size();
     }
 
     /*
@@ -677,8 +938,8 @@ class stdb_vector : public core<T>
         }
 
         if (size == 0) [[unlikely]] {
-            this->~core<T>();
-            new (this) core<T>();
+            this->~core_type();
+            new (this) core_type();
             return;
         }
         this->realloc_with_old_data(size);
@@ -711,11 +972,11 @@ class stdb_vector : public core<T>
     }
 
     [[nodiscard, gnu::always_inline]] constexpr inline auto at(std::size_t index) -> reference {
-        return core<T>::at(index);
+        return core_type::at(index);
     }
 
     [[nodiscard, gnu::always_inline]] constexpr inline auto at(size_type index) const -> const_reference {
-        return core<T>::at(index);
+        return core_type::at(index);
     }
 
     [[nodiscard, gnu::always_inline]] constexpr inline auto data() noexcept -> pointer { return this->_start; }
@@ -909,6 +1170,85 @@ class stdb_vector : public core<T>
         }
     }
 
+    /*
+     * fill at most max_fill elements by any invocable, it writes to the end of the vector directly,
+     * and returns how many elements it wrote. the capacity is checked once, and filler is called once.
+     */
+    template <Safety safety = Safety::Safe, typename Filler>
+        requires std::is_invocable_r_v<size_type, Filler, T*>
+    void fill(size_type max_fill, Filler&& filler) {
+        if constexpr (safety == Safety::Safe) {
+            if (max_fill + this->size() > this->capacity()) [[unlikely]] {
+                this->realloc_with_old_data(compute_new_capacity(max_fill + size()));
+            }
+        }
+        Assert(max_fill + this->size() <= this->capacity(), "fill should not overflow the vector's cap");
+        auto filled = static_cast<size_type>(std::forward<Filler>(filler)(this->_finish));
+        Assert(filled <= max_fill, "filler wrote more elements than max_fill");
+        this->_finish += filled;
+    }
+
+    /*
+     * append a range with a single capacity check, relocatable elements are copied by memcpy.
+     * the range can be a part of the vector itself.
+     */
+    template <Safety safety = Safety::Safe>
+    void append_range(std::span<const T> range) {
+        if (range.empty()) [[unlikely]] {
+            return;
+        }
+        const T* src = range.data();
+        if constexpr (safety == Safety::Safe) {
+            if (range.size() + this->size() > this->capacity()) {
+                // the range will be moved with the buffer if it is inside the vector.
+                bool inside = src >= this->_start and src < this->_finish;
+                auto offset = src - this->_start;
+                this->realloc_with_old_data(compute_new_capacity(range.size() + size()));
+                if (inside) {
+                    src = this->_start + offset;
+                }
+            }
+        }
+        Assert(range.size() + this->size() <= this->capacity(), "append_range should not overflow the vector's cap");
+        this->_finish = copy_range(this->_finish, src, src + range.size());
+    }
+
+    template <Safety safety = Safety::Safe, std::ranges::forward_range Range>
+        requires std::convertible_to<std::ranges::range_reference_t<Range>, const T&>
+    void append_range(Range&& range) {
+        if constexpr (std::ranges::contiguous_range<Range> and
+                      std::is_same_v<std::ranges::range_value_t<Range>, T>) {
+            append_range<safety>(std::span<const T>(std::ranges::data(range), std::ranges::size(range)));
+        } else {
+            auto count = (size_type)std::ranges::distance(range);
+            if constexpr (safety == Safety::Safe) {
+                if (count + this->size() > this->capacity()) {
+                    this->realloc_with_old_data(compute_new_capacity(count + size()));
+                }
+            }
+            Assert(count + this->size() <= this->capacity(), "append_range should not overflow the vector's cap");
+            for (auto&& elem : range) {
+                copy_cref(this->_finish++, static_cast<const T&>(elem));
+            }
+        }
+    }
+
+    /*
+     * resize without constructing the new elements, they should be written before being read.
+     * it grows the capacity like push_back, so it can be called repeatedly by the decoders.
+     */
+    template <Safety safety = Safety::Safe, typename U = T>
+        requires std::is_trivially_default_constructible_v<U> and std::is_trivially_destructible_v<U>
+    void resize_uninitialized(size_type count) {
+        if constexpr (safety == Safety::Safe) {
+            if (count > this->capacity()) {
+                this->realloc_with_old_data(compute_new_capacity(count));
+            }
+        }
+        Assert(count <= this->capacity(), "resize_uninitialized should not overflow the vector's cap");
+        this->_finish = this->_start + count;
+    }
+
     /*
      * get an alloced buffer for writing.
      */
@@ -916,7 +1256,7 @@ class stdb_vector : public core<T>
     [[nodiscard, gnu::always_inline]] auto get_writebuffer(size_type buf_size) -> std::span<T> {
         if constexpr (safety == Safety::Safe) {
             if (buf_size + this->_finish > this->_edge) {
-                this->realloc_with_old_data(compute_new_capacity(buf_size));
+                this->realloc_with_old_data(compute_new_capacity(buf_size + size()));
             }
         }
         auto buf = std::span<T>(this->_finish, buf_size);
@@ -977,6 +1317,11 @@ class stdb_vector : public core<T>
         this->_finish = this->_start;
     }
 
+    void clear(const parallel_policy& policy) {
+        destroy_range(policy, this->_start, this->_finish);
+        this->_finish = this->_start;
+    }
+
     constexpr auto erase(const_iterator pos) -> iterator {
         Assert(pos >= cbegin() and pos < cend(), "pos should be in [begin(), end())");
 
@@ -1025,7 +1370,13 @@ class stdb_vector : public core<T>
     }
 
     auto erase(const value_type& value) -> size_type {  // NOLINT
-        if constexpr (IsRelocatable<T>) {
+        if constexpr (simd::Element<T>) {
+            // stream compaction without a branch per element.
+            T* new_finish = simd::remove(this->_start, this->_finish, value);
+            auto erased = (size_type)(this->_finish - new_finish);
+            this->_finish = new_finish;
+            return erased;
+        } else if constexpr (IsRelocatable<T>) {
             size_t erased = 0;
             for (auto *src = this->_start, *dst = this->_start; src != this->_finish;) {
                 // if the *src is not equal to the value we want to erase and dst == src, move forward both
@@ -1095,7 +1446,23 @@ class stdb_vector : public core<T>
     template <class Pred>
         requires std::predicate<Pred, const T&> || std::predicate<Pred, T&> || std::predicate<Pred, T>
     auto erase_if(Pred pred) -> size_type {  // NOLINT
-        if constexpr (IsRelocatable<T>) {
+        if constexpr (simd::Element<T>) {
+            // test 64 elements into a keep mask, then compress them, no branch per element.
+            constexpr size_type kChunk = 64;
+            T* dst = this->_start;
+            for (T* src = this->_start; src != this->_finish;) {
+                auto chunk = std::min(kChunk, (size_type)(this->_finish - src));
+                uint64_t keep = 0;
+                for (size_type i = 0; i < chunk; ++i) {
+                    keep |= (uint64_t)(!pred(src[i])) << i;
+                }
+                dst = simd::compress(dst, src, chunk, keep);
+                src += chunk;
+            }
+            auto erased = (size_type)(this->_finish - dst);
+            this->_finish = dst;
+            return erased;
+        } else if constexpr (IsRelocatable<T>) {
             size_t erased = 0;
             for (auto *src = this->_start, *dst = this->_start; src != this->_finish;) {
                 // if the *src is not equal to the value we want to erase and dst == src, move forward both
@@ -1158,6 +1525,34 @@ class stdb_vector : public core<T>
         }
     }
 
+    /*
+     * Lookup section
+     * arithmetic elements are compared by SIMD, see simd.hpp
+     */
+    [[nodiscard]] auto find(const value_type& value) noexcept -> iterator {
+        return begin() + (std::as_const(*this).find(value) - cbegin());
+    }
+
+    [[nodiscard]] auto find(const value_type& value) const noexcept -> const_iterator {
+        if constexpr (simd::Element<T>) {
+            return const_iterator{simd::find<T>(this->_start, this->_finish, value)};
+        } else {
+            return std::find(cbegin(), cend(), value);
+        }
+    }
+
+    [[nodiscard]] auto count(const value_type& value) const noexcept -> size_type {
+        if constexpr (simd::Element<T>) {
+            return simd::count<T>(this->_start, this->_finish, value);
+        } else {
+            return (size_type)std::count(cbegin(), cend(), value);
+        }
+    }
+
+    [[nodiscard, gnu::always_inline]] inline auto contains(const value_type& value) const noexcept -> bool {
+        return find(value) != cend();
+    }
+
     constexpr void pop_back() noexcept {
         --this->_finish;
         destroy_ptr(this->_finish);
@@ -1204,7 +1599,40 @@ class stdb_vector : public core<T>
         }
     }
 
-    [[gnu::always_inline]] constexpr inline void swap(stdb_vector& other) noexcept { core<T>::swap(other); }
+    /*
+     * parallel resize, the new elements are constructed or the extra elements are destroyed by policy.
+     */
+    void resize(const parallel_policy& policy, size_type count) {
+        auto* old_end = this->_finish;
+        if (count > this->size()) {
+            if (count > this->capacity()) {
+                this->realloc_with_old_data(count);
+                old_end = this->_finish;
+            }
+            this->_finish = this->_start + count;
+            construct_range(policy, old_end, this->_finish);
+        } else {
+            this->_finish = this->_start + count;
+            destroy_range(policy, this->_finish, old_end);
+        }
+    }
+
+    void resize(const parallel_policy& policy, size_type count, const_reference value) {
+        auto* old_end = this->_finish;
+        if (count > this->size()) {
+            if (count > this->capacity()) {
+                this->realloc_with_old_data(count);
+                old_end = this->_finish;
+            }
+            this->_finish = this->_start + count;
+            construct_range_with_cref(policy, old_end, this->_finish, value);
+        } else {
+            this->_finish = this->_start + count;
+            destroy_range(policy, this->_finish, old_end);
+        }
+    }
+
+    [[gnu::always_inline]] constexpr inline void swap(stdb_vector& other) noexcept { core_type::swap(other); }
 
     template <Safety safety = Safety::Safe>
     constexpr auto insert(const_iterator pos, const_reference value) -> iterator {
@@ -1376,34 +1804,86 @@ class stdb_vector : public core<T>
         return iterator(pos_ptr);
     }
 
+    /*
+     * insert values[i] before the element at positions[i], positions are the indexes before the insertion and should
+     * be non-decreasing, the values of the same position keep their order.
+     * every tail segment is relocated once from right to left (memmove for relocatable T), so the whole batch is
+     * O(size() + K) instead of K single inserts. values should not be a part of the vector.
+     */
+    template <Safety safety = Safety::Safe>
+    void insert_many(std::span<const size_type> positions, std::span<const T> values) {
+        Assert(positions.size() == values.size(), "insert_many needs a position for every value");
+        Assert(std::ranges::is_sorted(positions), "positions should be non-decreasing");
+        Assert(positions.empty() or positions.back() <= size(), "positions should be in [0, size()]");
+        reserve_for_batch<safety>(values);
+        insert_scattered(values, [&positions](size_type index, [[maybe_unused]] size_type old_end) {
+            return positions[index];
+        });
+    }
+
+    /*
+     * merge sorted values into the sorted vector, a value is placed after the equal elements.
+     * the positions are found by binary search in the part which is not moved yet, then inserted like insert_many.
+     * it keeps a sorted posting list in place with O(size() + K) moves.
+     */
+    template <Safety safety = Safety::Safe, typename Compare = std::less<>>
+    void merge_insert_sorted(std::span<const T> values, Compare comp = Compare{}) {
+        Assert(std::ranges::is_sorted(values, comp), "values should be sorted");
+        reserve_for_batch<safety>(values);
+        insert_scattered(values, [this, &values, &comp](size_type index, size_type old_end) {
+            return static_cast<size_type>(
+              std::upper_bound(this->_start, this->_start + old_end, values[index], comp) - this->_start);
+        });
+    }
+
    private:
     [[nodiscard, gnu::always_inline]] inline auto compute_new_capacity(size_type new_size) const -> size_type {
         Assert(new_size > capacity(), "new_size should larger than old cap, or no need to compute new cap");
-        if (auto next_capacity = compute_next_capacity(); next_capacity > new_size) {
-            return next_capacity;
-        }
-        return new_size;
+        return Growth::template grow<T>(capacity(), new_size);
     }
-    [[nodiscard]] auto compute_next_capacity() const -> size_type {
-        auto cap = capacity();
-        // NOLINTNEXTLINE
-        if (cap < 4096 * 32 / sizeof(T) and cap >= core<T>::kFastVectorInitCapacity) [[likely]] {
-            // the capacity is smaller than a page,
-            // use 1.5 but not 2 to reuse memory objects.
-            return (cap * 3 + 1) / 2;
+    [[nodiscard, gnu::always_inline]] inline auto compute_next_capacity() const -> size_type {
+        return Growth::template grow<T>(capacity(), capacity() + 1);
+    }
+
+    template <Safety safety>
+    void reserve_for_batch(std::span<const T> values) {
+        Assert(values.empty() or values.data() + values.size() <= this->_start or values.data() >= this->_finish,
+               "values should not be a part of the vector");
+        if constexpr (safety == Safety::Safe) {
+            if (size() + values.size() > capacity()) [[unlikely]] {
+                reserve(compute_new_capacity(size() + values.size()));
+            }
         }
-        // the capacity is larger than a page,
-        // so we can just double it to use whole pages.
-        // NOLINTNEXTLINE
-        if (cap >= 4096 * 32 / sizeof(T)) [[likely]] {
-            return cap * 2;
+        Assert(size() + values.size() <= capacity(), "insert should not overflow the vector's cap");
+    }
+
+    // position_of(index, old_end) is the position of values[index], elements [0, old_end) are not moved yet.
+    template <typename PositionOf>
+    void insert_scattered(std::span<const T> values, PositionOf&& position_of) {
+        size_type old_end = size();
+        for (size_type index = values.size(); index > 0; --index) {
+            const size_type pos = position_of(index - 1, old_end);
+            Assert(pos <= old_end, "the positions should be non-decreasing");
+            relocate_range_backward(this->_start + pos + index, this->_start + pos, this->_start + old_end);
+            copy_cref(this->_start + pos + index - 1, values[index - 1]);
+            old_end = pos;
         }
-        return core<T>::kFastVectorInitCapacity;
+        this->_finish += values.size();
     }
 };  // class stdb_vector
 
-template <typename T>
-auto operator==(const stdb_vector<T>& lhs, const stdb_vector<T>& rhs) -> bool {
+/*
+ * stdb_small_vector stores up to N elements inline, and spills to heap when it grows beyond N.
+ * it is the same stdb_vector with an inline buffer, so all the Safety::Unsafe paths work as well.
+ *
+ * NOTICE: move/swap an inline stdb_small_vector relocates the elements, iterators are invalidated.
+ */
+template <typename T, std::size_t N, typename Growth = default_growth>
+    requires(N > 0)
+using stdb_small_vector = stdb_vector<T, std::allocator<T>, N, Growth>;
+
+template <typename T, typename Alloc, std::size_t N, typename Growth>
+auto operator==(const stdb_vector<T, Alloc, N, Growth>& lhs, const stdb_vector<T, Alloc, N, Growth>& rhs) -> bool {
     if (lhs.size() != rhs.size()) {
         return false;
     }
@@ -1415,8 +1895,9 @@ auto operator==(const stdb_vector<T>& lhs, const stdb_vector<T>& rhs) -> bool {
     return true;
 }
 
-template <typename T>
-auto operator<=>(const stdb_vector<T>& lhs, const stdb_vector<T>& rhs) -> std::strong_ordering {
+template <typename T, typename Alloc, std::size_t N, typename Growth>
+auto operator<=>(const stdb_vector<T, Alloc, N, Growth>& lhs, const stdb_vector<T, Alloc, N, Growth>& rhs)
+  -> std::strong_ordering {
     for (std::size_t i = 0; i < std::min(lhs.size(), rhs.size()); ++i) {
         if (lhs[i] < rhs[i]) {
             return std::strong_ordering::less;
@@ -1438,25 +1919,26 @@ auto operator<=>(const stdb_vector<T>& lhs, const stdb_vector<T>& rhs) -> std::s
 
 namespace std {
 
-template <typename T>
-constexpr void swap(stdb::container::stdb_vector<T>& lhs, stdb::container::stdb_vector<T>& rhs) {
+template <typename T, typename Alloc, std::size_t N, typename Growth>
+constexpr void swap(stdb::container::stdb_vector<T, Alloc, N, Growth>& lhs,
+                    stdb::container::stdb_vector<T, Alloc, N, Growth>& rhs) {
     lhs.swap(rhs);
 }
 
-template <class T, class U>
-constexpr auto erase(stdb::container::stdb_vector<T>& vec, const U& value) -> std::size_t {
+template <class T, class Alloc, std::size_t N, class Growth, class U>
+constexpr auto erase(stdb::container::stdb_vector<T, Alloc, N, Growth>& vec, const U& value) -> std::size_t {
     return vec.erase(value);
 }
 
-template <class T, class Predicate>
-constexpr auto erase_if(stdb::container::stdb_vector<T>& vec, Predicate pred) -> std::size_t {
+template <class T, class Alloc, std::size_t N, class Growth, class Predicate>
+constexpr auto erase_if(stdb::container::stdb_vector<T, Alloc, N, Growth>& vec, Predicate pred) -> std::size_t {
     return vec.erase_if(pred);
 }
 
-template <typename T>
-struct formatter<stdb::container::stdb_vector<T>> : std::formatter<std::string>
+template <typename T, typename Alloc, std::size_t N, typename Growth>
+struct formatter<stdb::container::stdb_vector<T, Alloc, N, Growth>> : std::formatter<std::string>
 {
-    auto format(const stdb::container::stdb_vector<T>& vec, std::format_context& ctx) const {
+    auto format(const stdb::container::stdb_vector<T, Alloc, N, Growth>& vec, std::format_context& ctx) const {
         std::string result = "[";
         for (std::size_t i = 0; i < vec.size(); ++i) {
             if (i > 0) {
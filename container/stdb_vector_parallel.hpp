@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uintptr_t
+
+#include "container/parallel.hpp"
+#include "container/stdb_vector.hpp"
+
+/*
+ * the parallel_policy overloads of the range helpers of stdb_vector.
+ * stdb_vector declares its parallel members with a forward declared parallel_policy, they find these overloads
+ * when they are instantiated, so only the TUs including this header pay for <thread> and <mutex>.
+ */
+namespace stdb::container {
+
+constexpr std::size_t kPageSize = 4096;
+
+// the elements of a page, the parallel ranges are split by pages.
+template <typename T>
+constexpr std::size_t kPageElements = sizeof(T) >= kPageSize ? 1 : kPageSize / sizeof(T);
+
+/*
+ * parallel_for over the elements [0, count) of a buffer starting at first, the chunks are split at the page
+ * boundaries of the buffer instead of the multiples of a page from first, the heap buffers are not page aligned,
+ * so every worker first-touches its own pages only.
+ */
+template <typename T, typename Func>
+void parallel_for_pages(const parallel_policy& policy, const T* first, std::size_t count, Func&& func) {
+    constexpr std::size_t kGrain = kPageElements<T>;
+    const auto address = reinterpret_cast<std::uintptr_t>(first);  // NOLINT
+    const std::size_t head_bytes = ((address + kPageSize - 1) & ~(kPageSize - 1)) - address;
+    // the elements before the first page boundary.
+    const std::size_t head = ((head_bytes + sizeof(T) - 1) / sizeof(T)) % kGrain;
+    // split a virtual range which starts shift elements earlier, so its grain boundaries are the page boundaries.
+    const std::size_t shift = (kGrain - head) % kGrain;
+    parallel_for(policy, count + shift, kGrain, [shift, &func](std::size_t begin, std::size_t end) {
+        begin = begin < shift ? 0 : begin - shift;
+        end -= shift;
+        if (begin < end) [[likely]] {
+            func(begin, end);
+        }
+    });
+}
+
+/*
+ * parallel versions of the range helpers, see parallel_policy.
+ * the ranges smaller than policy.threshold bytes run in the calling thread.
+ */
+template <typename T>
+inline void construct_range(const parallel_policy& policy, T* first, T* last) {
+    auto count = static_cast<std::size_t>(last - first);
+    if (count == 0) [[unlikely]] {
+        return;
+    }
+    if (count * sizeof(T) < policy.threshold) {
+        construct_range(first, last);
+        return;
+    }
+    parallel_for_pages(policy, first, count,
+                       [first](std::size_t begin, std::size_t end) { construct_range(first + begin, first + end); });
+}
+
+template <typename T>
+    requires std::is_object_v<T>
+inline void construct_range_with_cref(const parallel_policy& policy, T* first, T* last, const T& value) {
+    auto count = static_cast<std::size_t>(last - first);
+    if (count == 0) [[unlikely]] {
+        return;
+    }
+    if (count * sizeof(T) < policy.threshold) {
+        construct_range_with_cref(first, last, value);
+        return;
+    }
+    parallel_for_pages(policy, first, count, [first, &value](std::size_t begin, std::size_t end) {
+        construct_range_with_cref(first + begin, first + end, value);
+    });
+}
+
+// the pages of dst are the ones first-touched.
+template <typename T>
+inline auto copy_range(const parallel_policy& policy, T* dst, const T* src, const T* src_end) -> T* {
+    auto count = static_cast<std::size_t>(src_end - src);
+    if (count == 0) [[unlikely]] {
+        return dst;
+    }
+    if (count * sizeof(T) < policy.threshold) {
+        return copy_range(dst, src, src_end);
+    }
+    parallel_for_pages(policy, dst, count, [dst, src](std::size_t begin, std::size_t end) {
+        copy_range(dst + begin, src + begin, src + end);
+    });
+    return dst + count;
+}
+
+template <typename T>
+inline void destroy_range(const parallel_policy& policy, T* begin, T* end) {
+    if constexpr (std::is_trivially_destructible_v<T>) {
+        // do nothing
+    } else {
+        auto count = static_cast<std::size_t>(end - begin);
+        if (count == 0 or count * sizeof(T) < policy.threshold) {
+            destroy_range(begin, end);
+            return;
+        }
+        parallel_for_pages(policy, begin, count, [begin](std::size_t first, std::size_t last) {
+            destroy_range(begin + first, begin + last);
+        });
+    }
+}
+
+}  // namespace stdb::container
@@ -32,11 +32,17 @@
 
 #include "arena/arena.hpp"
 
+#include <sys/mman.h>  // for mmap, munmap
+#include <unistd.h>    // for sysconf
+
+#include <atomic>    // for atomic
+#include <chrono>    // for milliseconds
 #include <cstdint>   // for uint64_t
 #include <cstdlib>   // for free, malloc
 #include <cstring>   // for memcmp, strcmp
 #include <memory>    // for allocator, make_unique, unique_ptr
 #include <string>    // for string, operator==, basic_string
+#include <thread>    // for thread, sleep_for
 #include <typeinfo>  // for type_info
 #include <vector>    // for vector, vector<>::allocator_type
 
@@ -969,11 +975,16 @@ class mock_hook
         destructed++;
         return _cookie;
     }
-    void arena_reset_hook(Arena* /*unused*/, void* /*unused*/, uint64_t /*unused*/, uint64_t /*unused*/) { reseted++; }
+    void arena_reset_hook(Arena* /*unused*/, void* /*unused*/, uint64_t /*unused*/, uint64_t /*unused*/,
+                          uint64_t space_released) {
+        reseted++;
+        released += space_released;
+    }
     int inited = 0;
     int allocated = 0;
     int destructed = 0;
     int reseted = 0;
+    uint64_t released = 0;
 
    private:
     void* _cookie = nullptr;
@@ -991,8 +1002,8 @@ auto destruction_hook(Arena* a, void* c, uint64_t s, uint64_t w) -> void* {
     return hook_instance->arena_destruction_hook(a, c, s, w);
 }
 
-void reset_hook(Arena* a, void* cookie, uint64_t space_used, uint64_t space_wasted) {
-    hook_instance->arena_reset_hook(a, cookie, space_used, space_wasted);
+void reset_hook(Arena* a, void* cookie, uint64_t space_used, uint64_t space_wasted, uint64_t space_released) {
+    hook_instance->arena_reset_hook(a, cookie, space_used, space_wasted, space_released);
 }
 
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
@@ -1051,6 +1062,393 @@ TEST_CASE_FIXTURE(ArenaTest, "ArenaTest.HookTest") {
     std::free(cookie);
 }
 
+constexpr uint64_t kMmapBlockSize = 1024UL * 1024;
+
+auto mmap_block_alloc(uint64_t size) -> void* {
+    void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+// all blocks in ResetAndReleaseTest are kMmapBlockSize.
+void mmap_block_dealloc(void* ptr) { ::munmap(ptr, kMmapBlockSize); }
+
+TEST_CASE("ArenaTest.ResetAndReleaseTest") {
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.normal_block_size = kMmapBlockSize;
+    ops.suggested_init_block_size = kMmapBlockSize;
+    ops.huge_block_size = kMmapBlockSize;
+    ops.block_alloc = &mmap_block_alloc;
+    ops.block_dealloc = &mmap_block_dealloc;
+    ops.on_arena_reset = &reset_hook;
+    hook_instance = new mock_hook(nullptr);
+
+    SUBCASE("mmap backed") {
+        ops.block_mmap_backed = true;
+        Arena arena(ops);
+        ArenaTestHelper ah(arena);
+        auto* buf = arena.AllocateAligned(kMmapBlockSize / 2);
+        REQUIRE_NE(buf, nullptr);
+        std::memset(buf, 'x', kMmapBlockSize / 2);
+        auto* head = ah.last_block();
+
+        // the dirty pages are below the threshold, nothing to release.
+        CHECK_GT(arena.ResetAndRelease(kMmapBlockSize), 0ULL);
+        CHECK_EQ(hook_instance->reseted, 1);
+        CHECK_EQ(hook_instance->released, 0ULL);
+
+        buf = arena.AllocateAligned(kMmapBlockSize / 2);
+        REQUIRE_NE(buf, nullptr);
+        std::memset(buf, 'y', kMmapBlockSize / 2);
+        arena.ResetAndRelease(0);
+        CHECK_EQ(hook_instance->reseted, 2);
+        CHECK_GT(hook_instance->released, kMmapBlockSize / 2);
+        CHECK_LT(hook_instance->released, kMmapBlockSize);
+        CHECK_EQ(hook_instance->released % static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)), 0ULL);
+
+        // the head block is retained and still usable.
+        CHECK_EQ(ah.last_block(), head);
+        buf = arena.AllocateAligned(kMmapBlockSize / 2);
+        REQUIRE_NE(buf, nullptr);
+        std::memset(buf, 'z', kMmapBlockSize / 2);
+        CHECK_EQ(ah.last_block(), head);
+    }
+
+    SUBCASE("not mmap backed") {
+        Arena arena(ops);
+        auto* buf = arena.AllocateAligned(kMmapBlockSize / 2);
+        REQUIRE_NE(buf, nullptr);
+        arena.ResetAndRelease(0);
+        CHECK_EQ(hook_instance->reseted, 1);
+        CHECK_EQ(hook_instance->released, 0ULL);
+    }
+
+    SUBCASE("plain reset") {
+        ops.block_mmap_backed = true;
+        Arena arena(ops);
+        auto* buf = arena.AllocateAligned(kMmapBlockSize / 2);
+        REQUIRE_NE(buf, nullptr);
+        arena.Reset();
+        CHECK_EQ(hook_instance->reseted, 1);
+        CHECK_EQ(hook_instance->released, 0ULL);
+    }
+
+    delete hook_instance;
+}
+
+void silent_logger(const std::string& /*unused*/) {}
+
+thread_local Arena* spill_victim = nullptr;
+thread_local int limit_called = 0;
+
+auto fail_on_limit(Arena* /*unused*/, ArenaGroup* /*unused*/, uint64_t /*unused*/) -> ArenaLimitAction {
+    ++limit_called;
+    return ArenaLimitAction::Fail;
+}
+
+auto spill_on_limit(Arena* /*unused*/, ArenaGroup* /*unused*/, uint64_t /*unused*/) -> ArenaLimitAction {
+    ++limit_called;
+    if (spill_victim == nullptr) {
+        return ArenaLimitAction::Fail;
+    }
+    spill_victim->Reset();
+    spill_victim = nullptr;
+    return ArenaLimitAction::Spill;
+}
+
+// claims to spill without giving anything back.
+auto fake_spill_on_limit(Arena* /*unused*/, ArenaGroup* /*unused*/, uint64_t /*unused*/) -> ArenaLimitAction {
+    ++limit_called;
+    return ArenaLimitAction::Spill;
+}
+
+auto wait_on_limit(Arena* /*unused*/, ArenaGroup* group, uint64_t /*unused*/) -> ArenaLimitAction {
+    ++limit_called;
+    return group != nullptr ? ArenaLimitAction::Wait : ArenaLimitAction::Fail;
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ArenaTest.SpaceLimitTest") {
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.logger_func = &silent_logger;
+    ops.space_limit = 4 * ops.normal_block_size;
+    ops.on_arena_limit = &fail_on_limit;
+    limit_called = 0;
+    Arena arena(ops);
+    for (int i = 0; i < 4; ++i) {
+        CHECK_NE(arena.AllocateAligned(3000), nullptr);
+    }
+    CHECK_EQ(arena.SpaceAllocated(), ops.space_limit);
+    CHECK_EQ(limit_called, 0);
+    CHECK_EQ(arena.AllocateAligned(3000), nullptr);
+    CHECK_EQ(arena.CreateArray<uint64_t>(512), nullptr);
+    CHECK_EQ(limit_called, 2);
+    CHECK_EQ(arena.LimitRefusals(), 2);
+    CHECK_EQ(arena.SpaceAllocated(), ops.space_limit);
+
+    // the space comes back after reset.
+    arena.Reset();
+    CHECK_NE(arena.AllocateAligned(3000), nullptr);
+
+    // a spill without freeing anything fails instead of retrying forever.
+    limit_called = 0;
+    ops.on_arena_limit = &fake_spill_on_limit;
+    Arena spinning(ops);
+    for (int i = 0; i < 4; ++i) {
+        CHECK_NE(spinning.AllocateAligned(3000), nullptr);
+    }
+    CHECK_EQ(spinning.AllocateAligned(3000), nullptr);
+    CHECK_EQ(limit_called, 1);
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ArenaTest.ArenaGroupTest") {
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.logger_func = &silent_logger;
+    ArenaGroup group(3 * ops.normal_block_size);
+    ops.group = &group;
+    limit_called = 0;
+
+    SUBCASE("fail") {
+        {
+            Arena a(ops);
+            Arena b(ops);
+            CHECK_NE(a.AllocateAligned(3000), nullptr);
+            CHECK_NE(b.AllocateAligned(3000), nullptr);
+            CHECK_NE(a.AllocateAligned(3000), nullptr);
+            CHECK_EQ(group.used(), group.limit());
+            CHECK_EQ(b.AllocateAligned(3000), nullptr);
+            CHECK_EQ(b.LimitRefusals(), 1);
+            CHECK_EQ(group.refusals(), 1);
+            a.Reset();
+            CHECK_EQ(group.used(), 2 * ops.normal_block_size);
+            CHECK_NE(b.AllocateAligned(3000), nullptr);
+        }
+        CHECK_EQ(group.used(), 0);
+    }
+
+    SUBCASE("spill") {
+        ops.on_arena_limit = &spill_on_limit;
+        {
+            Arena a(ops);
+            Arena b(ops);
+            CHECK_NE(a.AllocateAligned(3000), nullptr);
+            CHECK_NE(a.AllocateAligned(3000), nullptr);
+            CHECK_NE(b.AllocateAligned(3000), nullptr);
+            spill_victim = &a;
+            CHECK_NE(b.AllocateAligned(3000), nullptr);
+            CHECK_EQ(limit_called, 1);
+            CHECK_EQ(spill_victim, nullptr);
+            CHECK_EQ(a.SpaceAllocated(), ops.normal_block_size);
+            // nothing to spill any more.
+            CHECK_EQ(b.AllocateAligned(3000), nullptr);
+            CHECK_EQ(limit_called, 2);
+        }
+        CHECK_EQ(group.used(), 0);
+    }
+
+    SUBCASE("spill without freeing") {
+        ops.on_arena_limit = &fake_spill_on_limit;
+        {
+            Arena a(ops);
+            for (int i = 0; i < 3; ++i) {
+                CHECK_NE(a.AllocateAligned(3000), nullptr);
+            }
+            CHECK_EQ(a.AllocateAligned(3000), nullptr);
+            CHECK_EQ(limit_called, 1);
+        }
+        CHECK_EQ(group.used(), 0);
+    }
+
+    SUBCASE("wait") {
+        ops.on_arena_limit = &wait_on_limit;
+        auto* a = new Arena(ops);
+        CHECK_NE(a->AllocateAligned(3000), nullptr);
+        CHECK_NE(a->AllocateAligned(3000), nullptr);
+        CHECK_NE(a->AllocateAligned(3000), nullptr);
+        CHECK_EQ(group.used(), group.limit());
+        std::atomic<bool> done{false};
+        std::thread waiter([&ops, &done]() {
+            Arena b(ops);
+            auto* ptr = b.AllocateAligned(3000);
+            done.store(ptr != nullptr);
+        });
+        // the waiter is blocked until the blocks of a are given back.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK_FALSE(done.load());
+        delete a;
+        waiter.join();
+        CHECK(done.load());
+        CHECK_EQ(group.used(), 0);
+    }
+}
+
+thread_local int counted_allocs = 0;
+
+auto counted_alloc(uint64_t size) -> void* {
+    ++counted_allocs;
+    return std::malloc(size);
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ArenaTest.ChildArenaTest") {
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.block_alloc = &counted_alloc;
+    counted_allocs = 0;
+    Arena parent(ops);
+    CHECK_NE(parent.AllocateAligned(100), nullptr);
+    CHECK_EQ(counted_allocs, 1);
+
+    mock_cleaners = new cleanup_mock;
+    {
+        Arena child = parent.CreateChild();
+        for (int i = 0; i < 3; ++i) {
+            CHECK_NE(child.AllocateAligned(3000), nullptr);
+        }
+        CHECK_NE(child.AllocateAlignedAndAddCleanup(100, &cleanup_mock_fn1, mock_cleaners), nullptr);
+        CHECK_EQ(counted_allocs, 4);
+        CHECK_EQ(parent.SpaceCached(), 3 * ops.normal_block_size);
+        CHECK_EQ(parent.SpaceAllocated(), ops.suggested_init_block_size);
+
+        // the blocks except the head come back to the parent on Reset.
+        child.Reset();
+        CHECK(mock_cleaners->clean1);
+        CHECK_EQ(child.SpaceAllocated(), ops.normal_block_size);
+        for (int i = 0; i < 2; ++i) {
+            CHECK_NE(child.AllocateAligned(3000), nullptr);
+        }
+        CHECK_EQ(counted_allocs, 4);
+    }
+    CHECK_EQ(parent.SpaceCached(), 3 * ops.normal_block_size);
+
+    // the next child allocates nothing from the block_alloc.
+    {
+        Arena child = parent.CreateChild();
+        for (int i = 0; i < 3; ++i) {
+            CHECK_NE(child.AllocateAligned(3000), nullptr);
+        }
+        CHECK_EQ(counted_allocs, 4);
+        // a block with new size is allocated.
+        CHECK_NE(child.AllocateAligned(3 * ops.normal_block_size), nullptr);
+        CHECK_EQ(counted_allocs, 5);
+
+        // children of a child borrow from the child.
+        Arena grandchild = child.CreateChild();
+        CHECK_NE(grandchild.AllocateAligned(100), nullptr);
+        CHECK_EQ(counted_allocs, 6);
+        CHECK_EQ(child.SpaceCached(), ops.normal_block_size);
+    }
+    // the oversized block is freed at once, only the normal blocks are cached,
+    // including the one of the grandchild, which the child borrowed from the parent.
+    CHECK_EQ(parent.SpaceCached(), 4 * ops.normal_block_size);
+    CHECK_EQ(counted_allocs, 6);
+
+    // a child with a smaller first block still gets a cached normal block.
+    {
+        Arena::Options small_ops = ops;
+        small_ops.suggested_init_block_size = ops.normal_block_size / 2;
+        Arena small_parent(small_ops);
+        Arena child = small_parent.CreateChild();
+        CHECK_NE(child.AllocateAligned(100), nullptr);
+        CHECK_EQ(small_parent.SpaceCached(), ops.normal_block_size);
+    }
+
+    // the parent can still be reset independently, and the idle cached blocks are freed with it,
+    // while the blocks lent to a living child stay.
+    counted_allocs = 0;
+    {
+        Arena child = parent.CreateChild();
+        CHECK_NE(child.AllocateAligned(100), nullptr);
+        parent.Reset();
+        CHECK_EQ(parent.SpaceAllocated(), ops.suggested_init_block_size);
+        CHECK_EQ(parent.SpaceCached(), ops.normal_block_size);
+    }
+    CHECK_EQ(parent.SpaceCached(), ops.normal_block_size);
+    CHECK_EQ(counted_allocs, 0);
+    parent.ResetAndRelease(0);
+    CHECK_EQ(parent.SpaceCached(), 0);
+    delete mock_cleaners;
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ArenaTest.ChildArenaLimitTest") {
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.logger_func = &silent_logger;
+    ops.space_limit = 3 * ops.normal_block_size;
+    Arena parent(ops);
+    CHECK_NE(parent.AllocateAligned(100), nullptr);
+    Arena child = parent.CreateChild();
+    CHECK_NE(child.AllocateAligned(3000), nullptr);
+    CHECK_NE(child.AllocateAligned(3000), nullptr);
+    // the space of the child is charged to the parent.
+    CHECK_EQ(child.AllocateAligned(3000), nullptr);
+    CHECK_EQ(parent.AllocateAligned(4000), nullptr);
+}
+
+static std::vector<ArenaBlockStats> reported_blocks;  // NOLINT
+
+// NOLINTNEXTLINE
+static void record_block(const ArenaBlockStats& stats, [[maybe_unused]] void* cookie) {
+    reported_blocks.push_back(stats);
+}
+
+TEST_CASE("ArenaTest.StatsTest") {
+    reported_blocks.clear();
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.normal_block_size = 1024;
+    ops.suggested_init_block_size = 1024;
+    ops.on_arena_block = &record_block;
+    auto* arena = new Arena(ops);
+
+    CHECK_EQ(arena->Stats().block_count, 0);
+    CHECK_NE(arena->AllocateAligned(8), nullptr);
+    ArenaStats stats = arena->Stats();
+    CHECK_EQ(stats.block_count, 1);
+    CHECK_EQ(stats.space_allocated, 1024);
+    CHECK_EQ(stats.used, 8);
+    CHECK_EQ(stats.alignment_waste, 0);
+    CHECK_EQ(stats.tail_waste, 0);
+    CHECK_EQ(stats.available, 1024 - kBlockHeaderSize - 8);
+
+    // the padding for a larger alignment is counted as used and alignment waste.
+    CHECK_NE(arena->AllocateAligned(8, 32), nullptr);
+    stats = arena->Stats();
+    CHECK_GT(stats.alignment_waste, 0);
+    CHECK_EQ(stats.used, 16 + stats.alignment_waste);
+
+    // the cleanup nodes are at the end of the block.
+    CHECK_NE(arena->AllocateAlignedAndAddCleanup(8, [](void* /*unused*/) {}, nullptr), nullptr);
+    stats = arena->Stats();
+    CHECK_EQ(stats.used, 24 + stats.alignment_waste);
+    CHECK_GT(stats.cleanup, 0);
+    CHECK_EQ(stats.used + stats.cleanup + stats.available + kBlockHeaderSize, stats.space_allocated);
+
+    // the remain of the full block becomes the tail waste.
+    uint64_t available = stats.available;
+    CHECK_NE(arena->AllocateAligned(available + 8), nullptr);
+    stats = arena->Stats();
+    CHECK_EQ(stats.block_count, 2);
+    CHECK_EQ(stats.blocks.size(), 2);
+    CHECK_EQ(stats.tail_waste, available);
+    CHECK_EQ(stats.blocks.back().remain, available);
+    CHECK_EQ(stats.blocks.front().used, available + 8);
+    CHECK(reported_blocks.empty());
+
+    // the blocks are reported before they are freed or reset.
+    arena->Reset();
+    CHECK_EQ(reported_blocks.size(), 2);
+    CHECK_EQ(reported_blocks[0].used, available + 8);
+    CHECK_EQ(reported_blocks[1].remain, available);
+    stats = arena->Stats();
+    CHECK_EQ(stats.block_count, 1);
+    CHECK_EQ(stats.used, 0);
+    CHECK_EQ(stats.alignment_waste, 0);
+    CHECK_EQ(stats.cleanup, 0);
+
+    delete arena;
+    CHECK_EQ(reported_blocks.size(), 3);
+    CHECK_EQ(reported_blocks[2].used, 0);
+}
+
 TEST_CASE_FIXTURE(ArenaTest, "ArenaTest.NullTest") {
     mock_cleaners = new cleanup_mock;
     mock = new alloc_fail_class;
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "container/bitvector.hpp"
+
+#include <cstddef>  // for size_t
+#include <random>   // for mt19937_64
+#include <vector>   // for vector
+
+#include "doctest/doctest.h"  // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::container {
+
+TEST_CASE("stdb_bitvector set and test") {
+    stdb_bitvector bits;
+    CHECK(bits.empty());
+    CHECK_EQ(bits.find_first(), stdb_bitvector::npos);
+    for (std::size_t i = 0; i < 200; ++i) {
+        bits.push_back(i % 3 == 0);
+    }
+    CHECK_EQ(bits.size(), 200);
+    CHECK_EQ(bits.words().size(), 4);
+    CHECK_EQ(bits.count(), 67);
+    CHECK(bits.test(99));
+    CHECK_FALSE(bits[100]);
+    bits.set(100);
+    bits.reset(99);
+    bits.flip(101);
+    bits.set(102, true);
+    CHECK(bits[100]);
+    CHECK_FALSE(bits[99]);
+    CHECK(bits[101]);
+    CHECK(bits[102]);
+    CHECK_EQ(bits.count(), 68);
+
+    bits.flip();
+    CHECK_EQ(bits.count(), 200 - 68);
+    bits.set();
+    CHECK(bits.all());
+    CHECK_EQ(bits.count(), 200);
+    bits.reset();
+    CHECK(bits.none());
+
+    SUBCASE("resize keeps the tail clean") {
+        stdb_bitvector ones(70, true);
+        CHECK_EQ(ones.count(), 70);
+        ones.resize(130, true);
+        CHECK_EQ(ones.count(), 130);
+        ones.resize(65);
+        CHECK_EQ(ones.count(), 65);
+        CHECK_EQ(ones.words().size(), 2);
+        ones.resize(100);
+        CHECK_EQ(ones.count(), 65);
+        ones.pop_back();
+        ones.resize(64);
+        CHECK_EQ(ones.words().size(), 1);
+        CHECK(ones.all());
+        ones.pop_back();
+        CHECK_EQ(ones.count(), 63);
+        CHECK_EQ((stdb_bitvector{true, false, true}), (stdb_bitvector{true, false, true}));
+        CHECK_NE((stdb_bitvector{true, false}), (stdb_bitvector{true, false, false}));
+    }
+}
+
+TEST_CASE("stdb_bitvector find and select") {
+    std::mt19937_64 rng(7);
+    stdb_bitvector bits(1000);
+    std::vector<std::size_t> positions;
+    for (std::size_t i = 0; i < bits.size(); ++i) {
+        if (rng() % 7 == 0) {
+            bits.set(i);
+            positions.push_back(i);
+        }
+    }
+    REQUIRE_EQ(bits.count(), positions.size());
+
+    std::vector<std::size_t> found;
+    for (auto pos = bits.find_first(); pos != stdb_bitvector::npos; pos = bits.find_next(pos)) {
+        found.push_back(pos);
+    }
+    CHECK_EQ(found, positions);
+
+    std::vector<std::size_t> visited;
+    bits.for_each_set([&visited](std::size_t pos) { visited.push_back(pos); });
+    CHECK_EQ(visited, positions);
+
+    bool selected = true;
+    for (std::size_t rank = 0; rank < positions.size(); ++rank) {
+        selected = selected and bits.select(rank) == positions[rank];
+    }
+    CHECK(selected);
+    CHECK_EQ(bits.select(positions.size()), stdb_bitvector::npos);
+
+    stdb_bitvector dense(64, true);
+    CHECK_EQ(dense.select(63), 63);
+    CHECK_EQ(dense.find_next(63), stdb_bitvector::npos);
+    CHECK_EQ(stdb_bitvector().select(0), stdb_bitvector::npos);
+}
+
+TEST_CASE("stdb_bitvector select after modifications") {
+    // several superblocks, the directory is rebuilt by the select after every modifier.
+    stdb_bitvector bits(5000);
+    for (std::size_t i = 0; i < bits.size(); i += 3) {
+        bits.set(i);
+    }
+    CHECK_EQ(bits.select(1000), 3000);
+    bits.reset(0);
+    CHECK_EQ(bits.select(1000), 3003);
+    bits.flip(1);
+    CHECK_EQ(bits.select(0), 1);
+    bits.resize(10000, true);
+    CHECK_EQ(bits.select(bits.count() - 1), 9999);
+    bits.words()[0] = 0;
+    CHECK_EQ(bits.select(0), 66);
+    stdb_bitvector other(10000, true);
+    bits &= other;
+    bits.flip();
+    CHECK_EQ(bits.select(0), 0);
+    bits.push_back(true);
+    CHECK_EQ(bits.select(bits.count() - 1), 10000);
+    bits.pop_back();
+    CHECK_EQ(bits.select(bits.count()), stdb_bitvector::npos);
+    bits.swap(other);
+    CHECK_EQ(bits.select(9999), 9999);
+    CHECK_EQ(other.select(0), 0);
+    bits.reset();
+    CHECK_EQ(bits.select(0), stdb_bitvector::npos);
+    bits.set();
+    CHECK_EQ(bits.select(4321), 4321);
+    bits.clear();
+    CHECK_EQ(bits.select(0), stdb_bitvector::npos);
+}
+
+TEST_CASE("stdb_bitvector word operations") {
+    stdb_bitvector lhs(1000);
+    stdb_bitvector rhs(1000);
+    for (std::size_t i = 0; i < 1000; ++i) {
+        lhs.set(i, i % 2 == 0);
+        rhs.set(i, i % 3 == 0);
+    }
+    auto both = lhs;
+    both &= rhs;
+    CHECK_EQ(both.count(), 167);
+    auto either = lhs;
+    either |= rhs;
+    CHECK_EQ(either.count(), 500 + 334 - 167);
+    auto one = lhs;
+    one ^= rhs;
+    CHECK_EQ(one.count(), 500 + 334 - 2 * 167);
+    auto only_lhs = lhs;
+    only_lhs.and_not(rhs);
+    CHECK_EQ(only_lhs.count(), 500 - 167);
+    CHECK_EQ(only_lhs.find_first(), 2);
+}
+
+}  // namespace stdb::container
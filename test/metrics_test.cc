@@ -31,11 +31,22 @@
 */
 #include "arena/metrics.hpp"
 
-#include <cstdlib>  // for free, malloc
-#include <thread>   // for thread
+#include <algorithm>  // for max
+#include <atomic>     // for atomic
+#include <chrono>     // for milliseconds, hours
+#include <cmath>      // for abs
+#include <cstdlib>    // for free, malloc
+#include <map>        // for map
+#include <set>        // for set
+#include <sstream>    // for istringstream
+#include <string>     // for string
+#include <thread>     // for thread
+#include <typeinfo>   // for type_info
+#include <utility>    // for move, integer_sequence
 
-#include "arena/arena.hpp"    // for Arena, Arena::Options
-#include "doctest/doctest.h"  // for binary_assert, CHECK_EQ, TestCase, CHECK
+#include "arena/arena.hpp"         // for Arena, Arena::Options
+#include "arena/open_metrics.hpp"  // for to_open_metrics
+#include "doctest/doctest.h"       // for binary_assert, CHECK_EQ, TestCase, CHECK
 
 namespace stdb::memory {
 
@@ -59,7 +70,9 @@ class ThreadLocalArenaMetricsTest
         ops.on_arena_reset = &metrics_probe_on_arena_reset;
         ops.on_arena_allocation = &metrics_probe_on_arena_allocation;
         ops.on_arena_newblock = &metrics_probe_on_arena_newblock;
+        ops.on_arena_block = &metrics_probe_on_arena_block;
         ops.on_arena_destruction = &metrics_probe_on_arena_destruction;
+        ops.on_arena_move = &metrics_probe_on_arena_move;
     };
 
     ~ThreadLocalArenaMetricsTest() {
@@ -104,8 +117,9 @@ TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsAllocation") {
         auto& m = local_arena_metrics;
         CHECK(_);
         CHECK_EQ(m.alloc_count, 2);
-        CHECK_EQ(m.alloc_size_bucket_counter[0], 1);
-        CHECK_EQ(m.alloc_size_bucket_counter[1], 1);
+        CHECK_EQ(m.alloc_size_histogram.count(m.alloc_size_histogram.bucket_index(10)), 1);
+        CHECK_EQ(m.alloc_size_histogram.count(m.alloc_size_histogram.bucket_index(100)), 1);
+        CHECK_EQ(m.alloc_size_histogram.total(), 2);
         CHECK_EQ(m.space_allocated, 110);
     }
 }
@@ -227,4 +241,530 @@ TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsReportToGlobalMetrics") {
     }
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsScrape") {
+    auto* a = new Arena(ops);
+    auto* _ = a->AllocateAligned(10);
+    CHECK(_);
+    delete a;
+
+    // the unreported shard is scraped.
+    auto snapshot = scrape_arena_metrics();
+    CHECK_EQ(global_arena_metrics.alloc_count, 0);
+    CHECK_EQ(snapshot.init_count, 1);
+    CHECK_EQ(snapshot.alloc_count, 1);
+    CHECK_EQ(snapshot.space_allocated, 10);
+    CHECK_EQ(snapshot.alloc_size_histogram.total(), 1);
+    CHECK_EQ(snapshot.destruct_lifetime_histogram.total(), 1);
+
+    // reporting moves the counters, it does not change the scraped result.
+    local_arena_metrics.report_to_global_metrics();
+    snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.alloc_count, 1);
+    CHECK_EQ(snapshot.space_allocated, 10);
+
+    // the threads never report, their shards are scraped while running and flushed on exit.
+    constexpr uint64_t kAllocCount = 1000;
+    std::atomic<int> ready{0};
+    std::atomic<bool> stop{false};
+    auto worker = [this, &ready, &stop]() {
+        auto* aa = new Arena(ops);
+        for (uint64_t i = 0; i < kAllocCount; i++) {
+            auto* ptr = aa->AllocateAligned(10);
+            CHECK(ptr);
+        }
+        delete aa;
+        ready.fetch_add(1);
+        while (not stop.load()) {
+            std::this_thread::yield();
+        }
+    };
+    std::thread t1(worker);
+    std::thread t2(worker);
+    while (ready.load() != 2) {
+        std::this_thread::yield();
+    }
+    snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.alloc_count, 1 + 2 * kAllocCount);
+    CHECK_EQ(snapshot.init_count, 3);
+    stop.store(true);
+    t1.join();
+    t2.join();
+
+    CHECK_EQ(global_arena_metrics.alloc_count, 1 + 2 * kAllocCount);
+    snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.alloc_count, 1 + 2 * kAllocCount);
+    CHECK_EQ(snapshot.destruct_count, 3);
+}
+
+struct metrics_point
+{
+    uint64_t x;
+    uint64_t y;
+};
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsTypeCounter") {
+    const std::string point_name = ArenaMetricsSnapshot::type_name(&typeid(metrics_point));
+    CHECK_EQ(point_name, "stdb::memory::metrics_point");
+    CHECK_EQ(ArenaMetricsSnapshot::type_name(&typeid(void)), "<raw>");
+
+    auto* a = new Arena(ops);
+    for (int i = 0; i < 3; ++i) {
+        auto* point = a->Create<metrics_point>();
+        CHECK(point);
+    }
+    auto* ints = a->CreateArray<int>(10);
+    CHECK(ints);
+    auto* raw = a->AllocateAligned(16);
+    CHECK(raw);
+
+    auto snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.type_counter[point_name].count, 3);
+    CHECK_EQ(snapshot.type_counter[point_name].bytes, 3 * sizeof(metrics_point));
+    CHECK_EQ(snapshot.type_counter[point_name].live_count, 3);
+    CHECK_EQ(snapshot.type_counter["int"].count, 1);
+    CHECK_EQ(snapshot.type_counter["int"].bytes, 10 * sizeof(int));
+    CHECK_EQ(snapshot.type_counter["<raw>"].live_bytes, 16);
+
+    // reset frees the live objects, but not the counters.
+    a->Reset();
+    auto* point = a->Create<metrics_point>();
+    CHECK(point);
+    local_arena_metrics.report_to_global_metrics();
+    snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.type_counter[point_name].count, 4);
+    CHECK_EQ(snapshot.type_counter[point_name].live_count, 1);
+    CHECK_EQ(snapshot.type_counter[point_name].live_bytes, sizeof(metrics_point));
+    CHECK_EQ(snapshot.type_counter["int"].live_count, 0);
+    CHECK_EQ(snapshot.type_counter["<raw>"].live_bytes, 0);
+    CHECK_NE(snapshot.string().find("stdb::memory::metrics_point: 4 "), std::string::npos);
+
+    // the arena is destructed by another thread.
+    std::thread destructor([a]() { delete a; });
+    destructor.join();
+    snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.type_counter[point_name].count, 4);
+    CHECK_EQ(snapshot.type_counter[point_name].live_count, 0);
+    CHECK_EQ(snapshot.type_counter[point_name].live_bytes, 0);
+}
+
+/*
+ * a minimal OpenMetrics text parser for testing, it maps "name{labels}" to the value, and checks the syntax of the
+ * metadata lines.
+ */
+auto parse_open_metrics(const std::string& text) -> std::map<std::string, double> {
+    std::map<std::string, double> samples;
+    std::istringstream input(text);
+    std::string line;
+    bool eof = false;
+    while (std::getline(input, line)) {
+        REQUIRE_FALSE(eof);
+        if (line == "# EOF") {
+            eof = true;
+            continue;
+        }
+        if (line.starts_with("# ")) {
+            std::istringstream meta(line.substr(2));
+            std::string keyword;
+            std::string family;
+            meta >> keyword >> family;
+            CHECK((keyword == "TYPE" || keyword == "UNIT" || keyword == "HELP"));
+            CHECK(family.starts_with("stdb_arena_"));
+            continue;
+        }
+        auto space = line.rfind(' ');
+        REQUIRE_NE(space, std::string::npos);
+        auto key = line.substr(0, space);
+        CHECK_EQ(key.find(' '), std::string::npos);
+        CHECK_EQ(samples.count(key), 0);
+        samples[key] = std::stod(line.substr(space + 1));
+    }
+    CHECK(eof);
+    return samples;
+}
+
+template <int N>
+struct metrics_tag
+{
+    uint64_t value;
+};
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsTypeCounterOverflow") {
+    // more types than the table of an arena holds, the rest are live in the overflow bucket.
+    constexpr int kTypes = 20;
+    constexpr uint64_t kArenaTypes = kArenaTypeCapacity / 4 * 3;
+    auto* a = new Arena(ops);
+    [a]<int... N>(std::integer_sequence<int, N...>) {
+        (CHECK(a->Create<metrics_tag<N>>()), ...);
+    }(std::make_integer_sequence<int, kTypes>{});
+
+    auto snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.type_counter["<overflow>"].count, 0);
+    CHECK_EQ(snapshot.type_counter["<overflow>"].live_count, kTypes - kArenaTypes);
+    CHECK_EQ(snapshot.type_counter["<overflow>"].live_bytes, (kTypes - kArenaTypes) * sizeof(metrics_tag<0>));
+    uint64_t count = 0;
+    uint64_t live_count = 0;
+    for (const auto& [name, stats] : snapshot.type_counter) {
+        count += stats.count;
+        live_count += stats.live_count;
+    }
+    CHECK_EQ(count, kTypes);
+    CHECK_EQ(live_count, kTypes);
+
+    // they are counted down by the reset as well, through the global metrics.
+    local_arena_metrics.report_to_global_metrics();
+    a->Reset();
+    local_arena_metrics.report_to_global_metrics();
+    snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.type_counter["<overflow>"].live_count, 0);
+    CHECK_EQ(snapshot.type_counter["<overflow>"].live_bytes, 0);
+    delete a;
+
+    // the table of a thread overflows the same way.
+    TypeCounter<kArenaTypeCapacity, uint64_t> counter;
+    CHECK(counter.add(&typeid(int), 1, 4));
+    [&counter]<int... N>(std::integer_sequence<int, N...>) {
+        (counter.add(&typeid(metrics_tag<N>), 1, sizeof(metrics_tag<N>)), ...);
+    }(std::make_integer_sequence<int, kTypes>{});
+    CHECK_EQ(counter.size(), kArenaTypes);
+    CHECK_EQ(counter.overflow_count(), kTypes + 1 - kArenaTypes);
+    CHECK_EQ(counter.overflow_bytes(), (kTypes + 1 - kArenaTypes) * sizeof(metrics_tag<0>));
+    CHECK_FALSE(counter.add(&typeid(char), 1, 1));
+    CHECK(counter.add(&typeid(int), 1, 4));
+    counter.clear();
+    CHECK_EQ(counter.overflow_count(), 0);
+    CHECK_EQ(ArenaMetricsSnapshot::type_name(nullptr), "<overflow>");
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsOpenMetrics") {
+    // an empty snapshot is valid.
+    auto empty = parse_open_metrics(to_open_metrics(ArenaMetricsSnapshot{}));
+    CHECK_EQ(empty["stdb_arena_alloc_total"], 0);
+    CHECK_EQ(empty["stdb_arena_alloc_size_bytes_count"], 0);
+    CHECK_EQ(empty["stdb_arena_alloc_size_bytes_bucket{le=\"+Inf\"}"], 0);
+    // and the human format does not divide by zero.
+    CHECK_FALSE(ArenaMetricsSnapshot{}.string().empty());
+
+    auto* a = new Arena(ops);
+    for (uint64_t size : {8UL, 10UL, 100UL, 1000UL}) {
+        auto* ptr = a->AllocateAligned(size);
+        CHECK(ptr);
+    }
+    delete a;
+    auto samples = parse_open_metrics(to_open_metrics(scrape_arena_metrics()));
+    CHECK_EQ(samples["stdb_arena_init_total"], 1);
+    CHECK_EQ(samples["stdb_arena_destruct_total"], 1);
+    CHECK_EQ(samples["stdb_arena_alloc_total"], 4);
+    CHECK_EQ(samples["stdb_arena_space_allocated_bytes_total"], 1118);
+
+    // the buckets are cumulative.
+    CHECK_EQ(samples["stdb_arena_alloc_size_bytes_bucket{le=\"8\"}"], 1);
+    CHECK_EQ(samples["stdb_arena_alloc_size_bytes_bucket{le=\"10\"}"], 2);
+    CHECK_EQ(samples["stdb_arena_alloc_size_bytes_bucket{le=\"+Inf\"}"], 4);
+    CHECK_EQ(samples["stdb_arena_alloc_size_bytes_count"], 4);
+    CHECK_EQ(samples["stdb_arena_alloc_size_bytes_sum"], 1118);
+    double last = 0;
+    for (const auto& [key, value] : samples) {
+        if (key.starts_with("stdb_arena_alloc_size_bytes_bucket") && !key.ends_with("\"+Inf\"}")) {
+            auto le = std::stod(key.substr(key.find('"') + 1));
+            CHECK_GT(value, 0);
+            CHECK_LE(le, 1100);
+            last = std::max(last, value);
+        }
+    }
+    CHECK_EQ(last, 4);
+    CHECK_EQ(samples["stdb_arena_lifetime_seconds_count"], 1);
+
+    // the call site of the arena construction is labeled.
+    bool site_found = false;
+    for (const auto& [key, value] : samples) {
+        if (key.starts_with("stdb_arena_site_alloc_bytes_total{file=\"") &&
+            key.find("arena.hpp") != std::string::npos) {
+            site_found = true;
+            CHECK_NE(key.find(",line=\""), std::string::npos);
+            CHECK_EQ(value, 1118);
+        }
+    }
+    CHECK(site_found);
+
+    CHECK_EQ(samples["stdb_arena_type_alloc_total{type=\"<raw>\"}"], 4);
+    CHECK_EQ(samples["stdb_arena_type_alloc_bytes_total{type=\"<raw>\"}"], 1118);
+    CHECK_EQ(samples["stdb_arena_type_live_objects{type=\"<raw>\"}"], 0);
+    CHECK_EQ(samples["stdb_arena_type_live_bytes{type=\"<raw>\"}"], 0);
+
+    // the overflowed values are counted by +Inf only, and summed unclamped.
+    ArenaMetricsSnapshot overflow;
+    overflow.alloc_size_histogram.record(AllocSizeHistogram<uint64_t>::kMaxValue + 1, 2);
+    overflow.alloc_size_histogram.record(8);
+    auto overflow_samples = parse_open_metrics(to_open_metrics(overflow));
+    CHECK_EQ(overflow_samples["stdb_arena_alloc_size_bytes_bucket{le=\"8\"}"], 1);
+    CHECK_EQ(overflow_samples["stdb_arena_alloc_size_bytes_bucket{le=\"+Inf\"}"], 3);
+    CHECK_EQ(overflow_samples["stdb_arena_alloc_size_bytes_sum"],
+             static_cast<double>(2 * (AllocSizeHistogram<uint64_t>::kMaxValue + 1) + 8));
+    for (const auto& [key, value] : overflow_samples) {
+        if (key.starts_with("stdb_arena_alloc_size_bytes_bucket") && !key.ends_with("\"+Inf\"}")) {
+            CHECK_EQ(value, 1);
+        }
+    }
+
+    // the prefix is customizable.
+    CHECK(to_open_metrics(ArenaMetricsSnapshot{}, "my_app").starts_with("# TYPE my_app_init counter"));
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("LogLinearHistogram") {
+    using histogram = LogLinearHistogram<kAllocSizeHistogramBits>;
+
+    SUBCASE("bucket index") {
+        // the small values are exact.
+        for (uint64_t value = 0; value < 2 * histogram::kSubBucketCount; ++value) {
+            CHECK_EQ(histogram::bucket_index(value), value);
+            CHECK_EQ(histogram::bucket_lower(histogram::bucket_index(value)), value);
+        }
+        // every value is in its bucket, and the bucket is narrow enough.
+        for (uint64_t value = 2 * histogram::kSubBucketCount; value < histogram::kMaxValue; value = value * 3 + 7) {
+            auto idx = histogram::bucket_index(value);
+            CHECK_LT(idx, histogram::kBucketCount);
+            CHECK_LE(histogram::bucket_lower(idx), value);
+            CHECK_GT(histogram::bucket_upper(idx), value);
+            CHECK_LE((histogram::bucket_upper(idx) - histogram::bucket_lower(idx)) * histogram::kSubBucketCount,
+                     histogram::bucket_lower(idx));
+        }
+        // the buckets are continuous.
+        for (uint32_t idx = 0; idx + 1 < histogram::kBucketCount; ++idx) {
+            CHECK_EQ(histogram::bucket_upper(idx), histogram::bucket_lower(idx + 1));
+        }
+        CHECK_EQ(histogram::bucket_index(histogram::kMaxValue), histogram::kBucketCount - 1);
+        CHECK_EQ(histogram::bucket_index(~0ULL), histogram::kBucketCount - 1);
+        CHECK_EQ(histogram::bucket_index(64ULL << 30U), histogram::kBucketCount - 1);
+    }
+
+    SUBCASE("percentile") {
+        histogram hist;
+        CHECK_EQ(hist.percentile(50), 0);
+        for (uint64_t value = 1; value <= 10000; ++value) {
+            hist.record(value);
+        }
+        CHECK_EQ(hist.total(), 10000);
+        auto p50 = static_cast<double>(hist.percentile(50));
+        auto p99 = static_cast<double>(hist.percentile(99));
+        CHECK_LT(std::abs(p50 - 5000) / 5000, 0.05);
+        CHECK_LT(std::abs(p99 - 9900) / 9900, 0.05);
+        CHECK_EQ(hist.percentile(0), 1);
+        CHECK_GE(hist.percentile(100), 9500);
+    }
+
+    SUBCASE("merge") {
+        LogLinearHistogram<kAllocSizeHistogramBits, ShardCounter> shard;
+        LogLinearHistogram<kAllocSizeHistogramBits, std::atomic<uint64_t>> global;
+        shard.record(8);
+        shard.record(1UL << 30U, 3);
+        global.merge(shard);
+        global.merge(shard);
+        histogram snapshot;
+        snapshot.merge(global);
+        CHECK_EQ(snapshot.total(), 8);
+        CHECK_EQ(snapshot.count(histogram::bucket_index(8)), 2);
+        CHECK_EQ(snapshot.count(histogram::bucket_index(1UL << 30U)), 6);
+        CHECK_EQ(snapshot.sum(), 2 * (8 + (3UL << 30U)));
+        snapshot.clear();
+        CHECK_EQ(snapshot.total(), 0);
+        CHECK_EQ(snapshot.sum(), 0);
+    }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("CallSiteCounter") {
+    static constexpr uint32_t kCapacity = 16;
+    CallSiteCounter<kCapacity> counter;
+    const char* file_a = "a.cc";
+    const char* file_b = "b.cc";
+    counter.add(file_a, 1, 10);
+    counter.add(file_a, 1, 5);
+    counter.add(file_a, 2, 7);
+    counter.add(file_b, 1, 3);
+    CHECK_EQ(counter.size(), 3);
+    CHECK_EQ(counter.get(file_a, 1), 15);
+    CHECK_EQ(counter.get(file_a, 2), 7);
+    CHECK_EQ(counter.get(file_b, 1), 3);
+    CHECK_EQ(counter.get(file_b, 2), 0);
+
+    // the load factor is kept below 3/4.
+    for (uint32_t line = 100; line < 120; ++line) {
+        counter.add(file_b, line, 1);
+    }
+    CHECK_EQ(counter.size(), kCapacity / 4 * 3);
+    CHECK_EQ(counter.overflow(), 20 - (kCapacity / 4 * 3 - 3));
+    CHECK_EQ(counter.get(file_a, 1), 15);
+
+    uint64_t total = 0;
+    counter.for_each([&total](const char* /*unused*/, uint32_t /*unused*/, uint64_t value) { total += value; });
+    CHECK_EQ(total + counter.overflow(), 15 + 7 + 3 + 20);
+
+    counter.clear();
+    CHECK_EQ(counter.size(), 0);
+    CHECK_EQ(counter.overflow(), 0);
+    CHECK_EQ(counter.get(file_a, 1), 0);
+}
+
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsBlockUtilization") {
+    auto* a = new Arena(ops);
+    auto* p1 = a->AllocateAligned(8);
+    auto* p2 = a->AllocateAligned(8, 32);
+    auto* p3 = a->AllocateAligned(2000);
+    a->Reset();
+    CHECK(p1 != nullptr);
+    CHECK(p2 != nullptr);
+    CHECK(p3 != nullptr);
+    auto& m = local_arena_metrics;
+    // the huge block was freed and the first block was reset.
+    CHECK_EQ(m.block_count, 2);
+    CHECK_GT(m.block_alignment_waste, 0);
+    CHECK_GT(m.block_tail_waste, 0);
+    CHECK_EQ(m.block_size_histogram.total(), 2);
+    CHECK_EQ(m.block_utilization_histogram.total(), 2);
+    CHECK_LE(m.block_utilization_histogram.percentile(100), 100);
+
+    delete a;
+    CHECK_EQ(m.block_count, 3);
+    m.report_to_global_metrics();
+    ArenaMetricsSnapshot snapshot = scrape_arena_metrics();
+    CHECK_EQ(snapshot.block_count, 3);
+    CHECK_EQ(snapshot.block_utilization_histogram.total(), 3);
+    auto samples = parse_open_metrics(to_open_metrics(snapshot));
+    CHECK_EQ(samples["stdb_arena_block_total"], 3);
+    CHECK_EQ(samples["stdb_arena_block_size_bytes_count"], 3);
+    CHECK_EQ(samples["stdb_arena_block_utilization_ratio_bucket{le=\"+Inf\"}"], 3);
+    CHECK_NE(snapshot.string().find("BlockUtilization distribution:"), std::string::npos);
+}
+
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsCookieStorage") {
+    {
+        Arena a(ops);
+        CHECK_NE(a.AllocateAligned(10), nullptr);
+        // the cookie in the storage moves with the arena, and the moved-from arena is not counted.
+        Arena b(std::move(a));
+        CHECK_NE(b.AllocateAligned(20), nullptr);
+    }
+    auto& m = local_arena_metrics;
+    CHECK_EQ(m.init_count, 1);
+    CHECK_EQ(m.destruct_count, 1);
+    CHECK_EQ(m.alloc_count, 2);
+    uint64_t total = 0;
+    m.arena_alloc_counter.for_each(
+      [&total](const char* /*unused*/, uint32_t /*unused*/, uint64_t value) { total += value; });
+    CHECK_EQ(total, 30);
+    // the live objects counted by the moved cookie are freed by the destruction.
+    uint64_t live = 0;
+    m.type_live_counter.for_each(
+      [&live](const std::type_info* /*unused*/, uint64_t count, uint64_t /*unused*/) { live += count; });
+    CHECK_EQ(live, 0);
+}
+
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsLiveArenasMove") {
+    auto* before = new Arena(ops);
+    auto* moved = new Arena(ops);
+    CHECK_NE(moved->AllocateAligned(100), nullptr);
+    auto* after = new Arena(ops);
+    // the node of the moved arena is replaced in the middle of the list, the moved-from one is gone.
+    auto* target = new Arena(std::move(*moved));
+    delete moved;
+    auto arenas = live_arenas();
+    REQUIRE_EQ(arenas.size(), 3);
+    CHECK_EQ(arenas[1].arena, target);
+    CHECK_EQ(arenas[1].space_allocated, target->SpaceAllocated());
+    CHECK((std::set<const Arena*>{arenas[0].arena, arenas[2].arena} == std::set<const Arena*>{before, after}));
+
+    delete before;
+    delete after;
+    arenas = live_arenas();
+    REQUIRE_EQ(arenas.size(), 1);
+    CHECK_EQ(arenas[0].arena, target);
+    delete target;
+    CHECK(live_arenas().empty());
+    CHECK_EQ(local_arena_metrics.destruct_count, 3);
+}
+
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsLiveArenas") {
+    CHECK(live_arenas().empty());
+    auto* small = new Arena(ops);
+    CHECK_NE(small->AllocateAligned(10), nullptr);
+    auto* large = new Arena(ops);
+    CHECK_NE(large->AllocateAligned(10000), nullptr);
+    auto* idle = new Arena(ops);
+
+    auto arenas = live_arenas();
+    CHECK_EQ(arenas.size(), 3);
+    auto top = top_live_arenas(2);
+    CHECK_EQ(top.size(), 2);
+    CHECK_EQ(top[0].arena, large);
+    CHECK_EQ(top[0].space_allocated, large->SpaceAllocated());
+    CHECK_EQ(top[1].arena, small);
+    CHECK_NE(std::string(top[0].init_location.file_name()).find("arena.hpp"), std::string::npos);
+    CHECK_EQ(top_live_arenas(10).size(), 3);
+
+    // the space is updated by reset.
+    large->Reset();
+    top = top_live_arenas(1);
+    CHECK_EQ(top[0].space_allocated, large->SpaceAllocated());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    auto* young = new Arena(ops);
+    auto old = live_arenas_older_than(std::chrono::milliseconds(1));
+    CHECK_EQ(old.size(), 3);
+    CHECK_LE(old[0].init_time_point, old[2].init_time_point);
+    CHECK(live_arenas_older_than(std::chrono::hours(1)).empty());
+    delete young;
+
+    // the moved arena is relinked.
+    {
+        Arena moved(std::move(*idle));
+        delete idle;
+        CHECK_EQ(live_arenas().size(), 3);
+        bool found = false;
+        for (const auto& info : live_arenas()) {
+            found = found || info.arena == &moved;
+        }
+        CHECK(found);
+    }
+    CHECK_EQ(live_arenas().size(), 2);
+
+    // the arenas of an exited thread are still live, and can be destroyed in another thread.
+    Arena* orphan = nullptr;
+    std::thread([&orphan, this] {
+        orphan = new Arena(ops);
+        CHECK_NE(orphan->AllocateAligned(100), nullptr);
+    }).join();
+    CHECK_EQ(live_arenas().size(), 3);
+    delete orphan;
+    std::thread([small] { delete small; }).join();
+    CHECK_EQ(live_arenas().size(), 1);
+    delete large;
+    CHECK(live_arenas().empty());
+}
+
+TEST_CASE_FIXTURE(ThreadLocalArenaMetricsTest, "MetricsArenaAllocCounter") {
+    auto* a = new Arena(ops);
+    auto* _ = a->AllocateAligned(10);
+    CHECK(_);
+    _ = a->AllocateAligned(20);
+    CHECK(_);
+    delete a;
+    CHECK_EQ(local_arena_metrics.arena_alloc_counter.size(), 1);
+    uint64_t total = 0;
+    local_arena_metrics.arena_alloc_counter.for_each(
+      [&total](const char* /*unused*/, uint32_t /*unused*/, uint64_t value) { total += value; });
+    CHECK_EQ(total, 30);
+
+    local_arena_metrics.report_to_global_metrics();
+    CHECK_EQ(local_arena_metrics.arena_alloc_counter.size(), 0);
+    CHECK_EQ(global_arena_metrics.arena_alloc_counter.size(), 1);
+    const auto& [loc, count] = *global_arena_metrics.arena_alloc_counter.begin();
+    CHECK_NE(loc.find("arena.hpp:"), std::string::npos);
+    CHECK_EQ(count.load(), 30);
+}
+
 }  // namespace stdb::memory
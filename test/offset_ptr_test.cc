@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+
+#include "arena/offset_ptr.hpp"
+
+#include <cstdint>  // for uint64_t
+#include <cstdlib>  // for free, malloc
+#include <cstring>  // for memcpy
+
+#include "arena/arena.hpp"    // for Arena
+#include "doctest/doctest.h"  // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::memory {
+
+struct offset_node
+{
+    uint64_t value;
+    arena_offset_ptr<offset_node> next;
+};
+
+static_assert(std::is_trivially_destructible_v<arena_offset_ptr<int>>);
+static_assert(Creatable<offset_node>, "node with offset ptr should be Creatable");
+
+TEST_CASE("OffsetPtr.null") {
+    arena_offset_ptr<int> ptr;
+    CHECK_FALSE(ptr);
+    CHECK_EQ(ptr.get(), nullptr);
+    CHECK(ptr == nullptr);
+
+    int x = 1;
+    ptr = &x;
+    CHECK(ptr);
+    CHECK_EQ(ptr.get(), &x);
+    CHECK_EQ(*ptr, 1);
+
+    ptr = nullptr;
+    CHECK_FALSE(ptr);
+}
+
+TEST_CASE("OffsetPtr.copy_recompute_offset") {
+    int arr[4] = {1, 2, 3, 4};  // NOLINT
+    arena_offset_ptr<int> ptrs[2];  // NOLINT
+    ptrs[0] = &arr[1];
+    ptrs[1] = ptrs[0];
+    CHECK_EQ(ptrs[0].get(), ptrs[1].get());
+    // the same pointee, but different offset because of different position
+    CHECK_NE(ptrs[0].offset(), ptrs[1].offset());
+}
+
+TEST_CASE("OffsetPtr.arithmetic") {
+    uint64_t arr[8] = {0, 1, 2, 3, 4, 5, 6, 7};  // NOLINT
+    arena_offset_ptr<uint64_t> ptr = &arr[0];
+    CHECK_EQ(ptr[3], 3);
+    ++ptr;
+    CHECK_EQ(*ptr, 1);
+    ptr += 3;
+    CHECK_EQ(*ptr, 4);
+    ptr--;
+    CHECK_EQ(*ptr, 3);
+    arena_offset_ptr<uint64_t> end = ptr + 4;
+    CHECK_EQ(*end, 7);
+    CHECK_EQ(end - ptr, 4);
+    CHECK(ptr < end);
+    CHECK_EQ(std::to_address(end), &arr[7]);
+}
+
+TEST_CASE("OffsetPtr.relocate_arena_region") {
+    constexpr uint64_t kRegionSize = 4096;
+    void* region = std::malloc(kRegionSize);
+    void* copied = std::malloc(kRegionSize);
+
+    thread_local void* region_ptr = nullptr;
+    region_ptr = region;
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.suggested_init_block_size = kRegionSize;
+    ops.block_alloc = [](std::size_t /*unused*/) -> void* { return region_ptr; };
+    ops.block_dealloc = [](void* /*unused*/) {};
+
+    offset_node* head = nullptr;
+    {
+        Arena arena(ops);
+        for (uint64_t i = 0; i < 10; ++i) {
+            auto* node = arena.Create<offset_node>();
+            REQUIRE(node != nullptr);
+            node->value = i;
+            node->next = head;
+            head = node;
+        }
+        CHECK_EQ(arena.SpaceAllocated(), kRegionSize);
+        // snapshot the whole region, the copy is in a different address.
+        std::memcpy(copied, region, kRegionSize);
+    }
+    auto head_offset = reinterpret_cast<char*>(head) - static_cast<char*>(region);   // NOLINT
+    auto* copied_head = reinterpret_cast<offset_node*>(static_cast<char*>(copied) + head_offset);  // NOLINT
+    // wipe the original region, make sure the copy does not reference it.
+    std::memset(region, 0, kRegionSize);
+
+    uint64_t expected = 10;
+    for (auto* node = copied_head; node != nullptr; node = node->next.get()) {
+        --expected;
+        CHECK_EQ(node->value, expected);
+        CHECK_GE(reinterpret_cast<char*>(node), static_cast<char*>(copied));
+        CHECK_LT(reinterpret_cast<char*>(node), static_cast<char*>(copied) + kRegionSize);
+    }
+    CHECK_EQ(expected, 0);
+    std::free(region);
+    std::free(copied);
+}
+
+}  // namespace stdb::memory
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "arena/sampler.hpp"
+
+#include <cmath>        // for abs, exp
+#include <cstdint>      // for uint64_t
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <typeindex>    // for type_index
+#include <typeinfo>     // for type_info
+
+#include "arena/arena.hpp"    // for Arena
+#include "doctest/doctest.h"  // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::memory {
+
+struct sampled_point
+{
+    uint64_t x;
+    uint64_t y;
+    uint64_t z;
+    uint64_t w;
+};
+
+static constexpr uint64_t kSampleInterval = 4096;
+static constexpr uint64_t kRounds = 20000;
+
+static uint64_t sample_count = 0;  // NOLINT
+
+// NOLINTNEXTLINE
+static void count_sample(const ArenaAllocationSample& sample, [[maybe_unused]] void* cookie) {
+    CHECK_GT(sample.depth, 0);
+    CHECK_EQ(sample.interval, kSampleInterval);
+    ++sample_count;
+}
+
+[[gnu::noinline]] static void create_points(Arena& arena) {
+    for (uint64_t i = 0; i < kRounds; ++i) {
+        CHECK_NE(arena.Create<sampled_point>(), nullptr);
+    }
+}
+
+[[gnu::noinline]] static void allocate_raw(Arena& arena) {
+    for (uint64_t i = 0; i < kRounds; ++i) {
+        CHECK_NE(arena.AllocateAligned(256), nullptr);
+    }
+}
+
+TEST_CASE("Sampler.Disabled") {
+    sample_count = 0;
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.on_arena_sample = &count_sample;
+    Arena arena(ops);
+    allocate_raw(arena);
+    CHECK_EQ(sample_count, 0);
+}
+
+TEST_CASE("Sampler.Interval") {
+    sample_count = 0;
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.sample_interval = kSampleInterval;
+    ops.on_arena_sample = &count_sample;
+    Arena arena(ops);
+    allocate_raw(arena);
+    // the count of samples is poisson distributed, the deviation is about sqrt(1250).
+    uint64_t expected = kRounds * 256 / kSampleInterval;
+    CHECK_GT(sample_count, expected * 4 / 5);
+    CHECK_LT(sample_count, expected * 6 / 5);
+
+    // an allocation much larger than the interval is almost always sampled, the probability is 1 - exp(-64).
+    sample_count = 0;
+    CHECK_NE(arena.AllocateAligned(kSampleInterval * 64), nullptr);
+    CHECK_EQ(sample_count, 1);
+}
+
+TEST_CASE("Sampler.Profile") {
+    arena_allocation_profile.clear();
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    ops.sample_interval = kSampleInterval;
+    ops.on_arena_sample = &sampler_probe_on_arena_sample;
+    {
+        Arena arena(ops);
+        create_points(arena);
+        allocate_raw(arena);
+    }
+    CHECK_GT(arena_allocation_profile.size(), 0);
+
+    // the estimation is unbiased to the sizes of the allocations.
+    uint64_t total = kRounds * (sizeof(sampled_point) + 256);
+    auto estimated = static_cast<double>(arena_allocation_profile.estimated_bytes());
+    CHECK_LT(std::abs(estimated - static_cast<double>(total)) / static_cast<double>(total), 0.15);
+
+    uint64_t point_bytes = 0;
+    uint64_t raw_bytes = 0;
+    arena_allocation_profile.for_each(
+      [&](const std::type_index& type, const ArenaAllocationProfile::Stack& stack,
+          const ArenaAllocationProfile::Entry& entry) {
+          CHECK_FALSE(stack.empty());
+          CHECK_EQ(entry.bytes % entry.count, 0);
+          if (type == typeid(sampled_point)) {
+              point_bytes += entry.bytes;
+          } else {
+              CHECK(type == typeid(void));
+              raw_bytes += entry.bytes;
+          }
+      });
+    CHECK_GT(point_bytes, 0);
+    CHECK_GT(raw_bytes, point_bytes);
+
+    auto text = arena_allocation_profile.to_pprof();
+    CHECK(text.starts_with("heap profile: "));
+    auto header = std::string_view(text).substr(0, text.find('\n'));
+    CHECK(header.ends_with("@ heap_v2/4096"));
+    CHECK_NE(text.find("] @ 0x"), std::string::npos);
+    CHECK_NE(text.find("\nMAPPED_LIBRARIES:\n"), std::string::npos);
+
+    auto str = arena_allocation_profile.string();
+    CHECK_NE(str.find("<raw>: count "), std::string::npos);
+    CHECK_NE(str.find("sampled_point: count "), std::string::npos);
+    arena_allocation_profile.clear();
+    CHECK_EQ(arena_allocation_profile.size(), 0);
+}
+
+TEST_CASE("Sampler.MixedIntervals") {
+    arena_allocation_profile.clear();
+    void* stack[] = {reinterpret_cast<void*>(0x1000), reinterpret_cast<void*>(0x2000)};  // NOLINT
+    // the same site sampled by two arenas with different intervals.
+    constexpr uint64_t kLargeInterval = kSampleInterval * 256;
+    ArenaAllocationSample sample{.type = nullptr, .size = kSampleInterval, .interval = kSampleInterval,
+                                 .stack = stack, .depth = 2};
+    arena_allocation_profile.add(sample);
+    sample.interval = kLargeInterval;
+    arena_allocation_profile.add(sample);
+    CHECK_EQ(arena_allocation_profile.size(), 2);
+    arena_allocation_profile.for_each(
+      [](const std::type_index& /*unused*/, const ArenaAllocationProfile::Stack& /*unused*/,
+         const ArenaAllocationProfile::Entry& entry) {
+          CHECK((entry.interval == kSampleInterval || entry.interval == kLargeInterval));
+          CHECK_EQ(entry.count, 1);
+      });
+
+    // every entry is unsampled by its own interval.
+    double small_scale = 1.0 / (1.0 - std::exp(-1.0));
+    double large_scale = 1.0 / (1.0 - std::exp(-1.0 / 256));
+    auto expected = static_cast<double>(kSampleInterval) * (small_scale + large_scale);
+    CHECK_LT(std::abs(static_cast<double>(arena_allocation_profile.estimated_bytes()) - expected), 2.0);
+
+    // pprof has one interval, so the entries are unsampled before rendering.
+    auto text = arena_allocation_profile.to_pprof();
+    auto header = std::string_view(text).substr(0, text.find('\n'));
+    CHECK(header.ends_with("@ heap_v2/1"));
+    CHECK_NE(arena_allocation_profile.string().find("interval: mixed"), std::string::npos);
+    arena_allocation_profile.clear();
+}
+
+}  // namespace stdb::memory
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "container/segmented_vector.hpp"
+
+#include <algorithm>  // for equal
+#include <cstddef>    // for size_t
+#include <cstdint>    // for int64_t, uintptr_t
+#include <numeric>    // for accumulate
+#include <span>       // for span
+#include <string>     // for string
+#include <utility>    // for move
+#include <vector>     // for vector
+
+#include "arena/arena.hpp"                 // for Arena
+#include "arena/arena_segment_source.hpp"  // for arena_segment_source
+#include "doctest/doctest.h"               // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::container {
+
+using memory::arena_segment_source;
+
+TEST_CASE("stdb_segmented_vector locate") {
+    using vec_type = stdb_segmented_vector<int64_t>;
+    constexpr std::size_t kFirst = vec_type::kFirstSegment;
+    static_assert(kFirst == 8);
+    CHECK_EQ(vec_type::locate(0).segment, 0);
+    CHECK_EQ(vec_type::locate(kFirst - 1).offset, kFirst - 1);
+    CHECK_EQ(vec_type::locate(kFirst).segment, 1);
+    CHECK_EQ(vec_type::locate(kFirst).offset, 0);
+    CHECK_EQ(vec_type::locate(kFirst * 3 - 1).segment, 1);
+    CHECK_EQ(vec_type::locate(kFirst * 3).segment, 2);
+    CHECK_EQ(vec_type::locate(kFirst * 7 + 5).segment, 3);
+    CHECK_EQ(vec_type::locate(kFirst * 7 + 5).offset, 5);
+}
+
+TEST_CASE("stdb_segmented_vector stable addresses") {
+    stdb_segmented_vector<int64_t> vec;
+    CHECK(vec.empty());
+    CHECK_EQ(vec.begin(), vec.end());
+    std::vector<int64_t*> addresses;
+    for (int64_t i = 0; i < 10000; ++i) {
+        addresses.push_back(&vec.emplace_back(i));
+    }
+    CHECK_EQ(vec.size(), 10000);
+    CHECK_GE(vec.capacity(), 10000);
+    bool stable = true;
+    for (std::size_t i = 0; i < addresses.size(); ++i) {
+        stable = stable and addresses[i] == &vec[i] and *addresses[i] == static_cast<int64_t>(i);
+    }
+    CHECK(stable);
+    CHECK_EQ(vec.front(), 0);
+    CHECK_EQ(vec.back(), 9999);
+
+    // the segments are contiguous, and cover all the elements in order.
+    int64_t expected = 0;
+    bool ordered = true;
+    std::size_t segments = 0;
+    vec.for_each_segment([&](std::span<int64_t> seg) {
+        ++segments;
+        for (auto elem : seg) {
+            ordered = ordered and elem == expected++;
+        }
+    });
+    CHECK(ordered);
+    CHECK_EQ(segments, vec.segment_count());
+    CHECK_EQ(expected, 10000);
+
+    CHECK_EQ(std::accumulate(vec.begin(), vec.end(), int64_t{0}), int64_t{9999} * 10000 / 2);
+    CHECK_EQ(vec.end() - vec.begin(), 10000);
+    CHECK_EQ(*(vec.begin() + 4321), 4321);
+    CHECK_EQ((vec.begin() + 4321)[100], 4421);
+    CHECK_EQ(*--vec.end(), 9999);
+
+    // pop over the segment boundaries, then push again.
+    const std::size_t boundary = decltype(vec)::kFirstSegment * 3;
+    while (vec.size() > boundary - 1) {
+        vec.pop_back();
+    }
+    CHECK_EQ(vec.back(), boundary - 2);
+    vec.push_back(-1);
+    vec.push_back(-2);
+    CHECK_EQ(vec[boundary - 1], -1);
+    CHECK_EQ(vec[boundary], -2);
+    CHECK_EQ(&vec[boundary], addresses[boundary]);
+
+    vec.shrink_to_fit();
+    CHECK_EQ(vec.capacity(), decltype(vec)::kFirstSegment * 7);
+    vec.clear();
+    CHECK(vec.empty());
+    vec.shrink_to_fit();
+    CHECK_EQ(vec.capacity(), 0);
+}
+
+TEST_CASE("stdb_segmented_vector with non trivial elements") {
+    stdb_segmented_vector<std::string> vec;
+    vec.reserve(100);
+    CHECK_GE(vec.capacity(), 100);
+    for (int i = 0; i < 100; ++i) {
+        vec.emplace_back(std::to_string(i) + std::string(32, 'x'));
+    }
+    // the argument refers to an element of the vector.
+    vec.push_back(vec[3]);
+    CHECK_EQ(vec.back(), vec[3]);
+
+    stdb_segmented_vector<std::string> copied(vec);
+    CHECK_EQ(copied.size(), vec.size());
+    CHECK(std::equal(copied.begin(), copied.end(), vec.cbegin(), vec.cend()));
+    stdb_segmented_vector<std::string> moved(std::move(copied));
+    CHECK(copied.empty());  // NOLINT
+    CHECK_EQ(moved[50], vec[50]);
+    copied = moved;
+    CHECK_EQ(copied[99], vec[99]);
+    moved.pop_back();
+    copied = std::move(moved);
+    CHECK_EQ(copied.size(), 100);
+}
+
+struct alignas(64) cache_line
+{
+    int64_t value;
+};
+
+TEST_CASE("stdb_segmented_vector with over aligned elements") {
+    stdb_segmented_vector<cache_line> vec;
+    for (int64_t i = 0; i < 100; ++i) {
+        vec.push_back(cache_line{.value = i});
+    }
+    for (std::size_t seg = 0; seg < vec.segment_count(); ++seg) {
+        CHECK_EQ(reinterpret_cast<std::uintptr_t>(vec.segment(seg).data()) % alignof(cache_line), 0);  // NOLINT
+    }
+    stdb_segmented_vector<cache_line> moved(std::move(vec));
+    CHECK_EQ(moved[99].value, 99);
+    vec = std::move(moved);
+    CHECK_EQ(vec[42].value, 42);
+}
+
+TEST_CASE("stdb_segmented_vector in arena") {
+    memory::Arena arena(memory::Arena::Options::GetDefaultOptions());
+    stdb_segmented_vector<int64_t, arena_segment_source> vec{arena_segment_source(arena)};
+    for (int64_t i = 0; i < 1000; ++i) {
+        vec.push_back(i);
+    }
+    CHECK_EQ(vec[999], 999);
+    CHECK_GE(arena.SpaceAllocated(), vec.capacity() * sizeof(int64_t));
+    stdb_segmented_vector<int64_t, arena_segment_source> copied(vec);
+    CHECK_EQ(copied[500], 500);
+}
+
+}  // namespace stdb::container
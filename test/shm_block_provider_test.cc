@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+
+#include "arena/shm_block_provider.hpp"
+
+#include <sys/wait.h>  // for waitpid
+#include <unistd.h>    // for fork, _exit
+
+#include <cstdint>  // for uint64_t
+#include <cstring>  // for memset
+#include <format>   // for format
+#include <vector>   // for vector
+
+#include "arena/arena.hpp"       // for Arena
+#include "arena/offset_ptr.hpp"  // for arena_offset_ptr
+#include "doctest/doctest.h"     // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::memory {
+
+TEST_CASE("ShmBlockProvider.allocate") {
+    auto provider = ShmBlockProvider::Create(4096, 100);
+    REQUIRE(provider != nullptr);
+    CHECK_EQ(provider->block_size(), 4096);
+    CHECK_EQ(provider->block_num(), 100);
+    CHECK_EQ(provider->free_blocks(), 100);
+
+    SUBCASE("single block") {
+        void* blk = provider->Allocate(100);
+        REQUIRE(blk != nullptr);
+        CHECK(provider->contains(blk));
+        CHECK_EQ(reinterpret_cast<uint64_t>(blk) % ShmBlockProvider::kRegionAlignment, 0);
+        CHECK_EQ(provider->free_blocks(), 99);
+        provider->Deallocate(blk);
+        CHECK_EQ(provider->free_blocks(), 100);
+    }
+
+    SUBCASE("continuous blocks") {
+        void* first = provider->Allocate(4096);
+        char* run = static_cast<char*>(provider->Allocate(4096 * 3 + 1));
+        REQUIRE(first != nullptr);
+        REQUIRE(run != nullptr);
+        CHECK_EQ(provider->free_blocks(), 95);
+        // the run is writable as a whole.
+        std::memset(run, 1, 4096 * 4);
+        provider->Deallocate(run);
+        CHECK_EQ(provider->free_blocks(), 99);
+        provider->Deallocate(first);
+        CHECK_EQ(provider->free_blocks(), 100);
+    }
+
+    SUBCASE("exhausted") {
+        std::vector<void*> blocks;
+        for (void* blk = provider->Allocate(1); blk != nullptr; blk = provider->Allocate(1)) {
+            blocks.push_back(blk);
+        }
+        CHECK_EQ(blocks.size(), 100);
+        CHECK_EQ(provider->free_blocks(), 0);
+        for (void* blk : blocks) {
+            provider->Deallocate(blk);
+        }
+        CHECK_EQ(provider->free_blocks(), 100);
+    }
+
+    SUBCASE("too large") {
+        CHECK_EQ(provider->Allocate(4096 * 65), nullptr);
+        CHECK_EQ(provider->Allocate(0), nullptr);
+    }
+}
+
+TEST_CASE("ShmBlockProvider.arena") {
+    auto provider = ShmBlockProvider::Create(4096, 64);
+    REQUIRE(provider != nullptr);
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    provider->Apply(ops);
+    CHECK_EQ(ops.normal_block_size, 4096);
+    CHECK_EQ(ops.huge_block_size, 4096 * 64);
+    {
+        Arena arena(ops);
+        for (int i = 0; i < 100; ++i) {
+            char* ptr = arena.AllocateAligned(1000);
+            REQUIRE(ptr != nullptr);
+            CHECK(provider->contains(ptr));
+        }
+        CHECK_LT(provider->free_blocks(), 64);
+        arena.Reset();
+        CHECK_EQ(provider->free_blocks(), 63);
+    }
+    CHECK_EQ(provider->free_blocks(), 64);
+}
+
+struct shared_node
+{
+    uint64_t value;
+    arena_offset_ptr<shared_node> next;
+};
+
+TEST_CASE("ShmBlockProvider.fork") {
+    auto provider = ShmBlockProvider::Create(4096, 16);
+    REQUIRE(provider != nullptr);
+    Arena::Options ops = Arena::Options::GetDefaultOptions();
+    provider->Apply(ops);
+    Arena arena(ops);
+
+    shared_node* head = nullptr;
+    for (uint64_t i = 0; i < 100; ++i) {
+        auto* node = arena.Create<shared_node>();
+        REQUIRE(node != nullptr);
+        node->value = i;
+        node->next = head;
+        head = node;
+    }
+    auto* flag = arena.Create<uint64_t>();
+    REQUIRE(flag != nullptr);
+    *flag = 0;
+
+    pid_t pid = ::fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+        // the child reads the data built by the parent, and writes to the shared memory.
+        uint64_t sum = 0;
+        for (auto* node = head; node != nullptr; node = node->next.get()) {
+            sum += node->value;
+        }
+        *flag = sum;
+        ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status));
+    CHECK_EQ(*flag, 99 * 100 / 2);
+}
+
+TEST_CASE("ShmBlockProvider.named") {
+    auto name = std::format("/stdb-shm-test-{}", ::getpid());
+    auto creator = ShmBlockProvider::CreateNamed(name, 4096, 8);
+    REQUIRE(creator != nullptr);
+    CHECK_EQ(ShmBlockProvider::CreateNamed(name, 4096, 8), nullptr);
+
+    auto attached = ShmBlockProvider::OpenNamed(name);
+    REQUIRE(attached != nullptr);
+    CHECK_EQ(attached->block_size(), 4096);
+    CHECK_EQ(attached->block_num(), 8);
+
+    // the bitmap is shared by the two mappings.
+    void* blk = creator->Allocate(4096);
+    REQUIRE(blk != nullptr);
+    CHECK_EQ(attached->free_blocks(), 7);
+    creator->Deallocate(blk);
+    CHECK_EQ(attached->free_blocks(), 8);
+
+    attached.reset();
+    creator.reset();
+    CHECK_EQ(ShmBlockProvider::OpenNamed(name), nullptr);
+}
+
+}  // namespace stdb::memory
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "container/simd.hpp"
+
+#include <algorithm>  // for min
+#include <cmath>      // for NAN
+#include <cstddef>    // for size_t
+#include <cstdint>    // for int8_t, uint16_t, int32_t, int64_t
+#include <random>     // for mt19937_64
+#include <vector>     // for vector
+
+#include "doctest/doctest.h"  // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::container::simd {
+
+// few distinct values, so every kernel sees matches in almost every register.
+template <typename T>
+static auto random_column(std::size_t size, uint64_t seed) -> std::vector<T> {
+    std::mt19937_64 rng(seed);
+    std::vector<T> column(size);
+    for (auto& elem : column) {
+        elem = static_cast<T>(rng() % 4);
+    }
+    return column;
+}
+
+// every level the cpu supports.
+static auto levels() -> std::vector<Level> {
+    std::vector<Level> result;
+    for (auto level : {Level::Scalar, Level::SSE4_1, Level::AVX2, Level::AVX512, Level::AVX512_VBMI2}) {
+        if (level <= active_level()) {
+            result.push_back(level);
+        }
+    }
+    return result;
+}
+
+TEST_CASE_TEMPLATE("simd kernels match the scalar ones", T, int8_t, uint16_t, int32_t, int64_t, float, double) {
+    const T needle = static_cast<T>(2);
+    for (auto level : levels()) {
+        bool find_ok = true;
+        bool count_ok = true;
+        bool remove_ok = true;
+        bool compress_ok = true;
+        // odd sizes and offsets for the unaligned heads and the tails.
+        for (std::size_t size = 0; size < 300; size += 7) {
+            for (std::size_t offset = 0; offset < 3; ++offset) {
+                auto column = random_column<T>(size + offset, size * 3 + offset);
+                const T* first = column.data() + offset;
+                const T* last = column.data() + column.size();
+
+                find_ok = find_ok and find(first, last, needle, level) == find_scalar(first, last, needle);
+                find_ok = find_ok and find(first, last, static_cast<T>(9), level) == last;
+                count_ok = count_ok and count(first, last, needle, level) == count_scalar(first, last, needle);
+
+                std::vector<T> expected;
+                for (const T* iter = first; iter != last; ++iter) {
+                    if (*iter != needle) {
+                        expected.push_back(*iter);
+                    }
+                }
+                auto removed = column;
+                T* new_last = remove(removed.data() + offset, removed.data() + removed.size(), needle, level);
+                remove_ok = remove_ok and std::vector<T>(removed.data() + offset, new_last) == expected;
+
+                // compress in chunks of 64, with a keep mask of odd positions plus the needle.
+                auto compressed = column;
+                T* dst = compressed.data() + offset;
+                std::vector<T> kept;
+                for (std::size_t pos = offset; pos < compressed.size(); pos += 64) {
+                    auto chunk = std::min<std::size_t>(64, compressed.size() - pos);
+                    uint64_t keep = 0;
+                    for (std::size_t i = 0; i < chunk; ++i) {
+                        if ((pos + i) % 2 == 1 or column[pos + i] == needle) {
+                            keep |= uint64_t{1} << i;
+                            kept.push_back(column[pos + i]);
+                        }
+                    }
+                    dst = compress(dst, compressed.data() + pos, chunk, keep, level);
+                }
+                compress_ok = compress_ok and std::vector<T>(compressed.data() + offset, dst) == kept;
+            }
+        }
+        CHECK(find_ok);
+        CHECK(count_ok);
+        CHECK(remove_ok);
+        CHECK(compress_ok);
+    }
+}
+
+TEST_CASE_TEMPLATE("simd floating point equality", T, float, double) {
+    std::vector<T> column(100, static_cast<T>(1));
+    column[10] = static_cast<T>(-0.0);
+    column[50] = static_cast<T>(NAN);
+    column[70] = static_cast<T>(NAN);
+    for (auto level : levels()) {
+        const T* first = column.data();
+        const T* last = column.data() + column.size();
+        // -0.0 == 0.0
+        CHECK_EQ(find(first, last, static_cast<T>(0.0), level), first + 10);
+        // NaN never equals to anything.
+        CHECK_EQ(find(first, last, static_cast<T>(NAN), level), last);
+        CHECK_EQ(count(first, last, static_cast<T>(NAN), level), 0);
+        CHECK_EQ(count(first, last, static_cast<T>(1), level), 97);
+        auto removed = column;
+        T* new_last = remove(removed.data(), removed.data() + removed.size(), static_cast<T>(NAN), level);
+        CHECK_EQ(new_last - removed.data(), 100);
+    }
+}
+
+
+TEST_CASE("simd bitwise kernels match the scalar ones") {
+    std::mt19937_64 rng(42);
+    for (auto level : levels()) {
+        bool ok = true;
+        for (std::size_t words = 0; words < 40; ++words) {
+            std::vector<uint64_t> lhs(words);
+            std::vector<uint64_t> rhs(words);
+            for (std::size_t i = 0; i < words; ++i) {
+                lhs[i] = rng();
+                rhs[i] = rng();
+            }
+            auto check = [&]<BitOp Op>() {
+                auto expected = lhs;
+                bitwise_scalar<Op>(expected.data(), rhs.data(), words);
+                auto result = lhs;
+                bitwise<Op>(result.data(), rhs.data(), words, level);
+                ok = ok and result == expected;
+            };
+            check.template operator()<BitOp::And>();
+            check.template operator()<BitOp::Or>();
+            check.template operator()<BitOp::Xor>();
+            check.template operator()<BitOp::AndNot>();
+            ok = ok and count_bits(lhs.data(), words, level) == count_bits_scalar(lhs.data(), words);
+        }
+        CHECK(ok);
+    }
+}
+
+}  // namespace stdb::container::simd
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+ |                                                                              |
+ |                                                                              |
+ |                    ..######..########.########..########.                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    .##..........##....##.....##.##.....##                    |
+ |                    ..######.....##....##.....##.########.                    |
+ |                    .......##....##....##.....##.##.....##                    |
+ |                    .##....##....##....##.....##.##.....##                    |
+ |                    ..######.....##....########..########.                    |
+ |                                                                              |
+ |                                                                              |
+ |                                                                              |
+ +------------------------------------------------------------------------------+
+*/
+
+#include "container/soa_vector.hpp"
+
+#include <cstddef>    // for size_t
+#include <cstdint>    // for int64_t, int32_t
+#include <span>       // for span
+#include <stdexcept>  // for runtime_error
+#include <string>     // for string
+#include <tuple>      // for tuple, get
+#include <utility>    // for as_const, move
+
+#include "doctest/doctest.h"  // for binary_assert, CHECK_EQ, TestCase
+
+namespace stdb::container {
+
+TEST_CASE("soa_vector push_back and columns") {
+    soa_vector<int64_t, double, int32_t> vec;
+    CHECK(vec.empty());
+    CHECK_EQ(vec.column<0>().size(), 0);
+    for (int32_t i = 0; i < 1000; ++i) {
+        vec.push_back({i, i * 0.5, -i});
+    }
+    CHECK_EQ(vec.size(), 1000);
+    CHECK_GE(vec.capacity(), 1000);
+
+    std::span<int64_t> ids = vec.column<0>();
+    std::span<double> halves = vec.column<1>();
+    std::span<const int32_t> negs = std::as_const(vec).column<2>();
+    CHECK_EQ(ids.size(), 1000);
+    bool ok = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        ok = ok and ids[i] == static_cast<int64_t>(i) and halves[i] == static_cast<double>(i) * 0.5 and
+             negs[i] == -static_cast<int32_t>(i);
+    }
+    CHECK(ok);
+
+    auto [id, half, neg] = vec[10];
+    CHECK_EQ(id, 10);
+    CHECK_EQ(half, 5.0);
+    CHECK_EQ(neg, -10);
+    // the row is a tuple of references.
+    std::get<1>(vec[10]) = 42.0;
+    CHECK_EQ(vec.column<1>()[10], 42.0);
+    CHECK_EQ(std::get<0>(vec.back()), 999);
+
+    vec.pop_back();
+    CHECK_EQ(vec.size(), 999);
+    vec.shrink_to_fit();
+    CHECK_EQ(vec.capacity(), 999);
+}
+
+TEST_CASE("soa_vector with non trivial fields") {
+    soa_vector<std::string, int> vec;
+    vec.reserve(2);
+    CHECK_EQ(vec.capacity(), 2);
+    for (int i = 0; i < 100; ++i) {
+        vec.emplace_back(std::string(32, static_cast<char>('a' + i % 26)), i);
+    }
+    // the argument refers to an element of the vector, and the push_back reallocates.
+    while (not vec.full()) {
+        vec.emplace_back("x", 0);
+    }
+    vec.emplace_back(std::get<0>(vec[0]), std::get<1>(vec[0]));
+    CHECK_EQ(std::get<0>(vec.back()), std::string(32, 'a'));
+    CHECK_EQ(vec.column<0>()[25], std::string(32, 'z'));
+
+    SUBCASE("copy and move") {
+        soa_vector<std::string, int> copied(vec);
+        CHECK_EQ(copied.size(), vec.size());
+        CHECK_EQ(copied.column<0>()[3], vec.column<0>()[3]);
+        soa_vector<std::string, int> moved(std::move(copied));
+        CHECK(copied.empty());  // NOLINT
+        CHECK_EQ(moved.size(), vec.size());
+        soa_vector<std::string, int> assigned;
+        assigned.push_back({"y", 1});
+        assigned = moved;
+        CHECK_EQ(assigned.size(), vec.size());
+        CHECK_EQ(std::get<1>(assigned[99]), 99);
+        assigned = soa_vector<std::string, int>();
+        CHECK(assigned.empty());
+        CHECK_EQ(assigned.capacity(), 0);
+    }
+    SUBCASE("resize and clear") {
+        vec.resize(10);
+        CHECK_EQ(vec.size(), 10);
+        CHECK_EQ(vec.column<1>()[9], 9);
+        vec.resize(20);
+        CHECK_EQ(vec.column<0>()[19], std::string());
+        CHECK_EQ(vec.column<1>()[19], 0);
+        vec.clear();
+        CHECK(vec.empty());
+        soa_vector<std::string, int> sized(5);
+        CHECK_EQ(sized.size(), 5);
+        CHECK_EQ(sized.column<1>()[4], 0);
+    }
+}
+
+// the live instances of a field type, and its constructor throws once the budget is used up.
+struct throwing_field
+{
+    static inline int live = 0;
+    static inline int budget = 0;
+
+    throwing_field() : throwing_field(0) {}
+    explicit throwing_field(int val) : value(val) {
+        if (budget-- == 0) {
+            throw std::runtime_error("throwing_field");
+        }
+        ++live;
+    }
+    throwing_field(const throwing_field& other) : throwing_field(other.value) {}
+    throwing_field(throwing_field&& other) noexcept : value(other.value) { ++live; }
+    auto operator=(const throwing_field&) -> throwing_field& = default;
+    auto operator=(throwing_field&&) noexcept -> throwing_field& = default;
+    ~throwing_field() { --live; }
+
+    int value;
+};
+
+TEST_CASE("soa_vector is untouched by a throwing field") {
+    throwing_field::live = 0;
+    throwing_field::budget = 100;
+    {
+        // the string column is built before the throwing one, it should be destroyed on the exception.
+        soa_vector<std::string, throwing_field> vec;
+        vec.reserve(4);
+        for (int i = 0; i < 4; ++i) {
+            vec.emplace_back(std::string(32, 'a'), i);
+        }
+        REQUIRE(vec.full());
+        throwing_field::budget = 0;
+        // the slow path, the fresh columns are freed.
+        CHECK_THROWS_AS(vec.emplace_back(std::string(32, 'b'), 4), std::runtime_error);
+        CHECK_EQ(vec.size(), 4);
+        CHECK_EQ(vec.capacity(), 4);
+        CHECK_EQ(throwing_field::live, 4);
+
+        // the fast path.
+        throwing_field::budget = 0;
+        vec.reserve(8);
+        CHECK_THROWS_AS(vec.emplace_back(std::string(32, 'c'), 5), std::runtime_error);
+        CHECK_EQ(vec.size(), 4);
+        CHECK_EQ(throwing_field::live, 4);
+        CHECK_EQ(std::get<1>(std::as_const(vec).back()).value, 3);
+        CHECK_EQ(std::get<0>(std::as_const(vec).front()), std::string(32, 'a'));
+
+        throwing_field::budget = 100;
+        vec.emplace_back(std::string(32, 'd'), 6);
+        CHECK_EQ(vec.size(), 5);
+    }
+    CHECK_EQ(throwing_field::live, 0);
+}
+
+TEST_CASE("soa_vector copy and resize roll back a throwing field") {
+    using vec_type = soa_vector<throwing_field, std::string, throwing_field>;
+    throwing_field::live = 0;
+    throwing_field::budget = 100;
+    {
+        vec_type vec;
+        for (int i = 0; i < 4; ++i) {
+            vec.emplace_back(i, std::string(32, 'a'), i);
+        }
+        REQUIRE_EQ(throwing_field::live, 8);
+
+        // the first column is copied, the last one throws at its third row.
+        throwing_field::budget = 6;
+        CHECK_THROWS_AS(vec_type{vec}, std::runtime_error);
+        CHECK_EQ(throwing_field::live, 8);
+
+        vec_type assigned;
+        assigned.emplace_back(9, std::string(32, 'b'), 9);
+        throwing_field::budget = 6;
+        CHECK_THROWS_AS(assigned = vec, std::runtime_error);
+        CHECK(assigned.empty());
+        CHECK_EQ(throwing_field::live, 8);
+
+        throwing_field::budget = 3;
+        CHECK_THROWS_AS(vec_type(4), std::runtime_error);
+        CHECK_EQ(throwing_field::live, 8);
+
+        throwing_field::budget = 5;
+        CHECK_THROWS_AS(vec.resize(8), std::runtime_error);
+        CHECK_EQ(vec.size(), 4);
+        CHECK_EQ(throwing_field::live, 8);
+        CHECK_EQ(std::get<2>(vec.back()).value, 3);
+
+        throwing_field::budget = 100;
+        assigned = vec;
+        CHECK_EQ(assigned.size(), 4);
+        vec.resize(6);
+        CHECK_EQ(throwing_field::live, 20);
+    }
+    CHECK_EQ(throwing_field::live, 0);
+}
+
+}  // namespace stdb::container
@@ -31,12 +31,22 @@
 */
 
 #include "container/stdb_vector.hpp"
+#include "container/size_class_growth.hpp"
+#include "container/stdb_vector_parallel.hpp"
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
 
@@ -1343,6 +1353,477 @@ TEST_CASE("vector of bool works well") {
     CHECK_EQ(v[10], false);
 }
 
+TEST_CASE("stdb_small_vector stays inline until it spills") {
+    static_assert(sizeof(stdb_vector<int>) == 3 * sizeof(int*), "stdb_vector should not pay for the inline buffer");
+    static_assert(sizeof(stdb_small_vector<int, 8>) == 3 * sizeof(int*) + 8 * sizeof(int));
+    stdb_small_vector<int, 8> vec;
+    CHECK(vec.is_inline());
+    CHECK_EQ(vec.size(), 0);
+    CHECK_EQ(vec.capacity(), 8);
+    auto* inline_data = vec.data();
+    for (int i = 0; i < 8; ++i) {
+        vec.push_back(i);
+    }
+    CHECK(vec.is_inline());
+    CHECK_EQ(vec.data(), inline_data);
+    vec.push_back(8);
+    CHECK_FALSE(vec.is_inline());
+    CHECK_EQ(vec.size(), 9);
+    CHECK_GT(vec.capacity(), 8);
+    for (int i = 0; i < 9; ++i) {
+        CHECK_EQ(vec[static_cast<size_t>(i)], i);
+    }
+    // shrink back into the inline buffer.
+    vec.resize(3);
+    vec.shrink_to_fit();
+    CHECK(vec.is_inline());
+    CHECK_EQ(vec.capacity(), 8);
+    CHECK_EQ(vec, (stdb_small_vector<int, 8>{0, 1, 2}));
+    vec.clear();
+    vec.shrink_to_fit();
+    CHECK(vec.is_inline());
+    CHECK(vec.empty());
+}
+
+TEST_CASE("stdb_small_vector unsafe paths") {
+    stdb_small_vector<int, 8> vec;
+    vec.push_back<Safety::Unsafe>(1);
+    vec.emplace_back<Safety::Unsafe>(2);
+    auto buffer = vec.get_writebuffer<Safety::Unsafe>(4);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<int>(i) + 3;
+    }
+    vec.fill<Safety::Unsafe>([](int* ptr) -> std::size_t {
+        if (ptr != nullptr) {
+            ptr[0] = 7;
+            ptr[1] = 8;
+        }
+        return 2;
+    });
+    CHECK(vec.is_inline());
+    CHECK_EQ(vec, (stdb_small_vector<int, 8>{1, 2, 3, 4, 5, 6, 7, 8}));
+    // the safe one spills.
+    auto spilled = vec.get_writebuffer(10);
+    CHECK_EQ(spilled.size(), 10);
+    CHECK_FALSE(vec.is_inline());
+    CHECK_EQ(vec.size(), 18);
+    CHECK_EQ(vec[7], 8);
+}
+
+TEST_CASE("stdb_small_vector copy move and swap") {
+    SUBCASE("inline") {
+        stdb_small_vector<std::string, 4> vec{"a", "b"};
+        auto copied = vec;
+        CHECK(copied.is_inline());
+        CHECK_EQ(copied, vec);
+        auto moved = std::move(copied);
+        CHECK(moved.is_inline());
+        CHECK_EQ(moved, vec);
+        CHECK(copied.empty());
+        CHECK(copied.is_inline());
+        copied.push_back("c");
+        CHECK_EQ(copied.size(), 1);
+    }
+    SUBCASE("heap") {
+        stdb_small_vector<std::string, 2> vec{"a", "b", "c"};
+        CHECK_FALSE(vec.is_inline());
+        auto* heap_data = vec.data();
+        auto moved = std::move(vec);
+        CHECK_EQ(moved.data(), heap_data);
+        CHECK(vec.is_inline());
+        CHECK(vec.empty());
+        vec = moved;
+        CHECK_FALSE(vec.is_inline());
+        CHECK_EQ(vec, moved);
+    }
+    SUBCASE("swap inline with heap") {
+        stdb_small_vector<std::string, 2> small{"x"};
+        stdb_small_vector<std::string, 2> large{"a", "b", "c"};
+        auto* heap_data = large.data();
+        std::swap(small, large);
+        CHECK_FALSE(small.is_inline());
+        CHECK_EQ(small.data(), heap_data);
+        CHECK_EQ(small.size(), 3);
+        CHECK(large.is_inline());
+        CHECK_EQ(large.size(), 1);
+        CHECK_EQ(large[0], "x");
+        large.swap(small);
+        CHECK_EQ(small.size(), 1);
+        CHECK_EQ(large.size(), 3);
+    }
+    SUBCASE("insert and erase across the spill") {
+        stdb_small_vector<int, 4> vec{1, 2, 4};
+        vec.insert(vec.begin() + 2, 3);
+        CHECK(vec.is_inline());
+        vec.insert(vec.begin(), 0);
+        CHECK_FALSE(vec.is_inline());
+        CHECK_EQ(vec, (stdb_small_vector<int, 4>{0, 1, 2, 3, 4}));
+        CHECK_EQ(std::erase_if(vec, [](int x) { return x % 2 == 1; }), 2);
+        CHECK_EQ(vec, (stdb_small_vector<int, 4>{0, 2, 4}));
+    }
+}
+
+TEST_CASE("stdb_vector find count and contains") {
+    stdb_vector<int64_t> vec;
+    for (int64_t i = 0; i < 1000; ++i) {
+        vec.push_back(i % 100);
+    }
+    CHECK_EQ(vec.find(42) - vec.begin(), 42);
+    CHECK_EQ(vec.find(1000), vec.end());
+    CHECK_EQ(vec.count(42), 10);
+    CHECK(vec.contains(99));
+    CHECK_FALSE(vec.contains(-1));
+    const auto& const_vec = vec;
+    CHECK_EQ(const_vec.find(7) - const_vec.cbegin(), 7);
+
+    stdb_vector<std::string> strings{"a", "b", "a"};
+    CHECK_EQ(strings.count("a"), 2);
+    CHECK_EQ(strings.find("b") - strings.begin(), 1);
+    CHECK_FALSE(strings.contains("c"));
+}
+
+TEST_CASE("stdb_vector erase arithmetic elements by compaction") {
+    stdb_vector<int32_t> vec;
+    for (int32_t i = 0; i < 1003; ++i) {
+        vec.push_back(i % 3);
+    }
+    CHECK_EQ(vec.erase(1), 334);
+    CHECK_EQ(vec.size(), 669);
+    CHECK_FALSE(vec.contains(1));
+    CHECK_EQ(vec.count(0), 335);
+    CHECK_EQ(std::erase_if(vec, [](int32_t x) { return x == 0; }), 335);
+    CHECK_EQ(vec.size(), 334);
+    CHECK_EQ(vec.count(2), 334);
+
+    stdb_vector<double> doubles{1.0, 2.0, 1.0, 3.0};
+    CHECK_EQ(std::erase(doubles, 1.0), 2);
+    CHECK_EQ(doubles, (stdb_vector<double>{2.0, 3.0}));
+    stdb_vector<uint8_t> bytes(200, 7);
+    bytes[100] = 8;
+    CHECK_EQ(bytes.erase_if([](uint8_t x) { return x == 7; }), 199);
+    CHECK_EQ(bytes.size(), 1);
+    CHECK_EQ(bytes[0], 8);
+    stdb_vector<int> empty;
+    CHECK_EQ(empty.erase(1), 0);
+    CHECK_EQ(empty.erase_if([](int x) { return x > 0; }), 0);
+}
+
+TEST_CASE("stdb_vector bulk append") {
+    SUBCASE("append_range") {
+        stdb_vector<int> vec{1, 2};
+        std::vector<int> source{3, 4, 5};
+        vec.append_range(std::span<const int>(source));
+        CHECK_EQ(vec, (stdb_vector<int>{1, 2, 3, 4, 5}));
+        // append itself, the buffer is reallocated during the append.
+        vec.shrink_to_fit();
+        vec.append_range(std::span<const int>(vec.data(), vec.size()));
+        CHECK_EQ(vec, (stdb_vector<int>{1, 2, 3, 4, 5, 1, 2, 3, 4, 5}));
+        vec.append_range(std::set<int>{7, 6});
+        CHECK_EQ(vec.size(), 12);
+        CHECK_EQ(vec[10], 6);
+        CHECK_EQ(vec[11], 7);
+        vec.reserve(20);
+        vec.append_range<Safety::Unsafe>(source);
+        CHECK_EQ(vec.size(), 15);
+        CHECK_EQ(vec.back(), 5);
+        vec.append_range(std::span<const int>());
+        CHECK_EQ(vec.size(), 15);
+
+        stdb_vector<std::string> strings{"a"};
+        std::vector<std::string> more{"b", "c"};
+        strings.append_range(more);
+        CHECK_EQ(strings, (stdb_vector<std::string>{"a", "b", "c"}));
+    }
+    SUBCASE("resize_uninitialized") {
+        stdb_vector<uint32_t> vec;
+        for (uint32_t round = 0; round < 10; ++round) {
+            auto old_size = vec.size();
+            vec.resize_uninitialized(old_size + 100);
+            for (size_t i = old_size; i < vec.size(); ++i) {
+                vec[i] = round;
+            }
+        }
+        CHECK_EQ(vec.size(), 1000);
+        CHECK_EQ(vec[999], 9);
+        CHECK_EQ(vec.count(3), 100);
+        vec.resize_uninitialized(10);
+        CHECK_EQ(vec.size(), 10);
+    }
+    SUBCASE("fill with an invocable") {
+        stdb_vector<int> vec;
+        int next = 0;
+        // the filler may write less than the upper bound.
+        auto decode = [&next](int* out) -> std::size_t {
+            for (int i = 0; i < 30; ++i) {
+                out[i] = next++;
+            }
+            return 30;
+        };
+        for (int round = 0; round < 5; ++round) {
+            vec.fill(64, decode);
+        }
+        CHECK_EQ(vec.size(), 150);
+        CHECK_EQ(vec[149], 149);
+        CHECK_GE(vec.capacity(), 150 + 34);
+        vec.fill<Safety::Unsafe>(30, decode);
+        CHECK_EQ(vec.size(), 180);
+    }
+}
+
+// grows by 10 elements, to test a user-defined growth policy.
+struct step_growth
+{
+    template <typename T>
+    static auto grow(std::size_t cap, std::size_t min_cap) noexcept -> std::size_t {
+        return std::max(cap + 10, min_cap);
+    }
+    static auto allocated([[maybe_unused]] void* ptr, std::size_t bytes) noexcept -> std::size_t { return bytes; }
+};
+
+TEST_CASE("stdb_vector growth policy") {
+    SUBCASE("default growth") {
+        CHECK_EQ(default_growth::grow<int>(0, 1), 16);
+        CHECK_EQ(default_growth::grow<int>(16, 17), 24);
+        CHECK_EQ(default_growth::grow<int>(16, 100), 100);
+        CHECK_EQ(default_growth::grow<char>(4096 * 32, 4096 * 32 + 1), 4096 * 64);
+    }
+    SUBCASE("user-defined growth") {
+        stdb_vector<int, std::allocator<int>, 0, step_growth> vec;
+        for (int i = 0; i < 25; ++i) {
+            vec.push_back(i);
+        }
+        CHECK_EQ(vec.capacity(), 30);
+        CHECK_EQ(vec.back(), 24);
+    }
+    SUBCASE("size class growth") {
+        // never smaller than the default one.
+        CHECK_GE(size_class_growth::grow<int>(0, 1), 16);
+        CHECK_GE(size_class_growth::grow<int>(16, 17), 24);
+        // the large buffers are rounded up to huge pages.
+        auto huge = size_class_growth::grow<char>(3 * 1024 * 1024, 3 * 1024 * 1024 + 1);
+        CHECK_EQ(huge % size_class_growth::kHugePageSize, 0);
+        CHECK_GE(huge, 6 * 1024 * 1024);
+
+        stdb_vector<int64_t, std::allocator<int64_t>, 0, size_class_growth> vec;
+        for (int64_t i = 0; i < 1000000; ++i) {
+            vec.push_back(i);
+        }
+        CHECK_EQ(vec.size(), 1000000);
+        CHECK_EQ(vec.back(), 999999);
+        // malloc_usable_size may add the slack of the last page.
+        CHECK_GE(vec.capacity() * sizeof(int64_t), 8 * 1024 * 1024);
+        stdb_small_vector<int, 4, size_class_growth> small{1, 2, 3, 4, 5};
+        CHECK_GE(small.capacity(), 5);
+        CHECK_EQ(small.count(5), 1);
+    }
+}
+
+TEST_CASE("stdb_vector parallel construct copy and destroy") {
+    // a zero threshold makes every range parallel.
+    constexpr parallel_policy policy{.threads = 4, .threshold = 0};
+    SUBCASE("trivial elements") {
+        stdb_vector<int64_t> zeros(policy, 100000);
+        CHECK_EQ(zeros.size(), 100000);
+        CHECK_EQ(zeros.count(0), 100000);
+        stdb_vector<int64_t> sevens(policy, 100000, 7);
+        CHECK_EQ(sevens.count(7), 100000);
+        stdb_vector<int64_t> copied(policy, sevens);
+        CHECK_EQ(copied, sevens);
+        copied.resize(policy, 150000);
+        CHECK_EQ(copied.count(0), 50000);
+        copied.resize(policy, 200000, 9);
+        CHECK_EQ(copied.count(9), 50000);
+        copied.assign(policy, 10, 1);
+        CHECK_EQ(copied, (stdb_vector<int64_t>(10, 1)));
+        stdb_vector<int64_t> empty(policy, 0);
+        CHECK(empty.empty());
+    }
+    SUBCASE("non-trivial elements") {
+        stdb_vector<std::string> strings(policy, 10000, std::string(40, 'x'));
+        stdb_vector<std::string> copied(policy, strings);
+        CHECK_EQ(copied, strings);
+        copied.resize(policy, 100);
+        copied.resize(policy, 20000);
+        CHECK_EQ(copied.count(""), 19900);
+        copied.clear(policy);
+        CHECK(copied.empty());
+    }
+    SUBCASE("small ranges stay in the calling thread") {
+        // par has a 64MB threshold.
+        stdb_vector<int> vec(par, 100, 3);
+        CHECK_EQ(vec.count(3), 100);
+    }
+    SUBCASE("chunks are split at the page boundaries") {
+        // a buffer starting 16 bytes after a page boundary, like the glibc heap buffers.
+        std::vector<int64_t> buffer(kPageElements<int64_t> * 20);
+        auto address = reinterpret_cast<std::uintptr_t>(buffer.data());  // NOLINT
+        auto offset = ((address + kPageSize - 1) & ~(kPageSize - 1)) - address + 16;
+        const int64_t* first = buffer.data() + offset / sizeof(int64_t);
+        std::size_t count = kPageElements<int64_t> * 16;
+        std::mutex mutex;
+        std::vector<std::pair<std::size_t, std::size_t>> chunks;
+        parallel_for_pages(policy, first, count, [&](std::size_t begin, std::size_t end) {
+            std::lock_guard<std::mutex> guard(mutex);
+            chunks.emplace_back(begin, end);
+        });
+        std::ranges::sort(chunks);
+        CHECK_EQ(chunks.size(), 4);
+        CHECK_EQ(chunks.front().first, 0);
+        CHECK_EQ(chunks.back().second, count);
+        bool aligned = true;
+        for (std::size_t i = 1; i < chunks.size(); ++i) {
+            aligned = aligned and chunks[i].first == chunks[i - 1].second and
+                      reinterpret_cast<std::uintptr_t>(first + chunks[i].first) % kPageSize == 0;  // NOLINT
+        }
+        CHECK(aligned);
+    }
+    SUBCASE("the workers are reused") {
+        std::mutex mutex;
+        std::set<std::thread::id> ids;
+        auto record = [&](std::size_t /*unused*/, std::size_t /*unused*/) {
+            std::lock_guard<std::mutex> guard(mutex);
+            ids.insert(std::this_thread::get_id());
+        };
+        for (int i = 0; i < 50; ++i) {
+            parallel_for(policy, 10000, 100, record);
+        }
+        CHECK_LE(ids.size(), parallel_pool::global().workers() + 1);
+        // a nested parallel_for is run by the waiting threads if the workers are busy.
+        std::atomic<std::size_t> visited{0};
+        parallel_for(policy, 400, 100, [&](std::size_t begin, std::size_t end) {
+            parallel_for(policy, end - begin, 10,
+                         [&](std::size_t first, std::size_t last) { visited += last - first; });
+        });
+        CHECK_EQ(visited.load(), 400);
+
+        // the tasks are run by the workers of a pool.
+        parallel_pool pool(2);
+        std::atomic<std::size_t> pending{0};
+        std::atomic<std::size_t> sum{0};
+        auto add = [](void* context, std::size_t begin, std::size_t end) noexcept {
+            *static_cast<std::atomic<std::size_t>*>(context) += end - begin;
+        };
+        for (std::size_t i = 0; i < 100; ++i) {
+            pending.fetch_add(1);
+            pool.push({.run = add, .context = &sum, .begin = i, .end = i + 2, .pending = &pending});
+        }
+        pool.wait(pending);
+        CHECK_EQ(sum.load(), 200);
+    }
+    SUBCASE("exceptions are rethrown after join") {
+        std::atomic<std::size_t> visited{0};
+        auto work = [&visited](std::size_t begin, std::size_t end) {
+            visited += end - begin;
+            if (begin > 0) {
+                throw std::runtime_error("worker failed");
+            }
+        };
+        CHECK_THROWS_AS(parallel_for(policy, 10000, 100, work), std::runtime_error);
+        CHECK_EQ(visited.load(), 10000);
+    }
+}
+
+TEST_CASE("stdb_vector insert_many and merge_insert_sorted") {
+    SUBCASE("relocatable") {
+        stdb_vector<int> vec{10, 20, 30, 40};
+        std::vector<std::size_t> positions{0, 2, 2, 4};
+        std::vector<int> values{5, 21, 22, 50};
+        vec.insert_many(positions, values);
+        CHECK_EQ(vec, (stdb_vector<int>{5, 10, 20, 21, 22, 30, 40, 50}));
+        // insert nothing
+        vec.insert_many({}, {});
+        CHECK_EQ(vec.size(), 8);
+
+        stdb_vector<int> list;
+        std::vector<int> expected;
+        for (int i = 0; i < 1000; i += 2) {
+            list.push_back(i);
+            expected.push_back(i);
+        }
+        std::vector<int> batch{-3, 1, 1, 7, 500, 998, 999, 2000};
+        list.merge_insert_sorted(batch);
+        expected.insert(expected.end(), batch.begin(), batch.end());
+        std::ranges::stable_sort(expected);
+        CHECK(std::ranges::equal(list, expected));
+        std::vector<int> descending{9, 5, 1};
+        stdb_vector<int> reversed{8, 6, 4, 2};
+        reversed.merge_insert_sorted(descending, std::greater<>{});
+        CHECK_EQ(reversed, (stdb_vector<int>{9, 8, 6, 5, 4, 2, 1}));
+    }
+    SUBCASE("non relocatable") {
+        stdb_vector<std::string> vec{"b", "d", "f"};
+        std::vector<std::string> values{"a", "c", "e", "g"};
+        vec.reserve(vec.size() + values.size());
+        vec.merge_insert_sorted<Safety::Unsafe>(values);
+        CHECK_EQ(vec, (stdb_vector<std::string>{"a", "b", "c", "d", "e", "f", "g"}));
+        std::vector<std::size_t> positions{1, 1, 7};
+        std::vector<std::string> more{std::string(40, 'x'), std::string(40, 'y'), "z"};
+        vec.insert_many(positions, more);
+        CHECK_EQ(vec.size(), 10);
+        CHECK_EQ(vec[1], std::string(40, 'x'));
+        CHECK_EQ(vec[2], std::string(40, 'y'));
+        CHECK_EQ(vec[3], "b");
+        CHECK_EQ(vec.back(), "z");
+    }
+}
+
+struct column_cell
+{
+    int64_t id;
+    double value;
+};
+
+}  // namespace stdb::container
+
+template <>
+struct stdb::Reallocatable<stdb::container::column_cell> : std::true_type
+{};
+
+namespace stdb::container {
+
+static_assert(IsReallocatable<column_cell>, "column_cell should be reallocatable");
+static_assert(!IsReallocatable<int>, "reallocate should be opted in");
+static_assert(!IsReallocatable<std::string>, "std::string is not relocatable");
+
+TEST_CASE("stdb_vector grows reallocatable elements by realloc") {
+    SUBCASE("push_back and reserve") {
+        stdb_vector<column_cell> vec;
+        for (int64_t i = 0; i < 10000; ++i) {
+            vec.push_back({i, static_cast<double>(i) / 2});
+        }
+        vec.reserve(50000);
+        CHECK_EQ(vec.capacity(), 50000);
+        vec.shrink_to_fit();
+        CHECK_EQ(vec.capacity(), 10000);
+        bool same = true;
+        for (int64_t i = 0; i < 10000; ++i) {
+            const auto& cell = vec[static_cast<size_t>(i)];
+            same = same and cell.id == i and cell.value == static_cast<double>(i) / 2;
+        }
+        CHECK(same);
+    }
+    SUBCASE("emplace an element of itself while growing") {
+        stdb_vector<column_cell> vec(16, column_cell{7, 1.5});
+        CHECK(vec.full());
+        vec.push_back(vec[0]);
+        CHECK_EQ(vec.size(), 17);
+        CHECK_EQ(vec.back().id, 7);
+        CHECK_EQ(vec.back().value, 1.5);
+    }
+    SUBCASE("small vector spills and grows") {
+        stdb_small_vector<column_cell, 2> vec;
+        for (int64_t i = 0; i < 100; ++i) {
+            vec.emplace_back(column_cell{i, 0});
+        }
+        CHECK_FALSE(vec.is_inline());
+        CHECK_EQ(vec[99].id, 99);
+        vec.resize(2);
+        vec.shrink_to_fit();
+        CHECK(vec.is_inline());
+        CHECK_EQ(vec[1].id, 1);
+    }
+}
+
 
 }  // namespace stdb::container
 
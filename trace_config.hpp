@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 Beijing Jinyi Data Technology Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ +------------------------------------------------------------------------------+
+|                                                                              |
+|                                                                              |
+|                    ..######..########.########..########.                    |
+|                    .##....##....##....##.....##.##.....##                    |
+|                    .##..........##....##.....##.##.....##                    |
+|                    ..######.....##....##.....##.########.                    |
+|                    .......##....##....##.....##.##.....##                    |
+|                    .##....##....##....##.....##.##.....##                    |
+|                    ..######.....##....########..########.                    |
+|                                                                              |
+|                                                                              |
+|                                                                              |
++------------------------------------------------------------------------------+
+*/
+
+#pragma once
+
+/*
+ * static tracepoints for perf and bpftrace, they are USDT probes of the provider "stdb", such as:
+ *     perf probe -x <binary> sdt_stdb:arena_newblock
+ *     bpftrace -e 'usdt:<binary>:stdb:arena_newblock { @size = hist(arg1); }'
+ *
+ * a probe is a single nop until it is attached, and the arguments are only materialized in registers or memory,
+ * so they are always compiled in while sys/sdt.h (systemtap-sdt-dev) is available.
+ * define STDB_DISABLE_TRACE to compile them out, they are also compiled out if sys/sdt.h is not found.
+ */
+#if !defined(STDB_DISABLE_TRACE) && __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+#define STDB_TRACE_ENABLED 1
+#define STDB_TRACE(name, ...) STAP_PROBEV(stdb, name, __VA_ARGS__)  // NOLINT
+
+#else
+
+#define STDB_TRACE(name, ...) static_cast<void>(0)  // NOLINT
+
+#endif